@@ -0,0 +1,223 @@
+/*
+ * Copyright (c) 2026 Matthias Schmidt <xhr@giessen.ccc.de>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Changes to the loaded character are written by a background thread.  The
+ * functions that change values mark the character dirty, the thread waits
+ * until no change came in for AUTOSAVE_QUIET_MS, but at most
+ * AUTOSAVE_MAX_DELAY_MS after the first one, and then saves the character.
+ *
+ * The character and everything hanging off it belong to the main thread
+ * while it executes a command.  The main thread only lends them to the
+ * autosave thread while it waits for input, which is when state_lock is
+ * free.  Before the loaded character changes with cd and on shutdown,
+ * autosave_barrier() writes what is still pending right away.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include "isscrolls.h"
+
+#define AUTOSAVE_QUIET_MS	250
+#define AUTOSAVE_MAX_DELAY_MS	2000
+
+#define MS	1000000ULL
+
+static pthread_t autosave_thread;
+static pthread_t main_thread;
+static int running = 0;
+
+/* Held by the main thread, except while it waits for input */
+static pthread_mutex_t state_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct character *idle_character = NULL;
+
+/* Protects the fields below */
+static pthread_mutex_t dirty_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t dirty_cond = PTHREAD_COND_INITIALIZER;
+static int dirty = 0;
+static int stopping = 0;
+static uint64_t first_change = 0;
+static uint64_t last_change = 0;
+
+/* Wait on dirty_cond for at most ns nanoseconds */
+static void
+wait_dirty(uint64_t ns)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_REALTIME, &ts);
+	ns += ts.tv_nsec;
+	ts.tv_sec += ns / 1000000000;
+	ts.tv_nsec = ns % 1000000000;
+
+	pthread_cond_timedwait(&dirty_cond, &dirty_lock, &ts);
+}
+
+static void *
+autosave_loop(__attribute__((unused)) void *arg)
+{
+	uint64_t now, quiet, max;
+
+	pthread_mutex_lock(&dirty_lock);
+
+	for (;;) {
+		while (!dirty && !stopping)
+			pthread_cond_wait(&dirty_cond, &dirty_lock);
+		if (stopping)
+			break;
+
+		/* Let a burst of changes settle, so that it is written once */
+		for (;;) {
+			now = stats_now();
+			quiet = last_change + AUTOSAVE_QUIET_MS * MS;
+			max = first_change + AUTOSAVE_MAX_DELAY_MS * MS;
+			if (now >= quiet || now >= max || stopping || !dirty)
+				break;
+			wait_dirty((quiet < max ? quiet : max) - now);
+		}
+		pthread_mutex_unlock(&dirty_lock);
+
+		/* Wait until the main thread is done with the command */
+		pthread_mutex_lock(&state_lock);
+		pthread_mutex_lock(&dirty_lock);
+
+		/* A barrier might have been faster, or we shut down anyway */
+		if (!dirty || stopping) {
+			pthread_mutex_unlock(&state_lock);
+			continue;
+		}
+		dirty = 0;
+		pthread_mutex_unlock(&dirty_lock);
+
+		if (idle_character != NULL) {
+			log_debug("Autosave %s\n", idle_character->name);
+			set_thread_character(idle_character);
+			save_character();
+			set_thread_character(NULL);
+		}
+
+		pthread_mutex_unlock(&state_lock);
+		pthread_mutex_lock(&dirty_lock);
+	}
+
+	pthread_mutex_unlock(&dirty_lock);
+
+	return NULL;
+}
+
+void
+start_autosave(void)
+{
+	main_thread = pthread_self();
+	pthread_mutex_lock(&state_lock);
+
+	if (pthread_create(&autosave_thread, NULL, autosave_loop, NULL) != 0) {
+		log_debug("Cannot start the autosave thread\n");
+		pthread_mutex_unlock(&state_lock);
+		return;
+	}
+
+	running = 1;
+}
+
+/* Wait for a save in progress and end the thread */
+void
+stop_autosave(void)
+{
+	if (!running || pthread_equal(pthread_self(), autosave_thread))
+		return;
+
+	pthread_mutex_lock(&dirty_lock);
+	stopping = 1;
+	pthread_cond_signal(&dirty_cond);
+	pthread_mutex_unlock(&dirty_lock);
+
+	if (pthread_equal(pthread_self(), main_thread))
+		pthread_mutex_unlock(&state_lock);
+
+	pthread_join(autosave_thread, NULL);
+	running = 0;
+}
+
+/* Called by the functions that change the loaded character */
+void
+mark_dirty(void)
+{
+	struct character *c;
+
+	/* Tells save_character() the record needs a new generation */
+	if ((c = get_current_character()) != NULL)
+		c->changed = 1;
+
+	/* Changes of the simulators' threads are nothing to save */
+	if (!running || !pthread_equal(pthread_self(), main_thread))
+		return;
+
+	pthread_mutex_lock(&dirty_lock);
+	last_change = stats_now();
+	if (!dirty) {
+		dirty = 1;
+		first_change = last_change;
+		pthread_cond_signal(&dirty_cond);
+	}
+	pthread_mutex_unlock(&dirty_lock);
+}
+
+/* The main thread waits for input, the autosave thread may save meanwhile */
+void
+autosave_idle(void)
+{
+	if (!running)
+		return;
+
+	idle_character = get_current_character();
+	pthread_mutex_unlock(&state_lock);
+}
+
+void
+autosave_busy(void)
+{
+	if (!running)
+		return;
+
+	pthread_mutex_lock(&state_lock);
+	idle_character = NULL;
+}
+
+/*
+ * Write pending changes of the loaded character now.  Only called by the
+ * main thread, which holds state_lock, so no autosave runs meanwhile.
+ */
+void
+autosave_barrier(void)
+{
+	int pending;
+
+	if (!running)
+		return;
+
+	pthread_mutex_lock(&dirty_lock);
+	pending = dirty;
+	dirty = 0;
+	pthread_mutex_unlock(&dirty_lock);
+
+	if (pending)
+		save_character();
+}
@@ -0,0 +1,585 @@
+/*
+ * Copyright (c) 2026 Matthias Schmidt <xhr@giessen.ccc.de>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Microbenchmarks for the engine hot paths.  The harness links all objects
+ * except main() and runs against a scratch configuration directory.  Every
+ * benchmark prints one line "name iterations ns/op allocs/op" to stdout,
+ * everything the engine itself prints is discarded.
+ */
+
+#define _GNU_SOURCE
+
+#include <sys/stat.h>
+
+#include <dirent.h>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <json-c/json.h>
+
+#include "isscrolls.h"
+
+struct bench_oracle {
+	const char *name;
+	int code;
+};
+
+static const struct bench_oracle bench_oracles[] = {
+	{ "ironlandernames", ORACLE_IS_NAMES },
+	{ "elfnames", ORACLE_ELF_NAMES },
+	{ "giantnames", ORACLE_GIANT_NAMES },
+	{ "varounames", ORACLE_VAROU_NAMES },
+	{ "trollnames", ORACLE_TROLL_NAMES },
+	{ "action", ORACLE_ACTIONS },
+	{ "theme", ORACLE_THEMES },
+	{ "challengerank", ORACLE_RANKS },
+	{ "combataction", ORACLE_COMBAT_ACTIONS },
+	{ "majorplottwist", ORACLE_PLOT_TWISTS },
+	{ "mysticbacklash", ORACLE_MYSTIC_BACKSLASH },
+	{ "region", ORACLE_REGION },
+	{ "location", ORACLE_LOCATION },
+	{ "coastal", ORACLE_COASTAL },
+	{ "description", ORACLE_DESCRIPTION },
+	{ "paytheprice", ORACLE_PAYTHEPRICE },
+	{ "delveedge", ORACLE_DELVE_THE_DEPTHS_EDGE },
+	{ "delveshadow", ORACLE_DELVE_THE_DEPTHS_SHADOW },
+	{ "delvewits", ORACLE_DELVE_THE_DEPTHS_WITS },
+	{ "delveopportunity", ORACLE_DELVE_OPPORTUNITY },
+	{ "delvedanger", ORACLE_DELVE_DANGER },
+	{ "charrole", ORACLE_CHAR_ROLE },
+	{ "chargoal", ORACLE_CHAR_GOAL },
+	{ "chardesc", ORACLE_CHAR_DESC },
+	{ "chardisposition", ORACLE_CHAR_DISPOSITION },
+	{ "charactivity", ORACLE_CHAR_ACTIVITY },
+	{ "settlementtrouble", ORACLE_SETTLEMENT_TROUBLE },
+};
+
+/* Typical user input: frequent commands, aliases and a miss */
+static const char *bench_commands[] = {
+	"actionroll", "cd", "oracle", "status", "vow", "fulfillvow",
+	"progressroll", "facedanger", "yesno", "notemaybe",
+};
+
+static const int bench_sizes[] = { 1, 100, 10000 };
+
+/* Scaling report: characters, each with SCALE_PER_CHAR vows and notes */
+static const long scale_sizes[] = { 100, 1000, 10000 };
+
+#define BENCH_VOWS	100
+#define BENCH_NOTES	100
+#define SCALE_PER_CHAR	50
+#define SCALE_BUDGET_NS	1000000000ULL
+
+static unsigned long allocs;
+static FILE *out;
+static const char *filter;
+static char scratch[_POSIX_PATH_MAX];
+
+/*
+ * Count allocations by interposing the malloc family.  dlsym() may call
+ * calloc() itself before the real one is known, which is served from a
+ * small static buffer that is never freed.
+ */
+static void *(*real_malloc)(size_t);
+static void *(*real_calloc)(size_t, size_t);
+static void *(*real_realloc)(void *, size_t);
+static void (*real_free)(void *);
+
+static char bootstrap[4096];
+static size_t bootstrap_used;
+static int resolving;
+
+static void
+resolve_allocator(void)
+{
+	resolving = 1;
+	*(void **)&real_malloc = dlsym(RTLD_NEXT, "malloc");
+	*(void **)&real_calloc = dlsym(RTLD_NEXT, "calloc");
+	*(void **)&real_realloc = dlsym(RTLD_NEXT, "realloc");
+	*(void **)&real_free = dlsym(RTLD_NEXT, "free");
+	resolving = 0;
+
+	if (!real_malloc || !real_calloc || !real_realloc || !real_free)
+		_exit(1);
+}
+
+void *
+malloc(size_t size)
+{
+	if (real_malloc == NULL)
+		resolve_allocator();
+	__atomic_add_fetch(&allocs, 1, __ATOMIC_RELAXED);
+	return real_malloc(size);
+}
+
+void *
+calloc(size_t nmemb, size_t size)
+{
+	void *p;
+
+	if (real_calloc == NULL) {
+		if (!resolving)
+			resolve_allocator();
+		else {
+			/* Called from within dlsym() */
+			size = (nmemb * size + 15) & ~(size_t)15;
+			if (bootstrap_used + size > sizeof(bootstrap))
+				return NULL;
+			p = bootstrap + bootstrap_used;
+			bootstrap_used += size;
+			return p;
+		}
+	}
+	__atomic_add_fetch(&allocs, 1, __ATOMIC_RELAXED);
+	return real_calloc(nmemb, size);
+}
+
+void *
+realloc(void *ptr, size_t size)
+{
+	if (real_realloc == NULL)
+		resolve_allocator();
+	__atomic_add_fetch(&allocs, 1, __ATOMIC_RELAXED);
+	return real_realloc(ptr, size);
+}
+
+void
+free(void *ptr)
+{
+	if ((char *)ptr >= bootstrap && (char *)ptr < bootstrap + sizeof(bootstrap))
+		return;
+	if (real_free == NULL)
+		resolve_allocator();
+	real_free(ptr);
+}
+
+/*
+ * Run fn iters times, or when iters is 0 for at least three iterations and
+ * until SCALE_BUDGET_NS passed.  Returns the number of iterations.
+ */
+static long
+measure(void (*fn)(const void *), const void *arg, long iters, uint64_t *ns,
+    unsigned long *a)
+{
+	uint64_t start;
+	long i;
+
+	fflush(stdout);
+	*a = __atomic_load_n(&allocs, __ATOMIC_RELAXED);
+	start = stats_now();
+	for (i = 0; iters == 0 || i < iters; i++) {
+		if (iters == 0 && i >= 3 && stats_now() - start >= SCALE_BUDGET_NS)
+			break;
+		fn(arg);
+	}
+	*ns = stats_now() - start;
+	*a = __atomic_load_n(&allocs, __ATOMIC_RELAXED) - *a;
+	fflush(stdout);
+
+	return i;
+}
+
+static void
+run_bench(const char *name, void (*fn)(const void *), const void *arg,
+    long iters)
+{
+	uint64_t ns;
+	unsigned long a;
+
+	if (filter != NULL && strstr(name, filter) == NULL)
+		return;
+
+	/* Warm up caches and lazily loaded tables */
+	fn(arg);
+
+	iters = measure(fn, arg, iters, &ns, &a);
+	fprintf(out, "%s %ld %.1f %.2f\n", name, iters, (double)ns / iters,
+	    (double)a / iters);
+	fflush(out);
+}
+
+static void
+run_scale(const char *name, void (*fn)(const void *), const void *arg,
+    const struct campaign_size *cs)
+{
+	uint64_t ns;
+	unsigned long a;
+	long iters;
+
+	if (filter != NULL && strstr(name, filter) == NULL)
+		return;
+
+	iters = measure(fn, arg, 0, &ns, &a);
+	fprintf(out, "%s %ld %ld %ld %ld %.1f %.2f\n", name, cs->characters,
+	    cs->vows, cs->notes, iters, (double)ns / iters, (double)a / iters);
+	fflush(out);
+}
+
+static void
+bench_oracle(const void *arg)
+{
+	const struct bench_oracle *o = arg;
+
+	read_oracle_from_json(o->code, 0);
+}
+
+static void
+bench_action_roll(__attribute__((unused)) const void *arg)
+{
+	int args[2] = { 3, -1 };
+
+	action_roll(args);
+}
+
+static void
+bench_progress_roll(__attribute__((unused)) const void *arg)
+{
+	double args[2] = { 5.0, -1 };
+
+	progress_roll(args);
+}
+
+static void
+bench_find_command(__attribute__((unused)) const void *arg)
+{
+	size_t i;
+
+	for (i = 0; i < sizeof(bench_commands) / sizeof(bench_commands[0]); i++)
+		find_command((char *)(uintptr_t)bench_commands[i]);
+}
+
+static void
+bench_save_character(__attribute__((unused)) const void *arg)
+{
+	save_character();
+}
+
+static void
+bench_load_character(__attribute__((unused)) const void *arg)
+{
+	free_character();
+	if (load_character(1) == -1)
+		log_errx(1, "Cannot load benchmark character\n");
+}
+
+static void
+bench_save_vow(__attribute__((unused)) const void *arg)
+{
+	save_vow();
+}
+
+static void
+bench_load_vow(const void *arg)
+{
+	struct character *c = get_current_character();
+	const int *vid = arg;
+
+	c->vow->title = NULL;
+	c->vow->description = NULL;
+
+	if (load_vow(*vid) == -1)
+		log_errx(1, "Cannot load benchmark vow\n");
+}
+
+static void
+bench_save_note(const void *arg)
+{
+	save_note((struct note *)(uintptr_t)arg);
+}
+
+static void
+bench_load_note(const void *arg)
+{
+	const int *nid = arg;
+	struct note n;
+
+	if (load_note(*nid, &n) == -1)
+		log_errx(1, "Cannot load benchmark note\n");
+	free(n.title);
+	free(n.description);
+}
+
+static void
+bench_show_all_vows(__attribute__((unused)) const void *arg)
+{
+	cmd_show_all_vows(NULL);
+}
+
+static void
+write_file(const char *name, const char *content)
+{
+	char path[_POSIX_PATH_MAX];
+	FILE *fp;
+	int ret;
+
+	ret = snprintf(path, sizeof(path), "%s/%s", get_isscrolls_dir(), name);
+	if (ret < 0 || (size_t)ret >= sizeof(path)) {
+		log_errx(1, "Path truncation happened.  Buffer too short to fit %s\n", path);
+	}
+
+	if ((fp = fopen(path, "w")) == NULL)
+		log_errx(1, "Cannot create %s\n", path);
+	fputs(content, fp);
+	fclose(fp);
+}
+
+/*
+ * Create a campaign with n characters.  The first character is written in
+ * its minimal form and saved once through save_character() to get a full
+ * record, which is then cloned for the remaining ids.
+ */
+static void
+setup_campaign(int n)
+{
+	char path[_POSIX_PATH_MAX], name[MAX_CHAR_LEN];
+	json_object *root, *items, *record, *clone;
+	const char *proto;
+	char *copy;
+	int i, ret;
+
+	free_character();
+	write_file("characters.json",
+	    "{\"characters\":[{\"id\":1,\"name\":\"Bench1\"}],\"last_used\":1}");
+	if (load_character(1) == -1)
+		log_errx(1, "Cannot load benchmark character\n");
+	save_character();
+
+	ret = snprintf(path, sizeof(path), "%s/characters.json", get_isscrolls_dir());
+	if (ret < 0 || (size_t)ret >= sizeof(path)) {
+		log_errx(1, "Path truncation happened.  Buffer too short to fit %s\n", path);
+	}
+
+	if ((root = read_json_file(path)) == NULL)
+		log_errx(1, "Cannot read %s\n", path);
+	if (!json_object_object_get_ex(root, "characters", &items))
+		log_errx(1, "Cannot find a [characters] array in %s\n", path);
+
+	record = json_object_array_get_idx(items, 0);
+	if ((copy = strdup(json_object_to_json_string(record))) == NULL)
+		log_errx(1, "strdup\n");
+	proto = copy;
+
+	for (i = 2; i <= n; i++) {
+		if ((clone = json_tokener_parse(proto)) == NULL)
+			log_errx(1, "Cannot clone character record\n");
+		snprintf(name, sizeof(name), "Bench%d", i);
+		json_object_object_add(clone, "id", json_object_new_int(i));
+		json_object_object_add(clone, "name", json_object_new_string(name));
+		json_object_array_add(items, clone);
+	}
+
+	if (write_json_file(path, root))
+		log_errx(1, "Cannot write %s\n", path);
+
+	json_object_put(root);
+	free(copy);
+}
+
+static void
+setup_vows_and_notes(struct note *n)
+{
+	struct character *c = get_current_character();
+	static char title[MAX_NOTE_TITLE];
+	int i;
+
+	c->vow_active = 1;
+	c->vow->difficulty = 3;
+	snprintf(c->vow->description_buf, sizeof(c->vow->description_buf),
+	    "Find the lost heirloom of the clan");
+	c->vow->description = c->vow->description_buf;
+
+	for (i = 1; i <= BENCH_VOWS; i++) {
+		snprintf(c->vow->title_buf, sizeof(c->vow->title_buf), "Vow %d", i);
+		c->vow->title = c->vow->title_buf;
+		c->vow->vid = c->vid = i;
+		save_vow();
+	}
+
+	n->id = c->id;
+	n->title = title;
+	n->description = "A note used by the benchmark harness";
+	for (i = 1; i <= BENCH_NOTES; i++) {
+		snprintf(title, sizeof(title), "Note %d", i);
+		n->nid = i;
+		save_note(n);
+	}
+	n->nid = BENCH_NOTES / 2;
+}
+
+static void
+remove_scratch(void)
+{
+	char path[_POSIX_PATH_MAX];
+	struct dirent *dp;
+	DIR *dirp;
+
+	if ((dirp = opendir(get_isscrolls_dir())) != NULL) {
+		while ((dp = readdir(dirp)) != NULL) {
+			if (dp->d_name[0] == '.')
+				continue;
+			snprintf(path, sizeof(path), "%s/%s", get_isscrolls_dir(),
+			    dp->d_name);
+			unlink(path);
+		}
+		closedir(dirp);
+	}
+	rmdir(get_isscrolls_dir());
+	rmdir(scratch);
+}
+
+/*
+ * Time the operations that scan whole files against generated campaigns
+ * of growing size.
+ */
+static void
+scaling_report(void)
+{
+	struct campaign_size cs;
+	size_t i;
+	int first = 1;
+
+	fprintf(out, "# benchmark characters vows notes iterations ns/op "
+	    "allocs/op\n");
+
+	for (i = 0; i < sizeof(scale_sizes) / sizeof(scale_sizes[0]); i++) {
+		memset(&cs, 0, sizeof(cs));
+		cs.characters = scale_sizes[i];
+		cs.vows = cs.notes = scale_sizes[i] * SCALE_PER_CHAR;
+		cs.journeys = cs.characters / 2;
+		cs.fights = cs.delves = cs.expeditions = cs.characters / 4;
+		cs.seed = 1;
+
+		free_character();
+		generate_campaign(get_isscrolls_dir(), &cs);
+		if (load_character(1) == -1)
+			log_errx(1, "Cannot load generated character\n");
+
+		run_scale("scale/load_character", bench_load_character, NULL, &cs);
+		run_scale("scale/save_character", bench_save_character, NULL, &cs);
+		run_scale("scale/load_vow", bench_load_vow, &first, &cs);
+		run_scale("scale/show_all_vows", bench_show_all_vows, NULL, &cs);
+		run_scale("scale/load_note", bench_load_note, &first, &cs);
+	}
+}
+
+static void
+microbenchmarks(void)
+{
+	char name[64], title[MAX_VOW_TITLE];
+	struct note n;
+	size_t i;
+	long iters;
+	int mid = BENCH_VOWS / 2;
+
+	fprintf(out, "# benchmark iterations ns/op allocs/op\n");
+
+	for (i = 0; i < sizeof(bench_oracles) / sizeof(bench_oracles[0]); i++) {
+		snprintf(name, sizeof(name), "oracle/%s", bench_oracles[i].name);
+		run_bench(name, bench_oracle, &bench_oracles[i], 100000);
+	}
+
+	run_bench("dispatch/find_command", bench_find_command, NULL, 100000);
+
+	for (i = 0; i < sizeof(bench_sizes) / sizeof(bench_sizes[0]); i++) {
+		setup_campaign(bench_sizes[i]);
+		iters = bench_sizes[i] >= 10000 ? 20 : 1000;
+
+		snprintf(name, sizeof(name), "character/save/%d", bench_sizes[i]);
+		run_bench(name, bench_save_character, NULL, iters);
+		snprintf(name, sizeof(name), "character/load/%d", bench_sizes[i]);
+		run_bench(name, bench_load_character, NULL, iters);
+	}
+
+	run_bench("roll/action", bench_action_roll, NULL, 1000000);
+	run_bench("roll/progress", bench_progress_roll, NULL, 1000000);
+
+	setup_vows_and_notes(&n);
+	n.title = title;
+	snprintf(title, sizeof(title), "Note %d", BENCH_NOTES / 2);
+
+	run_bench("vow/save", bench_save_vow, NULL, 1000);
+	run_bench("vow/load", bench_load_vow, &mid, 1000);
+	run_bench("note/save", bench_save_note, &n, 1000);
+	run_bench("note/load", bench_load_note, &mid, 1000);
+}
+
+static __attribute__((noreturn)) void
+usage(void)
+{
+	fprintf(stderr, "usage: isscrolls-bench [-s] [filter]\n");
+	exit(1);
+}
+
+int
+main(int argc, char **argv)
+{
+	int ch, fd, scale = 0;
+
+	while ((ch = getopt(argc, argv, "s")) != -1) {
+		switch (ch) {
+		case 's':
+			scale = 1;
+			break;
+		default:
+			usage();
+		}
+	}
+
+	argc -= optind;
+	argv += optind;
+
+	if (argc > 1)
+		usage();
+	if (argc == 1)
+		filter = argv[0];
+
+	/* Fixed seed so that every run rolls the same dice */
+	srandom(1);
+
+	snprintf(scratch, sizeof(scratch), "/tmp/isscrolls-bench.XXXXXXXX");
+	if (mkdtemp(scratch) == NULL)
+		log_errx(1, "Cannot create scratch directory\n");
+	if (setenv("XDG_CONFIG_HOME", scratch, 1) == -1)
+		log_errx(1, "setenv\n");
+	setup_base_dir();
+
+	/* Results go to the original stdout, engine output is discarded */
+	if ((fd = dup(STDOUT_FILENO)) == -1 || (out = fdopen(fd, "w")) == NULL)
+		log_errx(1, "Cannot duplicate stdout\n");
+	if ((fd = open("/dev/null", O_WRONLY)) == -1)
+		log_errx(1, "Cannot open /dev/null\n");
+	fflush(stdout);
+	dup2(fd, STDOUT_FILENO);
+	close(fd);
+
+	if (scale)
+		scaling_report();
+	else
+		microbenchmarks();
+
+	free_character();
+	remove_scratch();
+	fclose(out);
+
+	return 0;
+}
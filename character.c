@@ -14,9 +14,8 @@
  * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
  */
 
-#include <sys/queue.h>
-
 #include <limits.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -27,13 +26,365 @@
 
 #include "isscrolls.h"
 
-static struct character *curchar = NULL;
-static LIST_HEAD(listhead, entry) head = LIST_HEAD_INITIALIZER(head);
+/*
+ * The loaded character.  It is per thread, so that the simulator's worker
+ * threads can each play their own character through the same functions.
+ */
+static _Thread_local struct character *curchar = NULL;
+
+/*
+ * Characters switched away from with cd are kept in memory together with
+ * their threats, truths and oracle draws, so switching back to one of them
+ * needs no I/O.  The least recently used entry is written back once the
+ * cache is full, the rest on shutdown.
+ */
+#define CHAR_CACHE_SIZE	8
+
+struct cached_character {
+	struct character *c;
+	void *threats;
+	void *truths;
+	void *draws;
+	unsigned long used;
+};
+
+static struct cached_character char_cache[CHAR_CACHE_SIZE];
+static unsigned long cache_clock = 0;
+
+static void stash_current_character(void);
+static int restore_cached_character(int);
+static void write_back_cached_character(struct cached_character *, int);
+static int load_characters_list_json(int *);
+
+/*
+ * Everything a loaded character owns is carved from one allocation, so
+ * loading a character is a single calloc and unloading a single free.  The
+ * character comes first, so its address is the address of the arena.
+ */
+struct character_arena {
+	struct character c;
+	struct journey j;
+	struct fight fight;
+	struct delve delve;
+	struct vow vow;
+	struct expedition expedition;
+	char name[MAX_CHAR_LEN];
+};
+
+static struct character *new_character(void);
+
+#define STRING_FIELD(k, m) \
+	.key = k, .offset = offsetof(struct character, m), .type = FIELD_STRING
+#define INT_FIELD(k, m, mn, mx, d) \
+	.key = k, .offset = offsetof(struct character, m), .type = FIELD_INT, \
+	.min = mn, .max = mx, .def = d
+#define DOUBLE_FIELD(k, m, mn, mx, d) \
+	.key = k, .offset = offsetof(struct character, m), .type = FIELD_DOUBLE, \
+	.min = mn, .max = mx, .def = d
+
+const struct char_field char_fields[] = {
+	{ STRING_FIELD("name", name) },
+	{ INT_FIELD("id", id, 0, INT_MAX, 0) },
+	{ INT_FIELD("vid", vid, -1, INT_MAX, -1) },
+	{ INT_FIELD("edge", edge, 0, 5, 0), .cmd = "edge", .limit = 4,
+	    .row = 1, .fmt = "Edge: %d" },
+	{ INT_FIELD("heart", heart, 0, 5, 0), .cmd = "heart", .limit = 4,
+	    .row = 1, .fmt = " Heart: %d" },
+	{ INT_FIELD("iron", iron, 0, 5, 0), .cmd = "iron", .limit = 4,
+	    .row = 1, .fmt = " Iron: %d" },
+	{ INT_FIELD("shadow", shadow, 0, 5, 0), .cmd = "shadow", .limit = 4,
+	    .row = 1, .fmt = " Shadow: %d" },
+	{ INT_FIELD("wits", wits, 0, 5, 0), .cmd = "wits", .limit = 4,
+	    .row = 1, .fmt = " Wits: %d" },
+	{ INT_FIELD("exp", exp, 0, 30, 0), .cmd = "exp" },
+	{ INT_FIELD("exp_used", exp_used, 0, 30, 0), .cmd = "expspent",
+	    .limit_key = "exp" },
+	{ INT_FIELD("momentum", momentum, -6, 10, 2), .cmd = "momentum",
+	    .limit_key = "max_momentum", .row = 2, .fmt = "Momentum: %d" },
+	{ INT_FIELD("max_momentum", max_momentum, -6, 10, 10),
+	    .row = 2, .fmt = "/%d" },
+	{ INT_FIELD("momentum_reset", momentum_reset, -6, 2, 2),
+	    .row = 2, .fmt = " [%d]" },
+	{ INT_FIELD("health", health, 0, 5, 5), .cmd = "health",
+	    .blocker = "wounded", .row = 2, .fmt = " Health: %d/5" },
+	{ INT_FIELD("spirit", spirit, 0, 5, 5), .cmd = "spirit",
+	    .blocker = "shaken", .row = 2, .fmt = " Spirit: %d/5" },
+	{ INT_FIELD("supply", supply, 0, 5, 5), .cmd = "supply",
+	    .blocker = "unprepared", .row = 2, .fmt = " Supply: %d/5" },
+	{ INT_FIELD("wounded", wounded, 0, 1, 0),
+	    .row = 3, .fmt = "Wounded:\t%d" },
+	{ INT_FIELD("unprepared", unprepared, 0, 1, 0),
+	    .row = 3, .fmt = " Unprepared:\t%d" },
+	{ INT_FIELD("encumbered", encumbered, 0, 1, 0),
+	    .row = 3, .fmt = " Encumbered:\t%d" },
+	{ INT_FIELD("shaken", shaken, 0, 1, 0),
+	    .row = 3, .fmt = " Shaken:\t%d" },
+	{ INT_FIELD("corrupted", corrupted, 0, 1, 0),
+	    .row = 4, .fmt = "Corrupted:\t%d" },
+	{ INT_FIELD("tormented", tormented, 0, 1, 0),
+	    .row = 4, .fmt = " Tormented:\t%d" },
+	{ INT_FIELD("cursed", cursed, 0, 1, 0),
+	    .row = 4, .fmt = " Cursed:\t%d" },
+	{ INT_FIELD("maimed", maimed, 0, 1, 0),
+	    .row = 4, .fmt = " Maimed:\t%d" },
+	{ INT_FIELD("battle_scarred", battle_scarred, 0, 1, 0) },
+	{ INT_FIELD("dead", dead, 0, 1, 0) },
+	{ INT_FIELD("weapon", weapon, 1, 2, 1), .cmd = "weapon" },
+	{ INT_FIELD("strong_hit", strong_hit, 0, 1, 0) },
+	{ DOUBLE_FIELD("bonds", bonds, 0, 5, 0),
+	    .row = 5, .fmt = "Bonds: %.2f" },
+	{ DOUBLE_FIELD("legacy_bonds", legacy_bonds, 0.0, 10.0, 0.0),
+	    .cmd = "legacy_bonds", .step = 0.25, .row = 5, .fmt = " (L: %.2f)" },
+	{ DOUBLE_FIELD("quests", quests, 0.0, 10.0, 0.0), .cmd = "quests",
+	    .step = 0.25, .row = 5, .fmt = " Quests: %.2f" },
+	{ DOUBLE_FIELD("legacy_quests", legacy_quests, 0.0, 10.0, 0.0),
+	    .cmd = "legacy_quests", .row = 5, .fmt = " (L: %.2f)" },
+	{ DOUBLE_FIELD("discoveries", discoveries, 0.0, 10.0, 0.0),
+	    .cmd = "discoveries", .step = 0.25, .row = 5,
+	    .fmt = " Discoveries: %.2f" },
+	{ DOUBLE_FIELD("legacy_discoveries", legacy_discoveries, 0.0, 10.0, 0.0),
+	    .cmd = "legacy_discoveries", .step = 0.25, .row = 5,
+	    .fmt = " (L: %.2f)" },
+	{ DOUBLE_FIELD("failure_track", failure_track, 0.0, 10.0, 0.0),
+	    .cmd = "failure", .step = 0.25 },
+	{ INT_FIELD("journey_active", journey_active, 0, 1, 0) },
+	{ INT_FIELD("fight_active", fight_active, 0, 1, 0) },
+	{ INT_FIELD("delve_active", delve_active, 0, 1, 0) },
+	{ INT_FIELD("vow_active", vow_active, 0, 1, 0) },
+	{ INT_FIELD("expedition_active", expedition_active, 0, 1, 0) },
+	{ INT_FIELD("journaling", journaling, 0, 1, 0) },
+};
+
+#define N_CHAR_FIELDS (sizeof(char_fields) / sizeof(char_fields[0]))
+
+const size_t n_char_fields = N_CHAR_FIELDS;
+
+static int *
+field_int(struct character *c, const struct char_field *f)
+{
+	return (int *)(void *)((char *)c + f->offset);
+}
+
+static double *
+field_double(struct character *c, const struct char_field *f)
+{
+	return (double *)(void *)((char *)c + f->offset);
+}
+
+static char **
+field_string(struct character *c, const struct char_field *f)
+{
+	return (char **)(void *)((char *)c + f->offset);
+}
+
+/*
+ * Find the field for key.  hint is the index to try first and is advanced
+ * past the match, so that walking a saved object in table order costs one
+ * comparison per key.
+ */
+static const struct char_field *
+find_char_field(const char *key, size_t *hint)
+{
+	size_t i;
+
+	if (*hint < N_CHAR_FIELDS && strcmp(char_fields[*hint].key, key) == 0)
+		return &char_fields[(*hint)++];
+
+	for (i = 0; i < N_CHAR_FIELDS; i++) {
+		if (strcmp(char_fields[i].key, key) == 0) {
+			*hint = i + 1;
+			return &char_fields[i];
+		}
+	}
+
+	return NULL;
+}
+
+static const struct char_field *
+find_char_field_cmd(const char *cmd)
+{
+	size_t i;
+
+	for (i = 0; i < N_CHAR_FIELDS; i++) {
+		if (char_fields[i].cmd != NULL &&
+		    strcasecmp(char_fields[i].cmd, cmd) == 0)
+			return &char_fields[i];
+	}
+
+	return NULL;
+}
+
+static int
+char_field_value(struct character *c, const char *key)
+{
+	const struct char_field *f;
+	size_t hint = 0;
+
+	if ((f = find_char_field(key, &hint)) == NULL || f->type != FIELD_INT)
+		log_errx(1, "No integer character field %s\n", key);
+
+	return *field_int(c, f);
+}
+
+static void
+set_character_defaults(struct character *c)
+{
+	const struct char_field *f;
+
+	for (f = char_fields; f < char_fields + N_CHAR_FIELDS; f++) {
+		switch (f->type) {
+		case FIELD_INT:
+			*field_int(c, f) = f->def;
+			break;
+		case FIELD_DOUBLE:
+			*field_double(c, f) = f->def;
+			break;
+		case FIELD_STRING:
+			break;
+		}
+	}
+}
+
+static void
+load_char_field(struct character *c, const struct char_field *f,
+	json_object *val)
+{
+	switch (f->type) {
+	case FIELD_INT:
+		*field_int(c, f) = check_int_range(f->key,
+			json_object_get_int(val), f->min, f->max, f->def);
+		break;
+	case FIELD_DOUBLE:
+		*field_double(c, f) = check_double_range(f->key,
+			json_object_get_double(val), f->min, f->max, f->def);
+		break;
+	case FIELD_STRING:
+		snprintf(*field_string(c, f), MAX_CHAR_LEN, "%s",
+			json_object_get_string(val));
+		break;
+	}
+}
+
+static json_object *
+char_field_to_json(struct character *c, const struct char_field *f)
+{
+	switch (f->type) {
+	case FIELD_INT:
+		return json_object_new_int(*field_int(c, f));
+	case FIELD_DOUBLE:
+		return json_object_new_double(*field_double(c, f));
+	case FIELD_STRING:
+		return json_object_new_string(*field_string(c, f));
+	}
+
+	return NULL;
+}
+
+/* Fill c from a characters.json entry, missing keys get their default */
+void
+character_from_json(struct character *c, json_object *obj)
+{
+	struct json_object_iterator it, end;
+	const struct char_field *f;
+	const char *key;
+	size_t hint;
+
+	set_character_defaults(c);
+	c->generation = 0;
+
+	/* Single pass over the keys, unknown ones are skipped */
+	it = json_object_iter_begin(obj);
+	end = json_object_iter_end(obj);
+	for (hint = 0; !json_object_iter_equal(&it, &end);
+	    json_object_iter_next(&it)) {
+		key = json_object_iter_peek_name(&it);
+		/* Bookkeeping of save_character(), not part of the schema */
+		if (strcmp(key, "generation") == 0) {
+			c->generation = (uint64_t)json_object_get_int64(
+			    json_object_iter_peek_value(&it));
+			continue;
+		}
+		if ((f = find_char_field(key, &hint)) == NULL) {
+			log_debug("Unknown character field %s\n", key);
+			continue;
+		}
+		load_char_field(c, f, json_object_iter_peek_value(&it));
+	}
+}
+
+/* Does the characters.json entry obj hold exactly what c holds? */
+static int
+saved_character_matches(struct character *c, json_object *obj)
+{
+	const struct char_field *f;
+	json_object *val;
+	uint64_t gen = 0;
+
+	/* Entries saved before generations existed have 0 */
+	if (json_object_object_get_ex(obj, "generation", &val))
+		gen = (uint64_t)json_object_get_int64(val);
+	if (gen != c->generation)
+		return 0;
+
+	for (f = char_fields; f < char_fields + N_CHAR_FIELDS; f++) {
+		if (!json_object_object_get_ex(obj, f->key, &val))
+			return 0;
+
+		switch (f->type) {
+		case FIELD_INT:
+			if (json_object_get_int(val) != *field_int(c, f))
+				return 0;
+			break;
+		case FIELD_DOUBLE:
+			if (json_object_get_double(val) != *field_double(c, f))
+				return 0;
+			break;
+		case FIELD_STRING:
+			if (strcmp(json_object_get_string(val),
+			    *field_string(c, f)) != 0)
+				return 0;
+			break;
+		}
+	}
+
+	return 1;
+}
+
+json_object *
+character_to_json(struct character *c)
+{
+	const struct char_field *f;
+	json_object *cobj;
+
+	if ((cobj = json_object_new_object()) == NULL)
+		log_errx(1, "Cannot create JSON object\n");
+
+	for (f = char_fields; f < char_fields + N_CHAR_FIELDS; f++)
+		json_object_object_add(cobj, f->key, char_field_to_json(c, f));
+
+	return cobj;
+}
+
+static void
+print_char_row(int row, const char *before, const char *after)
+{
+	const struct char_field *f;
+
+	printf("%s", before);
+	for (f = char_fields; f < char_fields + N_CHAR_FIELDS; f++) {
+		if (f->row != row)
+			continue;
+		if (f->type == FIELD_DOUBLE)
+			printf(f->fmt, *field_double(curchar, f));
+		else
+			printf(f->fmt, *field_int(curchar, f));
+	}
+	printf("%s", after);
+}
 
 void
 cmd_create_character(char *name)
 {
-	struct entry *e;
 	struct character *c;
 	char p[MAX_PROMPT_LEN];
 
@@ -42,38 +393,32 @@ cmd_create_character(char *name)
 		return;
 	}
 
-	/* There is already a character loaded, so save and free it */
+	log_debug("Attempt to create a character named %s\n", name);
+	if ((c = create_character(name)) == NULL)
+		return;
+
+	/* There is already a character loaded, so move it to the cache */
 	if (curchar != NULL) {
-		save_character();
-		free_character();
-		curchar = NULL;
-		close_journal_file();
+		autosave_barrier();
+		stash_current_character();
 	}
 
-	log_debug("Attempt to create a character named %s\n", name);
-	if ((c = create_character(name)) != NULL) {
-		curchar = c;
-		print_character();
-		snprintf(p, sizeof(p), "%s > ", c->name);
-		set_prompt(p);
-
-		if ((e = malloc(sizeof(struct entry))) == NULL)
-			log_errx(1, "cannot allocate memory\n");
+	curchar = c;
+	print_character();
+	snprintf(p, sizeof(p), "%s > ", c->name);
+	set_prompt(p);
 
-		e->id = c->id;
-		snprintf(e->name, sizeof(e->name), "%s", c->name);
-		LIST_INSERT_HEAD(&head, e, entries);
-	}
+	roster_add(c->id, c->name);
+	mark_dirty();
 }
 
 void
 cmd_ls(__attribute__((unused)) char *unused)
 {
-	struct entry *np;
+	size_t i;
 
-	LIST_FOREACH(np, &head, entries) {
-		printf("%s\n", np->name);
-	}
+	for (i = 0; i < roster_count(); i++)
+		printf("%s\n", roster_name_at(i));
 }
 
 void
@@ -85,27 +430,20 @@ cmd_save(__attribute__((unused)) char *unused)
 void
 cmd_delete_character(__attribute__((unused)) char *unused)
 {
-	struct entry *np = NULL;
+	int id;
 
 	CURCHAR_CHECK();
 
-	/* Save list entry of the to be deleted char in np */
-	LIST_FOREACH(np, &head, entries) {
-		if (np->id == curchar->id)
-			break;
-	}
-
-	delete_saved_character(curchar->id);
+	id = curchar->id;
+	delete_saved_character(id);
 
 	free_character();
 	curchar = NULL;
 	close_journal_file();
 
-	if (np != NULL) {
-		LIST_REMOVE(np, entries);
-		free(np);
-	} else
+	if (!roster_contains(id))
 		log_debug("Found a list entry but cannot delete it\n");
+	roster_remove(id);
 
 	set_prompt("> ");
 }
@@ -117,6 +455,239 @@ cmd_cds(char *character)
 	cmd_show_all_vows(NULL);
 }
 
+static void
+detach_current_character(struct cached_character *e)
+{
+	e->c = curchar;
+	e->threats = detach_threats();
+	e->truths = detach_truths();
+	e->draws = detach_draws();
+	e->used = ++cache_clock;
+
+	curchar = NULL;
+	close_journal_file();
+}
+
+static void
+attach_cached_character(struct cached_character *e)
+{
+	curchar = e->c;
+	attach_threats(e->threats);
+	attach_truths(e->truths);
+	attach_draws(e->draws);
+
+	memset(e, 0, sizeof(*e));
+}
+
+/*
+ * Save a cached character and release it.  If unset is set, the character is
+ * not left behind as the last used one.
+ */
+static void
+write_back_cached_character(struct cached_character *e, int unset)
+{
+	log_debug("Write back cached character %s\n", e->c->name);
+
+	attach_cached_character(e);
+	save_character();
+	if (unset)
+		unset_last_loaded_character();
+	free_character();
+}
+
+static void
+stash_current_character(void)
+{
+	struct cached_character temp, *slot = NULL;
+	size_t i;
+
+	if (curchar == NULL)
+		return;
+
+	detach_current_character(&temp);
+
+	for (i = 0; i < CHAR_CACHE_SIZE; i++) {
+		if (char_cache[i].c == NULL) {
+			slot = &char_cache[i];
+			break;
+		}
+		if (slot == NULL || char_cache[i].used < slot->used)
+			slot = &char_cache[i];
+	}
+
+	if (slot->c != NULL)
+		write_back_cached_character(slot, 0);
+
+	log_debug("Keep character %s in the cache\n", temp.c->name);
+	*slot = temp;
+}
+
+static int
+restore_cached_character(int id)
+{
+	size_t i;
+
+	for (i = 0; i < CHAR_CACHE_SIZE; i++) {
+		if (char_cache[i].c != NULL && char_cache[i].c->id == id)
+			break;
+	}
+
+	if (i == CHAR_CACHE_SIZE)
+		return -1;
+
+	log_debug("Switch to cached character %s\n", char_cache[i].c->name);
+	attach_cached_character(&char_cache[i]);
+	update_prompt();
+	print_character();
+
+	return 0;
+}
+
+/*
+ * Write back all cached characters.  The current character, if any, is put
+ * aside meanwhile and stays loaded.
+ */
+void
+flush_character_cache(void)
+{
+	struct cached_character cur;
+	size_t i, left = 0;
+
+	for (i = 0; i < CHAR_CACHE_SIZE; i++) {
+		if (char_cache[i].c != NULL)
+			left++;
+	}
+
+	if (left == 0)
+		return;
+
+	memset(&cur, 0, sizeof(cur));
+	if (curchar != NULL)
+		detach_current_character(&cur);
+
+	for (i = 0; i < CHAR_CACHE_SIZE; i++) {
+		if (char_cache[i].c == NULL)
+			continue;
+		/* Without a current character nobody is last used */
+		write_back_cached_character(&char_cache[i],
+		    cur.c == NULL && --left == 0);
+	}
+
+	if (cur.c != NULL)
+		attach_cached_character(&cur);
+}
+
+/* Drop a cached character without writing it back */
+static void
+discard_cached_character(struct cached_character *e)
+{
+	struct cached_character cur;
+
+	memset(&cur, 0, sizeof(cur));
+	if (curchar != NULL)
+		detach_current_character(&cur);
+
+	attach_cached_character(e);
+	free_character();
+
+	if (cur.c != NULL)
+		attach_cached_character(&cur);
+}
+
+/* Save a cached character and keep it in the cache */
+static void
+save_cached_character(struct cached_character *e)
+{
+	struct cached_character cur;
+	unsigned long used = e->used;
+
+	memset(&cur, 0, sizeof(cur));
+	if (curchar != NULL)
+		detach_current_character(&cur);
+
+	attach_cached_character(e);
+	save_character();
+	detach_current_character(e);
+	e->used = used;
+
+	if (cur.c != NULL)
+		attach_cached_character(&cur);
+}
+
+/* Another process saved the character after we loaded or saved it */
+static int
+character_is_stale(const struct character *c)
+{
+	return roster_contains(c->id) && roster_generation(c->id) != c->generation;
+}
+
+/*
+ * Pick up what other isscrolls processes sharing the directory saved since
+ * the last command.  The list of characters is read again, but only the
+ * loaded characters somebody else saved in the meantime are reloaded.  A
+ * loaded character with changes not saved yet is saved instead, its
+ * changes win.  Loaded characters that are not saved yet stay in the list.
+ */
+void
+sync_campaign(void)
+{
+	struct cached_character *e;
+	int id, last_id = -1;
+	size_t i;
+	CAMPAIGN_LOCK();
+
+	if (!campaign_changed())
+		return;
+
+	log_debug("The campaign was changed by another process\n");
+
+	roster_clear();
+	if (use_snapshot())
+		snapshot_load_list(add_list_entry, &last_id);
+	else
+		load_characters_list_json(&last_id);
+	campaign_synced();
+
+	for (i = 0; i < CHAR_CACHE_SIZE; i++) {
+		e = &char_cache[i];
+		if (e->c == NULL)
+			continue;
+
+		if (character_is_stale(e->c) && e->c->changed) {
+			log_debug("Keep the changes of cached character %s\n",
+			    e->c->name);
+			save_cached_character(e);
+		} else if (character_is_stale(e->c)) {
+			log_debug("Drop stale cached character %s\n", e->c->name);
+			discard_cached_character(e);
+		} else if (!roster_contains(e->c->id))
+			roster_add(e->c->id, e->c->name);
+	}
+
+	if (curchar == NULL)
+		return;
+
+	/*
+	 * Changes not saved yet are saved now rather than lost.  Whatever the
+	 * other process saved is overwritten, as if it had saved first.
+	 */
+	if (character_is_stale(curchar) && curchar->changed) {
+		printf("%s was changed by another isscrolls, keeping your "
+		    "changes\n", curchar->name);
+		autosave_barrier();
+		if (curchar->changed)
+			save_character();
+	} else if (character_is_stale(curchar)) {
+		printf("%s was changed by another isscrolls, reloading\n",
+		    curchar->name);
+		id = curchar->id;
+		free_character();
+		if (load_character(id) == -1)
+			set_prompt("> ");
+	} else if (!roster_contains(curchar->id))
+		roster_add(curchar->id, curchar->name);
+}
+
 void
 cmd_cd(char *character)
 {
@@ -140,31 +711,32 @@ cmd_cd(char *character)
 		printf("You currently have the following characters:\n");
 		cmd_ls(NULL);
 		return;
-	} else if (strlen(character) != 0 && curchar == NULL) {
-		/* We got an argument and there is no character loaded */
+	} else {
+		/* We got an argument, a loaded character goes into the cache */
 		id = return_character_id(character);
-		if (id != -1) {
-			if (load_character(id) == -1) {
-				log_debug("No character object for %s with ID %d\n", character, id);
-				return;
-			}
-		} else
+		if (id == -1) {
 			printf("No character named %s found.\n", character);
-	} else if (strlen(character) != 0 && curchar != NULL) {
-		/* We got an argument and there is a character loaded */
-		id = return_character_id(character);
-		if (id != -1) {
-			save_character();
-			free_character();
-			curchar = NULL;
-			close_journal_file();
+			return;
+		}
 
-			if (load_character(id) == -1) {
-				log_debug("No character object for %s with ID %d\n", character, id);
-				return;
-			}
-		} else
-			printf("No character named %s found.\n", character);
+		if (curchar != NULL && curchar->id == id) {
+			print_character();
+			return;
+		}
+
+		/* Write pending changes before the character goes to the cache */
+		if (curchar != NULL) {
+			autosave_barrier();
+			stash_current_character();
+		}
+
+		if (restore_cached_character(id) == 0)
+			return;
+
+		if (load_character(id) == -1) {
+			log_debug("No character object for %s with ID %d\n", character, id);
+			return;
+		}
 	}
 }
 
@@ -264,6 +836,7 @@ cmd_learn_from_your_failures(__attribute__((unused)) char *unused)
 	}
 
 	curchar->failure_track = 0.0;
+	mark_dirty();
 	printf("Failure track reset\n");
 }
 
@@ -303,11 +876,16 @@ update_prompt(void)
 	char d[MAX_PROMPT_LEN];
 	char v[MAX_PROMPT_LEN];
 	char e[MAX_PROMPT_LEN];
+	char n[MAX_FOE_NAME + 2];
 	char i[5];
+	struct foe *foe;
 
 	CURCHAR_CHECK();
 
-	j[0] = f[0] = d[0] = i[0] = v[0] = e[0] = '\0';
+	if (get_quiet())
+		return;
+
+	j[0] = f[0] = d[0] = i[0] = v[0] = e[0] = n[0] = '\0';
 
 	/* Only show the vow's title in color mode.  Less noise for braille
 	 * displays and screen readers */
@@ -359,15 +937,20 @@ update_prompt(void)
 	}
 
 	if (curchar->fight_active) {
+		foe = fight_target(curchar->fight);
 		if (curchar->fight->initiative)
 			snprintf(i, 5, "%s", " [I]");
 
-		if (curchar->fight->difficulty < 4)
-			snprintf(f, sizeof(f), "Fight %.0f%s > ",
-				curchar->fight->progress, i);
+		/* With several foes, show the one moves are made against */
+		if (curchar->fight->n_foes > 1)
+			snprintf(n, sizeof(n), "%s ", foe->name);
+
+		if (foe->difficulty < 4)
+			snprintf(f, sizeof(f), "Fight %s%.0f%s > ", n,
+				foe->progress, i);
 		else
-			snprintf(f, sizeof(f), "Fight %.2f%s > ",
-				curchar->fight->progress, i);
+			snprintf(f, sizeof(f), "Fight %s%.2f%s > ", n,
+				foe->progress, i);
 	}
 
 	snprintf(p, sizeof(p), "%s%s > %s%s%s%s", curchar->name, v, j, e, d, f);
@@ -384,6 +967,7 @@ toggle_value(const char *desc, int *value)
 
 	pm(DEFAULT, "Toggle %s from %d to %d\n", desc, *value, new);
 	*value = new;
+	mark_dirty();
 }
 
 void
@@ -410,6 +994,7 @@ set_max_momentum(void)
 		pm(DEFAULT, "Your max momentum changed from %d to %d\n",
 			curchar->max_momentum, mm);
 		curchar->max_momentum = mm;
+		mark_dirty();
 	}
 
 	/* Reset momentum is +2 and reduced by 1 for each debility.  It cannot fall
@@ -425,6 +1010,7 @@ set_max_momentum(void)
 		pm(DEFAULT, "Your reset momentum changed from %d to %d\n",
 			curchar->momentum_reset, mm);
 		curchar->momentum_reset = mm;
+		mark_dirty();
 	}
 
 }
@@ -433,6 +1019,8 @@ void
 change_char_value(const char *value, int what, int howmany)
 {
 	const char *event[2] = { "increase", "decrease" };
+	const struct char_field *f;
+	int max;
 
 	CURCHAR_CHECK();
 
@@ -441,85 +1029,15 @@ change_info:
 		printf("Please specify the value you want to %s\n", event[what]);
 		printf("\nExample: %s wits - %s 'wits' by 1\n", event[what], event[what]);
 		printf("\nYou can change the following values:\n\n");
-		printf("- Edge\n- Heart\n- Iron\n- Shadow\n- Wits\n- Momentum\n- Health\n- Spirit\n");
-		printf("- Supply\n- Exp\n- expspent\n- Weapon\n- Quests\n- Discoveries\n");
-		printf("- Legacy_bonds\n- Legacy_quests\n- Legacy_iscoveries\n");
+		for (f = char_fields; f < char_fields + N_CHAR_FIELDS; f++) {
+			if (f->cmd != NULL)
+				printf("- %s\n", f->cmd);
+		}
+		printf("- progress\n");
 		return;
 	}
 
-	if (strcasecmp(value, "edge") == 0) {
-		modify_value(value, &curchar->edge, 4, 0, howmany, what);
-		return;
-	} else if (strcasecmp(value, "heart") == 0) {
-		modify_value(value, &curchar->heart, 4, 0, howmany, what);
-		return;
-	} else if (strcasecmp(value, "iron") == 0) {
-		modify_value(value, &curchar->iron, 4, 0, howmany, what);
-		return;
-	} else if (strcasecmp(value, "shadow") == 0) {
-		modify_value(value, &curchar->shadow, 4, 0, howmany, what);
-		return;
-	} else if (strcasecmp(value, "wits") == 0) {
-		modify_value(value, &curchar->wits, 4, 0, howmany, what);
-		return;
-	} else if (strcasecmp(value, "exp") == 0) {
-		modify_value(value, &curchar->exp, 30, 0, howmany, what);
-		return;
-	} else if (strcasecmp(value, "expspent") == 0) {
-		modify_value(value, &curchar->exp_used, curchar->exp, 0, howmany, what);
-		return;
-	} else if (strcasecmp(value, "weapon") == 0) {
-		modify_value(value, &curchar->weapon, 2, 1, howmany, what);
-		return;
-	} else if (strcasecmp(value, "failure") == 0) {
-		modify_double(value, &curchar->failure_track, 10.0, 0.0, 0.25, what);
-		return;
-	} else if (strcasecmp(value, "quests") == 0) {
-		modify_double(value, &curchar->quests, 10.0, 0.0, 0.25, what);
-		return;
-	} else if (strcasecmp(value, "discoveries") == 0) {
-		modify_double(value, &curchar->discoveries, 10.0, 0.0, 0.25, what);
-		return;
-	} else if (strcasecmp(value, "legacy_quests") == 0) {
-		modify_double(value, &curchar->legacy_quests, 10.0, 0.0, howmany, what);
-		return;
-	} else if (strcasecmp(value, "legacy_bonds") == 0) {
-		modify_double(value, &curchar->legacy_bonds, 10.0, 0.0, 0.25, what);
-		return;
-	} else if (strcasecmp(value, "legacy_discoveries") == 0) {
-		modify_double(value, &curchar->legacy_discoveries, 10.0, 0.0, 0.25, what);
-		return;
-	} else if (strcasecmp(value, "momentum") == 0) {
-		if (curchar->momentum == -6 && what == DECREASE) {
-			printf("You cannot decrease your momentum since you're at the minimum\n");
-			printf("You must roll the \'Face a Setback\' move\n");
-			return;
-		}
-		modify_value(value, &curchar->momentum, curchar->max_momentum, -6,
-			howmany, what);
-		return;
-	} else if (strcasecmp(value, "health") == 0) {
-		if (curchar->wounded) {
-			printf("You are wounded, you cannot increase health\n");
-			return;
-		}
-		modify_value(value, &curchar->health, 5, 0, howmany, what);
-		return;
-	} else if (strcasecmp(value, "spirit") == 0) {
-		if (curchar->shaken) {
-			printf("You are shaken, you cannot increase spirit\n");
-			return;
-		}
-		modify_value(value, &curchar->spirit, 5, 0, howmany, what);
-		return;
-	} else if (strcasecmp(value, "supply") == 0) {
-		if (curchar->unprepared) {
-			printf("You are unprepared, you cannot increase supply\n");
-			return;
-		}
-		modify_value(value, &curchar->supply, 5, 0, howmany, what);
-		return;
-	} else if (strcasecmp(value, "progress") == 0) {
+	if (strcasecmp(value, "progress") == 0) {
 		/* Order of increasing progress is as follows:
 		 *
 		 * fight > delve > journey
@@ -536,16 +1054,62 @@ change_info:
 		}
 		if (curchar->journey_active)
 			mark_journey_progress(what);
-	} else {
+		return;
+	}
+
+	if ((f = find_char_field_cmd(value)) == NULL)
 		goto change_info;
+
+	if (f->blocker != NULL && char_field_value(curchar, f->blocker)) {
+		pm(NO_JOURNAL, "You are %s, you cannot increase %s\n", f->blocker, f->cmd);
+		return;
 	}
 
+	if (f->type == FIELD_DOUBLE) {
+		modify_double(value, field_double(curchar, f),
+			f->limit != 0 ? f->limit : f->max, f->min,
+			f->step != 0 ? f->step : howmany, what);
+		return;
+	}
+
+	if (f->limit_key != NULL)
+		max = char_field_value(curchar, f->limit_key);
+	else
+		max = f->limit != 0 ? f->limit : f->max;
+
+	if (*field_int(curchar, f) == f->min && what == DECREASE &&
+	    strcmp(f->key, "momentum") == 0) {
+		pm(NO_JOURNAL, "You cannot decrease your momentum since you're at the minimum\n");
+		pm(NO_JOURNAL, "You must roll the \'Face a Setback\' move\n");
+		return;
+	}
+
+	modify_value(value, field_int(curchar, f), max, f->min, howmany, what);
+}
+
+/* Tell the event sinks that value str changed */
+static void
+emit_change(const char *str, double from, double to, int is_double)
+{
+	struct event ev;
+
+	memset(&ev, 0, sizeof(ev));
+	ev.type = EVENT_CHANGE;
+	ev.change.what = str;
+	ev.change.from = from;
+	ev.change.to = to;
+	ev.change.is_double = is_double;
+
+	emit_event(&ev);
+	mark_dirty();
 }
 
 void
 modify_value(const char *str, int *value, int max, int min, int howmany,
 	int what)
 {
+	int from = *value;
+
 	if (what == 0) {
 		if (*value >= max)
 			return;
@@ -553,8 +1117,6 @@ modify_value(const char *str, int *value, int max, int min, int howmany,
 			*value = max;
 		else
 			*value += howmany;
-
-		pm(DEFAULT, "Increasing %s from %d to %d\n", str, *value - howmany, *value);
 	} else {
 		if (*value <= min)
 			return;
@@ -562,14 +1124,17 @@ modify_value(const char *str, int *value, int max, int min, int howmany,
 			*value = min;
 		else
 			*value -= howmany;
-		pm(DEFAULT, "Decreasing %s from %d to %d\n", str, *value + howmany, *value);
 	}
+
+	emit_change(str, from, *value, 0);
 }
 
 void
 modify_double(const char *str, double *value, double max, double min, double howmany,
 	int what)
 {
+	double from = *value;
+
 	if (what == 0) {
 		if (*value >= max)
 			return;
@@ -577,9 +1142,6 @@ modify_double(const char *str, double *value, double max, double min, double how
 			*value = max;
 		else
 			*value += howmany;
-
-		if (get_output())
-			pm(DEFAULT,"Increasing %s from %.2f to %.2f\n", str, *value - howmany, *value);
 	} else {
 		if (*value <= min)
 			return;
@@ -587,39 +1149,44 @@ modify_double(const char *str, double *value, double max, double min, double how
 			*value = min;
 		else
 			*value -= howmany;
-		if (get_output())
-			pm(DEFAULT,"Decreasing %s from %.2f to %.2f\n", str, *value + howmany, *value);
 	}
+
+	emit_change(str, from, *value, 1);
 }
 
 int
 return_character_id(const char *name)
 {
-	struct entry *np;
-	int id = -1;
-
-	LIST_FOREACH(np, &head, entries) {
-		if (strcasecmp(np->name, name) == 0) {
-			id = np->id;
-		}
-	}
-
-	return id;
+	return roster_find_name(name);
 }
 
 void
 save_current_character(void)
 {
+	flush_character_cache();
 	save_character();
 }
 
+/* Give the character the generation the campaign gets with this save */
+static json_object *
+stamp_character(json_object *cobj)
+{
+	curchar->generation = campaign_write_generation();
+	json_object_object_add(cobj, "generation",
+	    json_object_new_int64((int64_t)curchar->generation));
+
+	return cobj;
+}
+
 void
 save_character(void)
 {
 	char path[_POSIX_PATH_MAX];
-	json_object *root, *items;
+	json_object *root, *items, *lid;
 	size_t temp_n, i;
-	int ret;
+	int ret, last_used = 0;
+	TRACE_FUNC("save");
+	CAMPAIGN_LOCK();
 
 	if (curchar == NULL) {
 		log_debug("Nothing to save here\n");
@@ -631,87 +1198,47 @@ save_character(void)
 	save_delve();
 	save_expedition();
 	save_vow();
+	save_threats();
+	save_truths();
+	save_draws();
+
+	/*
+	 * The files written above have no generation of their own.  A change
+	 * to any of them gives the character record a new one, so that other
+	 * processes reload all of the character and not only the record.
+	 */
+	if (use_snapshot()) {
+		if (!curchar->changed && snapshot_character_saved(curchar)) {
+			log_debug("%s is unchanged\n", curchar->name);
+			return;
+		}
+		curchar->generation = campaign_write_generation();
+		if (snapshot_save_character(curchar) == -1)
+			printf("Error saving character %s\n", curchar->name);
+		else
+			curchar->changed = 0;
+		return;
+	}
+
+	json_object *cobj = character_to_json(curchar);
 
-	json_object *cobj = json_object_new_object();
-	json_object_object_add(cobj, "name", json_object_new_string(curchar->name));
-	json_object_object_add(cobj, "id", json_object_new_int(curchar->id));
-	json_object_object_add(cobj, "vid", json_object_new_int(curchar->vid));
-	json_object_object_add(cobj, "edge", json_object_new_int(curchar->edge));
-	json_object_object_add(cobj, "heart", json_object_new_int(curchar->heart));
-	json_object_object_add(cobj, "iron", json_object_new_int(curchar->iron));
-	json_object_object_add(cobj, "shadow", json_object_new_int(curchar->shadow));
-	json_object_object_add(cobj, "wits", json_object_new_int(curchar->wits));
-	json_object_object_add(cobj, "exp", json_object_new_int(curchar->exp));
-	json_object_object_add(cobj, "momentum",
-		json_object_new_int(curchar->momentum));
-	json_object_object_add(cobj, "max_momentum",
-		json_object_new_int(curchar->max_momentum));
-	json_object_object_add(cobj, "momentum_reset",
-		json_object_new_int(curchar->momentum_reset));
-	json_object_object_add(cobj, "health", json_object_new_int(curchar->health));
-	json_object_object_add(cobj, "spirit", json_object_new_int(curchar->spirit));
-	json_object_object_add(cobj, "supply", json_object_new_int(curchar->supply));
-	json_object_object_add(cobj, "wounded",
-		json_object_new_int(curchar->wounded));
-	json_object_object_add(cobj, "unprepared",
-		json_object_new_int(curchar->unprepared));
-	json_object_object_add(cobj, "shaken",
-			json_object_new_int(curchar->shaken));
-	json_object_object_add(cobj, "encumbered",
-		json_object_new_int(curchar->encumbered));
-	json_object_object_add(cobj, "maimed", json_object_new_int(curchar->maimed));
-	json_object_object_add(cobj, "battle_scarred", json_object_new_int(curchar->battle_scarred));
-	json_object_object_add(cobj, "cursed", json_object_new_int(curchar->cursed));
-	json_object_object_add(cobj, "dead", json_object_new_int(curchar->dead));
-	json_object_object_add(cobj, "weapon", json_object_new_int(curchar->weapon));
-	json_object_object_add(cobj, "strong_hit", json_object_new_int(curchar->strong_hit));
-	json_object_object_add(cobj, "corrupted",
-		json_object_new_int(curchar->corrupted));
-	json_object_object_add(cobj, "tormented",
-		json_object_new_int(curchar->tormented));
-	json_object_object_add(cobj, "exp_used",
-		json_object_new_int(curchar->exp_used));
-	json_object_object_add(cobj, "bonds",
-		json_object_new_double(curchar->bonds));
-	json_object_object_add(cobj, "failure_track",
-		json_object_new_double(curchar->failure_track));
-	json_object_object_add(cobj, "legacy_bonds",
-		json_object_new_double(curchar->legacy_bonds));
-	json_object_object_add(cobj, "legacy_discoveries",
-		json_object_new_double(curchar->legacy_discoveries));
-	json_object_object_add(cobj, "legacy_quests",
-		json_object_new_double(curchar->legacy_quests));
-	json_object_object_add(cobj, "journey_active",
-		json_object_new_int(curchar->journey_active));
-	json_object_object_add(cobj, "fight_active",
-		json_object_new_int(curchar->fight_active));
-	json_object_object_add(cobj, "delve_active",
-		json_object_new_int(curchar->delve_active));
-	json_object_object_add(cobj, "vow_active",
-		json_object_new_int(curchar->vow_active));
-	json_object_object_add(cobj, "expedition_active",
-		json_object_new_int(curchar->expedition_active));
-	json_object_object_add(cobj, "journaling",
-		json_object_new_int(curchar->journaling));
-
-	json_object_object_add(cobj, "quests",
-		json_object_new_double(curchar->quests));
-	json_object_object_add(cobj, "discoveries",
-		json_object_new_double(curchar->discoveries));
+	/* Tells other processes whether their copy of the character is stale */
+	json_object_object_add(cobj, "generation",
+	    json_object_new_int64((int64_t)curchar->generation));
 
 	ret = snprintf(path, sizeof(path), "%s/characters.json", get_isscrolls_dir());
 	if (ret < 0 || (size_t)ret >= sizeof(path)) {
 		log_errx(1, "Path truncation happened.  Buffer too short to fit %s\n", path);
 	}
 
-	if ((root = json_object_from_file(path)) == NULL) {
+	if ((root = read_json_file(path)) == NULL) {
 		log_debug("No character JSON file found (%s)\n", path);
 		root = json_object_new_object();
 		if (!root)
 			log_errx(1, "Cannot create JSON object\n");
 
 		items = json_object_new_array();
-		json_object_array_add(items, cobj);
+		json_object_array_add(items, stamp_character(cobj));
 		json_object_object_add(root, "characters", items);
 		json_object_object_add(root, "last_used", json_object_new_int(curchar->id));
 	} else {
@@ -722,6 +1249,8 @@ save_character(void)
 			json_object_object_add(root, "characters", items);
 		}
 
+		if (json_object_object_get_ex(root, "last_used", &lid))
+			last_used = json_object_get_int(lid);
 		json_object_object_add(root, "last_used", json_object_new_int(curchar->id));
 
 		temp_n = json_object_array_length(items);
@@ -730,21 +1259,34 @@ save_character(void)
 			json_object *id;
 			json_object_object_get_ex(temp, "id", &id);
 			if (curchar->id == json_object_get_int(id)) {
+				/* Other processes have nothing to reload if the
+				 * character is the same as the saved one */
+				if (!curchar->changed &&
+				    saved_character_matches(curchar, temp)) {
+					json_object_put(cobj);
+					if (last_used != curchar->id)
+						goto out;
+					log_debug("%s is unchanged\n", curchar->name);
+					json_object_put(root);
+					return;
+				}
 				log_debug("Update character entry for %s\n", curchar->name);
 				json_object_array_del_idx(items, i, 1);
-				json_object_array_add(items, cobj);
+				json_object_array_add(items, stamp_character(cobj));
 				goto out;
 			}
 		}
 		log_debug("No entry for %s found, adding new one\n", curchar->name);
-		json_object_array_add(items, cobj);
+		json_object_array_add(items, stamp_character(cobj));
 	}
 
 out:
-	if (json_object_to_file(path, root))
+	if (write_json_file(path, root))
 		printf("Error saving %s\n", path);
-	else
+	else {
 		log_debug("Successfully saved %s\n", path);
+		curchar->changed = 0;
+	}
 
 	json_object_put(root);
 }
@@ -755,24 +1297,30 @@ unset_last_loaded_character(void)
 	char path[_POSIX_PATH_MAX];
 	json_object *root;
 	int ret;
+	CAMPAIGN_LOCK();
 
 	if (curchar == NULL) {
 		log_debug("Nothing to unset here\n");
 		return;
 	}
 
+	if (use_snapshot()) {
+		snapshot_set_last_used(0);
+		return;
+	}
+
 	ret = snprintf(path, sizeof(path), "%s/characters.json", get_isscrolls_dir());
 	if (ret < 0 || (size_t)ret >= sizeof(path)) {
 		log_errx(1, "Path truncation happened.  Buffer too short to fit %s\n", path);
 	}
 
 	/* Just set the last_used character to 0 */
-	if ((root = json_object_from_file(path)) == NULL)
+	if ((root = read_json_file(path)) == NULL)
 		return;
 	else
 		json_object_object_add(root, "last_used", json_object_new_int(0));
 
-	if (json_object_to_file(path, root))
+	if (write_json_file(path, root))
 		printf("Error saving %s\n", path);
 
 	json_object_put(root);
@@ -785,13 +1333,19 @@ delete_saved_character(int id)
 	json_object *root, *lid;
 	size_t temp_n, i;
 	int ret;
+	CAMPAIGN_LOCK();
+
+	if (use_snapshot()) {
+		snapshot_delete_character(id);
+		return;
+	}
 
 	ret = snprintf(path, sizeof(path), "%s/characters.json", get_isscrolls_dir());
 	if (ret < 0 || (size_t)ret >= sizeof(path)) {
 		log_errx(1, "Path truncation happened.  Buffer too short to fit %s\n", path);
 	}
 
-	if ((root = json_object_from_file(path)) == NULL) {
+	if ((root = read_json_file(path)) == NULL) {
 		log_debug("No character JSON file found (%s)\n", path);
 		return;
 	}
@@ -812,7 +1366,7 @@ delete_saved_character(int id)
 		}
 	}
 
-	if (json_object_to_file(path, root))
+	if (write_json_file(path, root))
 		printf("Error saving %s\n", path);
 	else
 		log_debug("Successfully saved %s\n", path);
@@ -820,24 +1374,29 @@ delete_saved_character(int id)
 	json_object_put(root);
 }
 
-int
-load_characters_list(void)
+void
+add_list_entry(int id, const char *name)
+{
+	log_debug("Add %s to list with id: %d\n", name, id);
+	roster_add(id, name);
+}
+
+static int
+load_characters_list_json(int *last_id)
 {
-	struct entry *e;
 	char path[_POSIX_PATH_MAX];
 	json_object *root;
-	json_object *lid, *name;
+	json_object *lid, *name, *gen;
 	size_t temp_n, i;
-	int ret, last_id = -1, found = 0;
-
-	LIST_INIT(&head);
+	int ret;
+	CAMPAIGN_LOCK();
 
 	ret = snprintf(path, sizeof(path), "%s/characters.json", get_isscrolls_dir());
 	if (ret < 0 || (size_t)ret >= sizeof(path)) {
 		log_errx(1, "Path truncation happened.  Buffer too short to fit %s\n", path);
 	}
 
-	if ((root = json_object_from_file(path)) == NULL) {
+	if ((root = read_json_file(path)) == NULL) {
 		log_debug("No character JSON file found (%s)\n", path);
 		return -1;
 	}
@@ -846,13 +1405,14 @@ load_characters_list(void)
 	if (!json_object_object_get_ex(root, "last_used", &last_used)) {
 		log_debug("No previously loaded character\n");
 	} else {
-		last_id = json_object_get_int(last_used);
-		log_debug("Previously loaded character: %d\n", last_id);
+		*last_id = json_object_get_int(last_used);
+		log_debug("Previously loaded character: %d\n", *last_id);
 	}
 
 	json_object *characters;
 	if (!json_object_object_get_ex(root, "characters", &characters)) {
 		log_debug("Cannot find a [characters] array in %s\n", path);
+		json_object_put(root);
 		return -1;
 	}
 	temp_n = json_object_array_length(characters);
@@ -860,26 +1420,43 @@ load_characters_list(void)
 		json_object *temp = json_object_array_get_idx(characters, i);
 		json_object_object_get_ex(temp, "id", &lid);
 		json_object_object_get_ex(temp, "name", &name);
-		log_debug("Add %s to list with id: %d\n", json_object_get_string(name), json_object_get_int(lid));
+		add_list_entry(json_object_get_int(lid), json_object_get_string(name));
+		if (json_object_object_get_ex(temp, "generation", &gen))
+			roster_set_generation(json_object_get_int(lid),
+			    (uint64_t)json_object_get_int64(gen));
+	}
+
+	json_object_put(root);
+
+	return 0;
+}
 
-		if ((e = malloc(sizeof(struct entry))) == NULL)
-			log_errx(1, "cannot allocate memory\n");
+int
+load_characters_list(void)
+{
+	int ret, last_id = -1;
+	TRACE_FUNC("load");
+	CAMPAIGN_LOCK();
 
-		e->id = json_object_get_int(lid);
+	roster_clear();
 
-		/* If there is a last loaded character in the JSON, make sure it is also
-		 * in the list of existing characters.  This prevents that a broken ID
-		 * is loaded later */
-		if (e->id == last_id)
-			found = 1;
+	/* Bring the store of the configured format up to date first */
+	sync_character_store();
 
-		snprintf(e->name, sizeof(e->name), "%s", json_object_get_string(name));
-		LIST_INSERT_HEAD(&head, e, entries);
-	}
+	if (use_snapshot())
+		ret = snapshot_load_list(add_list_entry, &last_id);
+	else
+		ret = load_characters_list_json(&last_id);
 
-	json_object_put(root);
+	campaign_synced();
 
-	if (last_id != -1 && found == 1) {
+	if (ret == -1)
+		return -1;
+
+	/* If there is a last loaded character, make sure it is also in the list
+	 * of existing characters.  This prevents that a broken ID is loaded
+	 * later */
+	if (last_id != -1 && roster_contains(last_id)) {
 		if (load_character(last_id) == -1)
 			return -1;
 	} else
@@ -888,122 +1465,98 @@ load_characters_list(void)
 	return 0;
 }
 
-int
-load_character(int id)
+static struct character *
+new_character(void)
+{
+	struct character_arena *a;
+
+	if ((a = calloc(1, sizeof(*a))) == NULL)
+		log_errx(1, "calloc");
+
+	a->c.name = a->name;
+	a->c.j = &a->j;
+	a->c.fight = &a->fight;
+	a->c.delve = &a->delve;
+	a->c.vow = &a->vow;
+	a->c.expedition = &a->expedition;
+
+	return &a->c;
+}
+
+void
+release_character(struct character *c)
+{
+	free(c);
+}
+
+static int
+load_character_json(int id, struct character *c)
 {
-	struct character *c;
 	char path[_POSIX_PATH_MAX];
-	json_object *root, *lid, *name;
+	json_object *root, *lid;
 	size_t temp_n, i;
 	int ret;
-
-	if (id <= 0)
-		return -1;
+	CAMPAIGN_LOCK();
 
 	ret = snprintf(path, sizeof(path), "%s/characters.json", get_isscrolls_dir());
 	if (ret < 0 || (size_t)ret >= sizeof(path)) {
 		log_errx(1, "Path truncation happened.  Buffer too short to fit %s\n", path);
 	}
 
-	if ((root = json_object_from_file(path)) == NULL) {
+	if ((root = read_json_file(path)) == NULL) {
 		log_debug("No character JSON file found (%s)\n", path);
 		return -1;
 	}
 
-	if ((c = calloc(1, sizeof(struct character))) == NULL)
-		log_errx(1, "calloc");
-
-	if ((c->name = calloc(1, MAX_CHAR_LEN)) == NULL)
-		log_errx(1, "calloc");
-
-	if ((c->j = calloc(1, sizeof(struct journey))) == NULL)
-		log_errx(1, "calloc");
-
-	if ((c->fight = calloc(1, sizeof(struct fight))) == NULL)
-		log_errx(1, "calloc");
-
-	if ((c->delve = calloc(1, sizeof(struct delve))) == NULL)
-		log_errx(1, "calloc");
-
-	if ((c->vow = calloc(1, sizeof(struct vow))) == NULL)
-		log_errx(1, "calloc");
-
-	if ((c->expedition = calloc(1, sizeof(struct expedition))) == NULL)
-		log_errx(1, "calloc");
-
 	json_object *characters;
 	if (!json_object_object_get_ex(root, "characters", &characters)) {
 		log_debug("Cannot find a [characters] array in %s\n", path);
-		free(c->name);
-		c->name = NULL;
-		free(c->j);
-		c->j = NULL;
-		free(c->fight);
-		c->fight = NULL;
-		free(c->delve);
-		c->delve = NULL;
-		free(c->vow);
-		c->vow = NULL;
-		free(c->expedition);
-		c->expedition = NULL;
-		free(c);
-		c = NULL;
+		json_object_put(root);
 		return -1;
 	}
 
+	set_character_defaults(c);
+
 	temp_n = json_object_array_length(characters);
 	for (i=0; i < temp_n; i++) {
 		json_object *temp = json_object_array_get_idx(characters, i);
 		json_object_object_get_ex(temp, "id", &lid);
-		if (id == json_object_get_int(lid)) {
-			json_object_object_get_ex(temp, "name", &name);
-
-			log_debug("Loading character %s, id: %d\n", json_object_get_string(name),
-				json_object_get_int(lid));
-
-			snprintf(c->name, MAX_CHAR_LEN, "%s", json_object_get_string(name));
-			c->id		 = id;
-			c->vid = validate_int(temp, "vid", -1, INT_MAX, -1);
-			c->edge = validate_int(temp, "edge", 0, 5, 1);
-			c->heart = validate_int(temp, "heart", 0, 5, 1);
-			c->iron = validate_int(temp, "iron", 0, 5, 1);
-			c->shadow = validate_int(temp, "shadow", 0, 5, 1);
-			c->wits = validate_int(temp, "wits", 0, 5, 1);
-			c->exp = validate_int(temp, "exp", 0, 30, 0);
-			c->health = validate_int(temp, "health", 0, 5, 5);
-			c->spirit = validate_int(temp, "spirit", 0, 5, 5);
-			c->supply = validate_int(temp, "supply", 0, 5, 5);
-			c->wounded = validate_int(temp, "wounded", 0, 1, 0);
-			c->shaken = validate_int(temp, "shaken", 0, 1, 0);
-			c->maimed = validate_int(temp, "maimed", 0, 1, 0);
-			c->battle_scarred = validate_int(temp, "battle_scarred", 0, 1, 0);
-			c->cursed = validate_int(temp, "cursed", 0, 1, 0);
-			c->dead = validate_int(temp, "dead", 0, 1, 0);
-			c->weapon = validate_int(temp, "weapon", 1, 2, 1);
-			c->bonds = validate_double(temp, "bonds", 0, 5, 1);
-			c->corrupted = validate_int(temp, "corrupted", 0, 1, 0);
-			c->tormented = validate_int(temp, "tormented", 0, 1, 0);
-			c->exp_used = validate_int(temp, "exp_used", 0, 30, 0);
-			c->unprepared = validate_int(temp, "unprepared", 0, 1, 0);
-			c->momentum = validate_int(temp, "momentum", -6, 10, 2);
-			c->encumbered = validate_int(temp, "encumbered", 0, 1, 0);
-			c->max_momentum = validate_int(temp, "max_momentum", -6, 10, 2);
-			c->momentum_reset = validate_int(temp, "momentum_reset", -6, 2, 2);
-			c->journey_active = validate_int(temp, "journey_active", 0, 1, 0);
-			c->fight_active = validate_int(temp, "fight_active", 0, 1, 0);
-			c->delve_active = validate_int(temp, "delve_active", 0, 1, 0);
-			c->vow_active = validate_int(temp, "vow_active", 0, 1, 0);
-			c->expedition_active = validate_int(temp, "expedition_active", 0, 1, 0);
-			c->strong_hit = validate_int(temp, "strong_hit", 0, 1, 0);
-			c->journaling = validate_int(temp, "journaling", 0, 1, 0);
-			c->failure_track = validate_double(temp, "failure_track", 0.0, 10.0, 0.0);
-			c->legacy_bonds = validate_double(temp, "legacy_bonds", 0.0, 10.0, 0.0);
-			c->legacy_discoveries = validate_double(temp, "legacy_discoveries", 0.0, 10.0, 0.0);
-			c->legacy_quests = validate_double(temp, "legacy_quests", 0.0, 10.0, 0.0);
-
-			c->quests = validate_double(temp, "quests", 0.0, 10.0, 0.0);
-			c->discoveries = validate_double(temp, "discoveries", 0.0, 10.0, 0.0);
-		}
+		if (id != json_object_get_int(lid))
+			continue;
+
+		character_from_json(c, temp);
+		c->id = id;
+
+		log_debug("Loading character %s, id: %d\n", c->name, c->id);
+		break;
+	}
+
+	json_object_put(root);
+
+	return 0;
+}
+
+int
+load_character(int id)
+{
+	struct character *c;
+	int ret;
+	TRACE_FUNC("load");
+	CAMPAIGN_LOCK();
+
+	if (id <= 0)
+		return -1;
+
+	c = new_character();
+
+	if (use_snapshot())
+		ret = snapshot_load_character(id, c);
+	else
+		ret = load_character_json(id, c);
+
+	if (ret == -1) {
+		release_character(c);
+		return -1;
 	}
 
 	curchar = c;
@@ -1012,6 +1565,9 @@ load_character(int id)
 	load_fight(c->id);
 	load_delve(c->id);
 	load_expedition(c->id);
+	load_threats(c->id);
+	load_truths(c->id);
+	load_draws(c->id);
 
 	if (load_vow(c->vid) == -1)
 		curchar->vow_active = 0;
@@ -1019,29 +1575,12 @@ load_character(int id)
 	update_prompt();
 	print_character();
 
-	json_object_put(root);
-
 	return 0;
 }
 
 int
-validate_int(json_object *jobj, const char *desc, int min, int max, int def)
+check_int_range(const char *desc, int value, int min, int max, int def)
 {
-	json_object *cval;
-	int value;
-
-	if (jobj == NULL) {
-		log_debug("Empty JSON object for %s.  Using default\n", desc);
-		return def;
-	}
-
-	if (!json_object_object_get_ex(jobj, desc, &cval)) {
-		log_debug("Cannot get value for %s from JSON.  Using default\n", desc);
-		return def;
-	}
-
-	value = json_object_get_int(cval);
-
 	if (value < min || value > max) {
 		printf("[-] Error.  Value for %s (%d) is out of range [%d, %d]\n",
 			desc, value, min, max);
@@ -1056,11 +1595,26 @@ validate_int(json_object *jobj, const char *desc, int min, int max, int def)
 }
 
 double
-validate_double(json_object *jobj, const char *desc,
-	double min, double max, double def)
+check_double_range(const char *desc, double value, double min, double max,
+	double def)
+{
+	if (value < min || value > max) {
+		printf("[-] Error.  Value for %s (%.2f) is out of range [%.2f, %.2f]\n",
+			desc, value, min, max);
+		printf("[-] Resetting to a default value: %.2f\n", def);
+		printf("\n[-] If you think this is a bug, please open an issue at\n");
+		printf("https://github.com/thexhr/isscrolls/issues and describe why\n");
+		printf("you think it is a bug.\n");
+		return def;
+	}
+
+	return value;
+}
+
+int
+validate_int(json_object *jobj, const char *desc, int min, int max, int def)
 {
 	json_object *cval;
-	double value;
 
 	if (jobj == NULL) {
 		log_debug("Empty JSON object for %s.  Using default\n", desc);
@@ -1072,19 +1626,27 @@ validate_double(json_object *jobj, const char *desc,
 		return def;
 	}
 
-	value = json_object_get_double(cval);
+	return check_int_range(desc, json_object_get_int(cval), min, max, def);
+}
 
-	if (value < min || value > max) {
-		printf("[-] Error.  Value for %s (%.2f) is out of range [%.2f, %.2f]\n",
-			desc, value, min, max);
-		printf("[-] Resetting to a default value: %.2f\n", def);
-		printf("\n[-] If you think this is a bug, please open an issue at\n");
-		printf("https://github.com/thexhr/isscrolls/issues and describe why\n");
-		printf("you think it is a bug.\n");
+double
+validate_double(json_object *jobj, const char *desc,
+	double min, double max, double def)
+{
+	json_object *cval;
+
+	if (jobj == NULL) {
+		log_debug("Empty JSON object for %s.  Using default\n", desc);
 		return def;
 	}
 
-	return value;
+	if (!json_object_object_get_ex(jobj, desc, &cval)) {
+		log_debug("Cannot get value for %s from JSON.  Using default\n", desc);
+		return def;
+	}
+
+	return check_double_range(desc, json_object_get_double(cval), min, max,
+		def);
 }
 
 void
@@ -1116,6 +1678,8 @@ void
 print_character(void)
 {
 	static const char *wp;
+	int i;
+	TRACE_FUNC("output");
 
 	CURCHAR_CHECK();
 
@@ -1129,16 +1693,10 @@ print_character(void)
 	else
 		printf("\n");
 
-	printf("\nEdge: %d Heart: %d Iron: %d Shadow: %d Wits: %d\n\n",
-		curchar->edge, curchar->heart, curchar->iron, curchar->shadow, curchar->wits);
-	printf("Momentum: %d/%d [%d] Health: %d/5 Spirit: %d/5 Supply: %d/5\n",
-		curchar->momentum, curchar-> max_momentum, curchar->momentum_reset,
-		curchar->health, curchar->spirit, curchar->supply);
-
-	printf("\nWounded:\t%d Unprepared:\t%d Encumbered:\t%d Shaken:\t%d\n",
-		curchar->wounded, curchar->unprepared, curchar->encumbered, curchar->shaken);
-	printf("Corrupted:\t%d Tormented:\t%d Cursed:\t%d Maimed:\t%d\n",
-		curchar->corrupted, curchar->tormented, curchar->cursed, curchar->maimed);
+	print_char_row(1, "\n", "\n\n");
+	print_char_row(2, "", "\n");
+	print_char_row(3, "\n", "\n");
+	print_char_row(4, "", "\n");
 
 	if (curchar->weapon == 2)
 		wp = "deadly";
@@ -1147,17 +1705,17 @@ print_character(void)
 
 	printf("\nArmed with a %s weapon\n\n", wp);
 
-	printf("Bonds: %.2f (L: %.2f)", curchar->bonds, curchar->legacy_bonds);
-	printf(" Quests: %.2f (L: %.2f)", curchar->quests, curchar->legacy_quests);
-	printf(" Discoveries: %.2f (L: %.2f)\n", curchar->discoveries, curchar->legacy_discoveries);
+	print_char_row(5, "", "\n");
 
 	if (curchar->journey_active) {
 		printf("\nActive Journey: Difficulty: %d Progress: %.2f/10\n",
 			curchar->j->difficulty, curchar->j->progress);
 	}
-	if (curchar->fight_active) {
-		printf("\nActive Fight: Difficulty: %d Progress: %.2f/10\n",
-			curchar->fight->difficulty, curchar->fight->progress);
+	for (i = 0; curchar->fight_active && i < curchar->fight->n_foes; i++) {
+		printf("\nActive Fight: %s Difficulty: %d Progress: %.2f/10\n",
+			curchar->fight->foes[i].name,
+			curchar->fight->foes[i].difficulty,
+			curchar->fight->foes[i].progress);
 	}
 	if (curchar->delve_active) {
 		printf("\nActive delve: Difficulty: %d Progress: %.2f/10\n",
@@ -1208,43 +1766,12 @@ free_character(void)
 		return;
 	}
 
-	if (curchar->name != NULL) {
-		free(curchar->name);
-		curchar->name = NULL;
-	}
-	if (curchar->j != NULL) {
-		free(curchar->j);
-		curchar->j = NULL;
-	}
-	if (curchar->fight != NULL) {
-		free(curchar->fight);
-		curchar->fight = NULL;
-	}
-	if (curchar->delve != NULL) {
-		free(curchar->delve);
-		curchar->delve = NULL;
-	}
-	if (curchar->expedition != NULL) {
-		free(curchar->expedition);
-		curchar->expedition = NULL;
-	}
-	if (curchar->vow->title != NULL) {
-		free(curchar->vow->title);
-		curchar->vow->title = NULL;
-	}
-	if (curchar->vow->description != NULL) {
-		free(curchar->vow->description);
-		curchar->vow->description = NULL;
-	}
-	if (curchar->vow != NULL) {
-		free(curchar->vow);
-		curchar->vow= NULL;
-	}
-	if (curchar != NULL) {
-		free(curchar);
-		curchar = NULL;
-		close_journal_file();
-	}
+	free_threats();
+	free_truths();
+	free_draws();
+	release_character(curchar);
+	curchar = NULL;
+	close_journal_file();
 }
 
 int
@@ -1270,46 +1797,40 @@ again:
 int
 character_exists(const char *name)
 {
-	struct entry *np;
-
 	if (name == NULL)
 		return 0;
 
 	if (strlen(name) == 0)
 		return 0;
 
-	LIST_FOREACH(np, &head, entries) {
-		if (strcasecmp(name, np->name) == 0) {
-			return 1;
-		}
-	}
-
-	return 0;
+	return roster_find_name(name) != -1;
 }
 
 struct character *
 create_character(const char *name)
 {
 	struct character *c;
+	char *line;
 
 	c = init_character_struct();
 
 	if (strlen(name) == 0) {
 		printf("Enter a name for your character: ");
-		c->name = readline(NULL);
-		if (c->name != NULL && strlen(c->name) == 0) {
+		line = readline(NULL);
+		if (line == NULL || strlen(line) == 0) {
 			printf("Please provide a longer name\n");
-			free_character();
+			free(line);
+			release_character(c);
 			return NULL;
 		}
+		snprintf(c->name, MAX_CHAR_LEN, "%s", line);
+		free(line);
 		if (character_exists(c->name)) {
 			printf("Sorry, there is already a character named %s\n", c->name);
-			free_character();
+			release_character(c);
 			return NULL;
 		}
 	} else {
-		if ((c->name = calloc(1, MAX_CHAR_LEN)) == NULL)
-			log_errx(1, "calloc");
 		snprintf(c->name, MAX_CHAR_LEN, "%s", name);
 		printf("Creating a character named %s\n", c->name);
 	}
@@ -1333,69 +1854,32 @@ init_character_struct(void)
 {
 	struct character *c;
 
-	if ((c = calloc(1, sizeof(struct character))) == NULL)
-		log_errx(1, "calloc");
-
-	if ((c->j = calloc(1, sizeof(struct journey))) == NULL)
-		log_errx(1, "calloc");
-
-	if ((c->fight = calloc(1, sizeof(struct fight))) == NULL)
-		log_errx(1, "calloc");
-
-	if ((c->delve = calloc(1, sizeof(struct delve))) == NULL)
-		log_errx(1, "calloc");
-
-	if ((c->expedition = calloc(1, sizeof(struct expedition))) == NULL)
-		log_errx(1, "calloc");
-
-	if ((c->vow= calloc(1, sizeof(struct vow))) == NULL)
-		log_errx(1, "calloc");
+	c = new_character();
 
+	set_character_defaults(c);
 	c->id = random();
-	c->name = NULL;
-	c->edge = c->heart = c->iron = c->shadow = c->wits = c->exp = 0;
-	c->momentum = c->momentum_reset = 2;
-	c->max_momentum = 10;
-	c->health = c->spirit = c->supply = 5;
-	c->wounded = c->unprepared = c->shaken = c->encumbered = c->maimed = 0;
-	c->cursed = c->corrupted = c->tormented = c->exp_used = c->bonds = 0;
-	c->dead = c->battle_scarred = c->strong_hit = 0;
-	c->failure_track = 0.0;
-	c->legacy_bonds = 0.0;
-	c->legacy_quests = 0.0;
-	c->legacy_discoveries = 0.0;
-	c->discoveries = 0.0;
-	c->quests = 0.0;
-	c->weapon = 1;
-	c->journaling = 0;
 
 	c->j->id = c->id;
 	c->j->difficulty = -1;
 	c->j->progress = 0.0;
-	c->journey_active = 0;
 
 	c->fight->id = c->id;
-	c->fight->difficulty = -1;
-	c->fight->progress = 0.0;
+	c->fight->n_foes = 0;
+	c->fight->target = 0;
 	c->fight->initiative = 0;
-	c->fight_active = 0;
 
 	c->delve->id = c->id;
 	c->delve->difficulty = -1;
 	c->delve->progress = 0.0;
-	c->delve_active = 0;
 
 	c->expedition->id = c->id;
 	c->expedition->difficulty = -1;
 	c->expedition->progress = 0.0;
-	c->expedition_active = 0;
 
 	c->vow->id = c->id;
 	c->vow->difficulty = -1;
 	c->vow->title = NULL;
 	c->vow->description = NULL;
-	c->vow_active = 0;
-	c->vid = -1;
 
 	return c;
 }
@@ -1406,6 +1890,16 @@ get_current_character(void)
 	return curchar;
 }
 
+/*
+ * Make c the current character of the calling thread without loading or
+ * saving anything.  Used by threads that play characters of their own.
+ */
+void
+set_thread_character(struct character *c)
+{
+	curchar = c;
+}
+
 void
 cmd_startautojournal(__attribute__((unused)) char *unused) {
 	CURCHAR_CHECK();
@@ -1413,6 +1907,7 @@ cmd_startautojournal(__attribute__((unused)) char *unused) {
 		return;
 
 	curchar->journaling = 1;
+	mark_dirty();
 	printf("Autojournaling enabled.\n");
 }
 
@@ -1423,6 +1918,7 @@ cmd_stopautojournal(__attribute__((unused)) char *unused) {
 		return;
 
 	curchar->journaling = 0;
+	mark_dirty();
 	printf("Autojournaling disabled.\n");
 }
 
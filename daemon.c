@@ -0,0 +1,306 @@
+/*
+ * Copyright (c) 2026 Matthias Schmidt <xhr@giessen.ccc.de>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * In daemon mode the campaign stays loaded and commands arrive over a Unix
+ * socket instead of the terminal.  Clients are served one after the other.
+ * Every line a client sends is handed to execute_command() with stdout
+ * pointing to the connection, and every reply is terminated by a NUL byte so
+ * that scripts know when a command is done.  Commands that ask for more input
+ * read it from the same connection.
+ */
+
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/un.h>
+
+#include <errno.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <readline/readline.h>
+
+#include "isscrolls.h"
+
+#define CLIENT_BUF_SIZE	4096
+
+static int listen_fd = -1;
+static struct sockaddr_un daemon_addr;
+
+static int
+fill_address(struct sockaddr_un *addr, const char *path)
+{
+	memset(addr, 0, sizeof(*addr));
+	addr->sun_family = AF_UNIX;
+
+	if (strlen(path) >= sizeof(addr->sun_path)) {
+		printf("Socket path %s is too long\n", path);
+		return -1;
+	}
+	snprintf(addr->sun_path, sizeof(addr->sun_path), "%s", path);
+
+	return 0;
+}
+
+/* Readline reads the answers to questions from the client's buffer, too */
+static int
+client_getc(FILE *fp)
+{
+	return fgetc(fp);
+}
+
+int
+open_daemon_socket(const char *path)
+{
+	struct stat sb;
+	mode_t old_umask;
+	int fd;
+
+	if (fill_address(&daemon_addr, path) == -1)
+		return -1;
+
+	/* Only remove a socket that is left over from a dead daemon */
+	if (lstat(path, &sb) == 0) {
+		if (!S_ISSOCK(sb.st_mode)) {
+			printf("%s exists and is not a socket\n", path);
+			return -1;
+		}
+
+		if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) == -1) {
+			log_debug("socket: %s\n", strerror(errno));
+			return -1;
+		}
+		if (connect(fd, (struct sockaddr *)&daemon_addr,
+		    sizeof(daemon_addr)) == 0) {
+			printf("Another daemon is already listening on %s\n", path);
+			close(fd);
+			return -1;
+		}
+		close(fd);
+		unlink(path);
+	}
+
+	if ((listen_fd = socket(AF_UNIX, SOCK_STREAM, 0)) == -1) {
+		log_debug("socket: %s\n", strerror(errno));
+		return -1;
+	}
+
+	/* Nobody else is supposed to play with the campaign */
+	old_umask = umask(077);
+	if (bind(listen_fd, (struct sockaddr *)&daemon_addr,
+	    sizeof(daemon_addr)) == -1) {
+		printf("Cannot bind to %s: %s\n", path, strerror(errno));
+		umask(old_umask);
+		goto fail;
+	}
+	umask(old_umask);
+
+	if (listen(listen_fd, 16) == -1) {
+		printf("Cannot listen on %s: %s\n", path, strerror(errno));
+		goto fail;
+	}
+
+	/* A client that went away must not take the daemon with it */
+	signal(SIGPIPE, SIG_IGN);
+
+	log_debug("Listening on %s\n", path);
+
+	return 0;
+fail:
+	close(listen_fd);
+	listen_fd = -1;
+	return -1;
+}
+
+void
+close_daemon_socket(void)
+{
+	if (listen_fd == -1)
+		return;
+
+	close(listen_fd);
+	listen_fd = -1;
+	unlink(daemon_addr.sun_path);
+}
+
+static void
+serve_client(int fd)
+{
+	struct command *cmd;
+	FILE *in;
+	char *line = NULL, *res;
+	size_t size = 0;
+	int saved_stdout;
+
+	if ((in = fdopen(fd, "r")) == NULL) {
+		close(fd);
+		return;
+	}
+
+	fflush(stdout);
+	if ((saved_stdout = dup(STDOUT_FILENO)) == -1 ||
+	    dup2(fd, STDOUT_FILENO) == -1) {
+		log_debug("Cannot redirect output: %s\n", strerror(errno));
+		if (saved_stdout != -1)
+			close(saved_stdout);
+		fclose(in);
+		return;
+	}
+
+	rl_instream = in;
+	rl_getc_function = client_getc;
+
+	for (;;) {
+		autosave_idle();
+		if (getline(&line, &size, in) == -1) {
+			autosave_busy();
+			break;
+		}
+		autosave_busy();
+		res = stripwhite(line);
+
+		/* Quitting ends the session of the client, not the daemon */
+		if ((cmd = find_command(res)) != NULL && cmd->cmd == cmd_quit)
+			break;
+
+		if (*res)
+			execute_command(res);
+
+		putchar('\0');
+		fflush(stdout);
+	}
+
+	fflush(stdout);
+	free(line);
+
+	rl_instream = stdin;
+	rl_getc_function = rl_getc;
+
+	dup2(saved_stdout, STDOUT_FILENO);
+	close(saved_stdout);
+	fclose(in);
+}
+
+/* Path of the socket the daemon listens on, NULL if not running as daemon */
+const char *
+get_daemon_socket(void)
+{
+	return listen_fd == -1 ? NULL : daemon_addr.sun_path;
+}
+
+/* Wait for the next client and serve it until it disconnects */
+void
+serve_next_client(void)
+{
+	struct pollfd pfd;
+	int fd, ret;
+
+	if (listen_fd == -1)
+		return;
+
+	/* Unlike accept(), poll() returns if we get a signal to shut down */
+	pfd.fd = listen_fd;
+	pfd.events = POLLIN;
+	autosave_idle();
+	ret = poll(&pfd, 1, -1);
+	autosave_busy();
+	if (ret <= 0)
+		return;
+
+	if ((fd = accept(listen_fd, NULL, NULL)) == -1) {
+		log_debug("accept: %s\n", strerror(errno));
+		return;
+	}
+
+	log_debug("Client connected\n");
+	serve_client(fd);
+	log_debug("Client disconnected\n");
+}
+
+/*
+ * Thin client for the daemon.  Everything typed is sent as is, replies are
+ * printed without their terminating NUL byte.  On a terminal, a prompt is
+ * shown once a reply is complete.
+ */
+int
+run_client(const char *path)
+{
+	struct sockaddr_un addr;
+	struct pollfd pfd[2];
+	char buf[CLIENT_BUF_SIZE];
+	ssize_t n, i, start;
+	int fd, tty;
+
+	if (fill_address(&addr, path) == -1)
+		return 1;
+
+	if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) == -1 ||
+	    connect(fd, (struct sockaddr *)&addr, sizeof(addr)) == -1) {
+		printf("Cannot connect to %s: %s\n", path, strerror(errno));
+		return 1;
+	}
+
+	tty = isatty(STDIN_FILENO);
+	if (tty)
+		write(STDOUT_FILENO, "> ", 2);
+
+	pfd[0].fd = STDIN_FILENO;
+	pfd[0].events = POLLIN;
+	pfd[1].fd = fd;
+	pfd[1].events = POLLIN;
+
+	for (;;) {
+		if (poll(pfd, 2, -1) == -1) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+
+		if (pfd[0].revents & (POLLIN | POLLHUP)) {
+			n = read(STDIN_FILENO, buf, sizeof(buf));
+			if (n <= 0) {
+				/* Let the daemon finish the last command */
+				shutdown(fd, SHUT_WR);
+				pfd[0].fd = -1;
+			} else if (write(fd, buf, n) != n)
+				break;
+		}
+
+		if (pfd[1].revents & (POLLIN | POLLHUP)) {
+			if ((n = read(fd, buf, sizeof(buf))) <= 0)
+				break;
+
+			for (i = start = 0; i < n; i++) {
+				if (buf[i] != '\0')
+					continue;
+				write(STDOUT_FILENO, buf + start, i - start);
+				if (tty)
+					write(STDOUT_FILENO, "> ", 2);
+				start = i + 1;
+			}
+			write(STDOUT_FILENO, buf + start, n - start);
+		}
+	}
+
+	close(fd);
+
+	return 0;
+}
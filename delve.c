@@ -31,6 +31,7 @@ cmd_discover_a_site(__attribute__((unused))char *cmd)
 	if (curchar->delve_active == 0) {
 		ask_for_delve_difficulty();
 		curchar->delve_active = 1;
+		mark_dirty();
 	}
 
 	update_prompt();
@@ -211,6 +212,7 @@ info:
 		read_oracle_from_json(ORACLE_DELVE_DANGER, 0);
 	}
 
+	mark_dirty();
 	update_prompt();
 }
 
@@ -248,6 +250,7 @@ cmd_locate_your_objective(char *cmd)
 		locate_your_objective_failed();
 	}
 
+	mark_dirty();
 	update_prompt();
 }
 
@@ -284,7 +287,6 @@ void
 mark_delve_progress(int what)
 {
 	struct character *curchar = get_current_character();
-	double amount = 0;
 
 	CURCHAR_CHECK();
 
@@ -293,38 +295,11 @@ mark_delve_progress(int what)
 		return;
 	}
 
-	switch (curchar->delve->difficulty) {
-	case 1:
-		amount = 3;
-		break;
-	case 2:
-		amount = 2;
-		break;
-	case 3:
-		amount = 1;
-		break;
-	case 4:
-		amount = 0.5;
-		break;
-	case 5:
-		amount = 0.25;
-		break;
-	default:
-		curchar->delve->difficulty = 1;
-		log_errx(1, "Unknown difficulty.  This should not happen.  Set it to 1\n");
-	}
-
-	if (what == INCREASE)
-		curchar->delve->progress += amount;
-	else
-		curchar->delve->progress -= amount;
-
-	if (curchar->delve->progress > 10) {
+	if (mark_progress(&curchar->delve->progress, &curchar->delve->difficulty,
+	    what))
 		printf("Your reached all milestones of your delve.  Consider ending it\n");
-		curchar->delve->progress = 10;
-	} else if (curchar->delve->progress < 0)
-		curchar->delve->progress = 0;
 
+	mark_dirty();
 	update_prompt();
 }
 
@@ -336,6 +311,8 @@ save_delve(void)
 	json_object *root, *items, *id;
 	size_t temp_n, i;
 	int ret;
+	TRACE_FUNC("save");
+	CAMPAIGN_LOCK();
 
 	if (curchar == NULL) {
 		log_debug("No character loaded.  No delve to save.\n");
@@ -359,7 +336,7 @@ save_delve(void)
 		log_errx(1, "Path truncation happened.  Buffer too short to fit %s\n", path);
 	}
 
-	if ((root = json_object_from_file(path)) == NULL) {
+	if ((root = read_json_file(path)) == NULL) {
 		log_debug("No delve JSON file found\n");
 		root = json_object_new_object();
 		if (!root)
@@ -392,7 +369,7 @@ save_delve(void)
 	}
 
 out:
-	if (json_object_to_file(path, root))
+	if (write_json_file(path, root))
 		printf("Error saving %s\n", path);
 	else
 		log_debug("Successfully saved %s\n", path);
@@ -407,13 +384,14 @@ delete_delve(int id)
 	json_object *root, *lid;
 	size_t temp_n, i;
 	int ret;
+	CAMPAIGN_LOCK();
 
 	ret = snprintf(path, sizeof(path), "%s/delve.json", get_isscrolls_dir());
 	if (ret < 0 || (size_t)ret >= sizeof(path)) {
 		log_errx(1, "Path truncation happened.  Buffer too short to fit %s\n", path);
 	}
 
-	if ((root = json_object_from_file(path)) == NULL) {
+	if ((root = read_json_file(path)) == NULL) {
 		log_debug("No delve JSON file found\n");
 		return;
 	}
@@ -434,7 +412,7 @@ delete_delve(int id)
 		}
 	}
 
-	if (json_object_to_file(path, root))
+	if (write_json_file(path, root))
 		printf("Error saving %s\n", path);
 	else
 		log_debug("Successfully saved %s\n", path);
@@ -450,6 +428,8 @@ load_delve(int id)
 	json_object *root, *lid;
 	size_t temp_n, i;
 	int ret;
+	TRACE_FUNC("load");
+	CAMPAIGN_LOCK();
 
 	if (curchar == NULL) {
 		log_debug("No character loaded\n");
@@ -461,7 +441,7 @@ load_delve(int id)
 		log_errx(1, "Path truncation happened.  Buffer too short to fit %s\n", path);
 	}
 
-	if ((root = json_object_from_file(path)) == NULL) {
+	if ((root = read_json_file(path)) == NULL) {
 		log_debug("No delve JSON file found\n");
 		return;
 	}
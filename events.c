@@ -0,0 +1,282 @@
+/*
+ * Copyright (c) 2026 Matthias Schmidt <xhr@giessen.ccc.de>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Rolls and changes of character values are resolved into events, which
+ * are handed to every enabled sink.  The console and the journal render them
+ * as text, the JSON sink prints one object per line for other front ends.
+ * With no sink enabled, as in the simulator, nothing is formatted at all.
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+#include <json-c/json.h>
+
+#include "isscrolls.h"
+
+#define MAX_EVENT_TEXT	128
+
+struct event_sink {
+	const char *name;
+	int mask;
+	void (*emit)(const struct event *);
+};
+
+static void console_sink(const struct event *);
+static void journal_sink(const struct event *);
+static void json_sink(const struct event *);
+
+static const struct event_sink event_sinks[] = {
+	{ "console", SINK_CONSOLE, console_sink },
+	{ "journal", SINK_JOURNAL, journal_sink },
+	{ "json", SINK_JSON, json_sink },
+};
+
+#define N_EVENT_SINKS (sizeof(event_sinks) / sizeof(event_sinks[0]))
+
+static _Thread_local int enabled_sinks = SINK_DEFAULT;
+
+static const char *
+result_name(int result)
+{
+	switch (result) {
+	case STRONG:
+		return "strong hit";
+	case WEAK:
+		return "weak hit";
+	default:
+		return "miss";
+	}
+}
+
+static int
+result_color(int result)
+{
+	switch (result) {
+	case STRONG:
+		return GREEN;
+	case WEAK:
+		return YELLOW;
+	default:
+		return RED;
+	}
+}
+
+/*
+ * Render ev as text and pass every fragment with its color to out.  Shared by
+ * the console and the journal, so that both read the same.
+ */
+static void
+render_event(const struct event *ev, void (*out)(int, const char *, ...))
+{
+	const struct roll_event *r = &ev->roll;
+	const struct change_event *c = &ev->change;
+	int color = get_color();
+
+	switch (ev->type) {
+	case EVENT_ACTION_ROLL:
+		if (get_cursed() && r->cursed == 10)
+			out(BLUE, "Cursed result: ");
+
+		if (r->bonus == -1)
+			out(DEFAULT, color ? "<%ld> + %d = %.0lf " : "%ld + %d = %.0lf ",
+				r->action, r->stat, r->score);
+		else
+			out(DEFAULT, color ? "<%ld> + %d + %d = %.0lf " :
+				"%ld + %d + %d = %.0lf ", r->action, r->stat,
+				r->bonus, r->score);
+
+		/* Use a special way to display matches so that they don't get
+		 * unnoticed for the player */
+		if (r->match)
+			out(DEFAULT, color ? "vs <%ld> match " : "vs %ld match ",
+				r->challenge[0]);
+		else
+			out(DEFAULT, color ? "vs <%ld><%ld> " : "vs %ld, %ld ",
+				r->challenge[0], r->challenge[1]);
+
+		out(result_color(r->result), "%s\n", result_name(r->result));
+		break;
+	case EVENT_PROGRESS_ROLL:
+		if (r->match)
+			out(DEFAULT, color ? "<%ld> match vs " : "%ld match vs ",
+				r->challenge[0]);
+		else
+			out(DEFAULT, color ? "<%ld><%ld> vs " : "%ld, %ld vs ",
+				r->challenge[0], r->challenge[1]);
+
+		out(DEFAULT, "Progress: %.2lf ", r->score);
+		out(result_color(r->result), "%s\n", result_name(r->result));
+		break;
+	case EVENT_CHANGE:
+		/* Changes of tracks are only shown in verbose output */
+		if (c->is_double && !get_output())
+			break;
+
+		out(DEFAULT, c->is_double ? "%s %s from %.2f to %.2f\n" :
+			"%s %s from %.0f to %.0f\n",
+			c->to > c->from ? "Increasing" : "Decreasing", c->what,
+			c->from, c->to);
+		break;
+	}
+}
+
+static void
+console_out(int what, const char *fmt, ...)
+{
+	char text[MAX_EVENT_TEXT];
+	va_list ap;
+
+	va_start(ap, fmt);
+	vsnprintf(text, sizeof(text), fmt, ap);
+	va_end(ap);
+
+	pm(what | NO_JOURNAL, "%s", text);
+}
+
+static void
+journal_out(__attribute__((unused)) int what, const char *fmt, ...)
+{
+	va_list ap;
+
+	va_start(ap, fmt);
+	print_to_journal_v(fmt, &ap);
+	va_end(ap);
+}
+
+static void
+console_sink(const struct event *ev)
+{
+	render_event(ev, console_out);
+}
+
+static void
+journal_sink(const struct event *ev)
+{
+	/* Only commands that are journaled write their events to it */
+	if (journal_this == 0)
+		return;
+
+	render_event(ev, journal_out);
+}
+
+static void
+json_sink(const struct event *ev)
+{
+	json_object *root, *dice;
+	const struct roll_event *r = &ev->roll;
+
+	root = json_object_new_object();
+
+	switch (ev->type) {
+	case EVENT_ACTION_ROLL:
+	case EVENT_PROGRESS_ROLL:
+		json_object_object_add(root, "event", json_object_new_string(
+			ev->type == EVENT_ACTION_ROLL ? "action" : "progress"));
+		if (ev->type == EVENT_ACTION_ROLL) {
+			json_object_object_add(root, "action",
+				json_object_new_int(r->action));
+			json_object_object_add(root, "stat",
+				json_object_new_int(r->stat));
+			if (r->bonus != -1)
+				json_object_object_add(root, "bonus",
+					json_object_new_int(r->bonus));
+			json_object_object_add(root, "cursed",
+				json_object_new_int(r->cursed));
+		}
+		json_object_object_add(root, "score",
+			json_object_new_double(r->score));
+		dice = json_object_new_array();
+		json_object_array_add(dice, json_object_new_int(r->challenge[0]));
+		json_object_array_add(dice, json_object_new_int(r->challenge[1]));
+		json_object_object_add(root, "challenge", dice);
+		json_object_object_add(root, "result",
+			json_object_new_string(result_name(r->result)));
+		json_object_object_add(root, "match",
+			json_object_new_boolean(r->match));
+		break;
+	case EVENT_CHANGE:
+		json_object_object_add(root, "event", json_object_new_string("change"));
+		json_object_object_add(root, "what",
+			json_object_new_string(ev->change.what));
+		json_object_object_add(root, "from",
+			json_object_new_double(ev->change.from));
+		json_object_object_add(root, "to",
+			json_object_new_double(ev->change.to));
+		break;
+	}
+
+	printf("%s\n", json_object_to_json_string_ext(root, JSON_C_TO_STRING_PLAIN));
+	json_object_put(root);
+}
+
+/* Hand ev to all sinks enabled for the calling thread */
+void
+emit_event(const struct event *ev)
+{
+	size_t i;
+
+	if (enabled_sinks == 0)
+		return;
+
+	for (i = 0; i < N_EVENT_SINKS; i++) {
+		if (enabled_sinks & event_sinks[i].mask)
+			event_sinks[i].emit(ev);
+	}
+}
+
+int
+get_event_sinks(void)
+{
+	return enabled_sinks;
+}
+
+void
+set_event_sinks(int mask)
+{
+	enabled_sinks = mask;
+}
+
+void
+cmd_events(char *cmd)
+{
+	size_t i;
+
+	if (cmd == NULL || strlen(cmd) == 0) {
+		printf("Rolls and changes of values are sent to:\n\n");
+		for (i = 0; i < N_EVENT_SINKS; i++)
+			printf("%c %s\n", enabled_sinks & event_sinks[i].mask ?
+				'*' : ' ', event_sinks[i].name);
+		printf("\nToggle one with events <name>, e.g. events json");
+		pm(DEFAULT, "\n");
+		return;
+	}
+
+	for (i = 0; i < N_EVENT_SINKS; i++) {
+		if (strcasecmp(cmd, event_sinks[i].name) == 0) {
+			enabled_sinks ^= event_sinks[i].mask;
+			printf("%s %s\n", event_sinks[i].name,
+				enabled_sinks & event_sinks[i].mask ?
+				"enabled" : "disabled");
+			return;
+		}
+	}
+
+	printf("Unknown event sink %s\n", cmd);
+}
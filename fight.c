@@ -16,11 +16,22 @@
 
 #include <json-c/json.h>
 
+#include <errno.h>
 #include <limits.h>
+#include <stdlib.h>
 #include <string.h>
+#include <strings.h>
+
+#include <readline/readline.h>
+#include <readline/history.h>
 
 #include "isscrolls.h"
 
+static void ask_for_foes(struct fight *);
+static struct foe *find_foe(struct fight *, const char *);
+static int select_foe_from_cmd(struct fight *, char *, int);
+static void remove_target_foe(struct fight *);
+
 void
 cmd_enter_the_fray(char *cmd)
 {
@@ -54,8 +65,9 @@ info:
 	if (ival[0] == -1)
 		goto info;
 
-	ask_for_fight_difficulty();
+	ask_for_foes(curchar->fight);
 	curchar->fight_active = 1;
+	mark_dirty();
 
 	ret = action_roll(ival);
 	if (ret == STRONG || ret == STRONG_MATCH) {
@@ -71,9 +83,10 @@ info:
 }
 
 void
-cmd_end_the_fight(__attribute__((unused)) char *unused)
+cmd_end_the_fight(char *cmd)
 {
 	struct character *curchar = get_current_character();
+	struct foe *foe;
 	double dval[2] = { -1.0, -1.0 };
 	int ret;
 
@@ -89,24 +102,36 @@ cmd_end_the_fight(__attribute__((unused)) char *unused)
 		return;
 	}
 
-	dval[0] = curchar->fight->progress;
+	if (select_foe_from_cmd(curchar->fight, cmd, 1) == -1)
+		return;
+
+	foe = fight_target(curchar->fight);
+	dval[0] = foe->progress;
 
 	ret = progress_roll(dval);
 	if (ret == STRONG || ret == STRONG_MATCH) {
-		pm(DEFAULT, "The foe is no longer in the fight -> Rulebook\n");
+		pm(DEFAULT, "%s is no longer in the fight -> Rulebook\n", foe->name);
 	} else if (ret == WEAK || ret == WEAK_MATCH) {
-		pm(DEFAULT, "The foe is no longer in the fight, but you must chose one option -> Rulebook\n");
+		pm(DEFAULT, "%s is no longer in the fight, but you must chose one option -> Rulebook\n",
+			foe->name);
 	} else if (ret == MISS || ret == MISS_MATCH) {
 		pm(DEFAULT, "You lost the fight.  Pay the price -> Rulebook\n");
+		curchar->fight->n_foes = 0;
 	}
-	curchar->fight_active = 0;
-	curchar->fight->progress = 0;
-	delete_fight(curchar->id);
+
+	/* The fight goes on as long as foes are left */
+	remove_target_foe(curchar->fight);
+	if (curchar->fight->n_foes == 0) {
+		curchar->fight_active = 0;
+		delete_fight(curchar->id);
+	} else
+		pm(DEFAULT, "You now face %s\n", fight_target(curchar->fight)->name);
+	mark_dirty();
 	update_prompt();
 }
 
 void
-cmd_take_decisive_action(__attribute__((unused)) char *unused)
+cmd_take_decisive_action(char *cmd)
 {
 	struct character *curchar = get_current_character();
 	double dval[2] = { -1.0, -1.0 };
@@ -119,7 +144,10 @@ cmd_take_decisive_action(__attribute__((unused)) char *unused)
 		return;
 	}
 
-	dval[0] = curchar->fight->progress;
+	if (select_foe_from_cmd(curchar->fight, cmd, 1) == -1)
+		return;
+
+	dval[0] = fight_target(curchar->fight)->progress;
 
 	ret = progress_roll(dval);
 	if (curchar->fight->initiative) {
@@ -164,8 +192,8 @@ cmd_endure_harm(char *cmd)
 
 	/* We are in a fight, so we can suffer harm equal to our foe's rank */
 	if (curchar->fight_active) {
-		hr = curchar->health - curchar->fight->difficulty;
-		suffer = curchar->fight->difficulty;
+		suffer = fight_target(curchar->fight)->difficulty;
+		hr = curchar->health - suffer;
 	} else {
 		/* We are not in a fight, so the player can specify the amount of
 		 * harm to suffer */
@@ -198,6 +226,7 @@ cmd_endure_harm(char *cmd)
 			"momentum is down to %d\n",
 			suffer, curchar->momentum);
 	}
+	mark_dirty();
 
 	ival[0] = curchar->iron;
 	if (curchar->heart > curchar->iron) {
@@ -231,13 +260,17 @@ cmd_strike(char *cmd)
 		return;
 	}
 
+	if (select_foe_from_cmd(curchar->fight, cmd, 0) == -1)
+		return;
+
 	ret = get_args_from_cmd(cmd, stat, &ival[1]);
 	if (ret >= 10) {
 info:
 		printf("Please specify the stat you'd like to use in this move\n\n");
 		printf("iron\t- You attack in close quarters\n");
-		printf("edge\t- You attack at range\n");
-		printf("Example: strike iron");
+		printf("edge\t- You attack at range\n\n");
+		printf("Add @name or @index to strike a specific foe\n");
+		printf("Example: strike iron @2");
 		pm(DEFAULT, "\n");
 		return;
 	} else if (ret <= -20)
@@ -291,13 +324,17 @@ cmd_clash(char *cmd)
 		return;
 	}
 
+	if (select_foe_from_cmd(curchar->fight, cmd, 0) == -1)
+		return;
+
 	ret = get_args_from_cmd(cmd, stat, &ival[1]);
 	if (ret >= 10) {
 info:
 		printf("Please specify the stat you'd like to use in this move\n\n");
 		printf("iron\t- You fight in close quarters\n");
-		printf("edge\t- You fight at range\n");
-		printf("Example: clash iron");
+		printf("edge\t- You fight at range\n\n");
+		printf("Add @name or @index to clash with a specific foe\n");
+		printf("Example: clash iron @raider");
 		pm(DEFAULT, "\n");
 		return;
 	} else if (ret <= -20)
@@ -406,13 +443,14 @@ set_initiative(int what)
 		curchar->fight->initiative = 1;
 	else
 		curchar->fight->initiative = 0;
+	mark_dirty();
 }
 
 void
 mark_fight_progress(int what)
 {
 	struct character *curchar = get_current_character();
-	double amount = 0;
+	struct foe *foe;
 
 	if (curchar == NULL) {
 		log_debug("No character loaded.  Cannot calculate progress\n");
@@ -424,39 +462,13 @@ mark_fight_progress(int what)
 		return;
 	}
 
-	switch (curchar->fight->difficulty) {
-	case 1:
-		amount = 3.0;
-		break;
-	case 2:
-		amount = 2;
-		break;
-	case 3:
-		amount = 1;
-		break;
-	case 4:
-		amount = 0.5;
-		break;
-	case 5:
-		amount = 0.25;
-		break;
-	default:
-		curchar->fight->difficulty = 1;
-		log_errx(1, "Unknown difficulty.  This should not happen.  Set to 1\n");
-	}
-
-	if (what == INCREASE)
-		curchar->fight->progress += amount;
-	else
-		curchar->fight->progress -= amount;
-
-	if (curchar->fight->progress > 10) {
-		curchar->fight->progress = 10;
-		if (curchar->strong_hit)
-			pm(DEFAULT, "Your fight is successful.  Consider ending it\n");
-	} else if (curchar->fight->progress < 0)
-		curchar->fight->progress = 0;
+	foe = fight_target(curchar->fight);
+	if (mark_progress(&foe->progress, &foe->difficulty, what) &&
+	    curchar->strong_hit)
+		pm(DEFAULT, "Your fight against %s is successful.  Consider ending it\n",
+		    foe->name);
 
+	mark_dirty();
 	update_prompt();
 }
 
@@ -465,9 +477,11 @@ save_fight(void)
 {
 	struct character *curchar = get_current_character();
 	char path[_POSIX_PATH_MAX];
-	json_object *root, *items, *id;
+	json_object *root, *items, *id, *foes;
 	size_t temp_n, i;
 	int ret;
+	TRACE_FUNC("save");
+	CAMPAIGN_LOCK();
 
 	if (curchar == NULL) {
 		log_debug("No character loaded.  No fight to save.\n");
@@ -479,18 +493,30 @@ save_fight(void)
 		return;
 	}
 
+	/* One record per fight, holding the tracks of all foes */
 	json_object *cobj = json_object_new_object();
 	json_object_object_add(cobj, "id", json_object_new_int(curchar->id));
-	json_object_object_add(cobj, "difficulty", json_object_new_int(curchar->fight->difficulty));
-	json_object_object_add(cobj, "progress", json_object_new_double(curchar->fight->progress));
 	json_object_object_add(cobj, "initiative", json_object_new_int(curchar->fight->initiative));
+	json_object_object_add(cobj, "target", json_object_new_int(curchar->fight->target));
+
+	foes = json_object_new_array();
+	for (i = 0; i < (size_t)curchar->fight->n_foes; i++) {
+		struct foe *foe = &curchar->fight->foes[i];
+		json_object *fobj = json_object_new_object();
+
+		json_object_object_add(fobj, "name", json_object_new_string(foe->name));
+		json_object_object_add(fobj, "difficulty", json_object_new_int(foe->difficulty));
+		json_object_object_add(fobj, "progress", json_object_new_double(foe->progress));
+		json_object_array_add(foes, fobj);
+	}
+	json_object_object_add(cobj, "foes", foes);
 
 	ret = snprintf(path, sizeof(path), "%s/fight.json", get_isscrolls_dir());
 	if (ret < 0 || (size_t)ret >= sizeof(path)) {
 		log_errx(1, "Path truncation happened.  Buffer too short to fit %s\n", path);
 	}
 
-	if ((root = json_object_from_file(path)) == NULL) {
+	if ((root = read_json_file(path)) == NULL) {
 		log_debug("No fight JSON file found\n");
 		root = json_object_new_object();
 		if (!root)
@@ -523,7 +549,7 @@ save_fight(void)
 	}
 
 out:
-	if (json_object_to_file(path, root))
+	if (write_json_file(path, root))
 		printf("Error saving %s\n", path);
 	else
 		log_debug("Successfully saved %s\n", path);
@@ -538,13 +564,14 @@ delete_fight(int id)
 	json_object *root, *lid;
 	size_t temp_n, i;
 	int ret;
+	CAMPAIGN_LOCK();
 
 	ret = snprintf(path, sizeof(path), "%s/fight.json", get_isscrolls_dir());
 	if (ret < 0 || (size_t)ret >= sizeof(path)) {
 		log_errx(1, "Path truncation happened.  Buffer too short to fit %s\n", path);
 	}
 
-	if ((root = json_object_from_file(path)) == NULL) {
+	if ((root = read_json_file(path)) == NULL) {
 		log_debug("No fight JSON file found\n");
 		return;
 	}
@@ -565,7 +592,7 @@ delete_fight(int id)
 		}
 	}
 
-	if (json_object_to_file(path, root))
+	if (write_json_file(path, root))
 		printf("Error saving %s\n", path);
 	else
 		log_debug("Successfully saved %s\n", path);
@@ -577,10 +604,13 @@ void
 load_fight(int id)
 {
 	struct character *curchar = get_current_character();
+	struct fight *f;
 	char path[_POSIX_PATH_MAX];
-	json_object *root, *lid;
-	size_t temp_n, i;
+	json_object *root, *lid, *foes, *val;
+	size_t temp_n, i, n, j;
 	int ret;
+	TRACE_FUNC("load");
+	CAMPAIGN_LOCK();
 
 	if (curchar == NULL) {
 		log_debug("No character loaded\n");
@@ -592,7 +622,7 @@ load_fight(int id)
 		log_errx(1, "Path truncation happened.  Buffer too short to fit %s\n", path);
 	}
 
-	if ((root = json_object_from_file(path)) == NULL) {
+	if ((root = read_json_file(path)) == NULL) {
 		log_debug("No fight JSON file found\n");
 		return;
 	}
@@ -610,32 +640,223 @@ load_fight(int id)
 		if (id == json_object_get_int(lid)) {
 			log_debug("Loading fight for id: %d\n", json_object_get_int(lid));
 
-			curchar->fight->difficulty = validate_int(temp, "difficulty", 0, 5, 1);
-			curchar->fight->progress   = validate_double(temp, "progress", 0, 10, 0);
-			curchar->fight->initiative = validate_int(temp, "initiative", 0, 1, 0);
+			f = curchar->fight;
+			f->initiative = validate_int(temp, "initiative", 0, 1, 0);
+			f->n_foes = 0;
+
+			/* Fights saved before foes existed carry a single track */
+			if (!json_object_object_get_ex(temp, "foes", &foes)) {
+				snprintf(f->foes[0].name, sizeof(f->foes[0].name), "Foe");
+				f->foes[0].difficulty = validate_int(temp, "difficulty", 1, 5, 1);
+				f->foes[0].progress = validate_double(temp, "progress", 0, 10, 0);
+				f->n_foes = 1;
+				f->target = 0;
+				continue;
+			}
+
+			n = json_object_array_length(foes);
+			for (j = 0; j < n && j < MAX_FOES; j++) {
+				json_object *fobj = json_object_array_get_idx(foes, j);
+				struct foe *foe = &f->foes[f->n_foes++];
+
+				/* A foe without a name is called like a new one */
+				if (json_object_object_get_ex(fobj, "name", &val) &&
+				    json_object_get_string(val) != NULL)
+					snprintf(foe->name, sizeof(foe->name), "%s",
+						json_object_get_string(val));
+				else
+					snprintf(foe->name, sizeof(foe->name), "Foe");
+				foe->difficulty = validate_int(fobj, "difficulty", 1, 5, 1);
+				foe->progress = validate_double(fobj, "progress", 0, 10, 0);
+			}
+			f->target = validate_int(temp, "target", 0, MAX_FOES - 1, 0);
+			if (f->target >= f->n_foes)
+				f->target = 0;
 		}
 	}
 
 	json_object_put(root);
 }
 
-void
+int
 ask_for_fight_difficulty(void)
 {
-	struct character *curchar = get_current_character();
-
-	if (curchar == NULL) {
-		log_debug("No character loaded\n");
-		return;
-	}
-
-	printf("Please set a rank for your fight\n\n");
+	printf("Please set a rank for your foe\n\n");
 	printf("1\t - Troublesome foe (3 progress per harm)\n");
 	printf("2\t - Dangerous foe (2 progress per harm)\n");
 	printf("3\t - Formidable foe (1 progress per harm)\n");
 	printf("4\t - Extreme foe (2 ticks per harm)\n");
 	printf("5\t - Epic foe (1 tick per harm)\n\n");
 
-	curchar->fight->difficulty = ask_for_value("Enter a value between 1 and 5: ", 5);
+	return ask_for_value("Enter a value between 1 and 5: ", 5);
+}
+
+/*
+ * Return the foe moves are made against.  A fight always has at least one.
+ */
+struct foe *
+fight_target(struct fight *f)
+{
+	if (f->n_foes == 0) {
+		snprintf(f->foes[0].name, sizeof(f->foes[0].name), "Foe");
+		f->foes[0].difficulty = 1;
+		f->foes[0].progress = 0.0;
+		f->n_foes = 1;
+	}
+
+	if (f->target < 0 || f->target >= f->n_foes)
+		f->target = 0;
+
+	return &f->foes[f->target];
+}
+
+void
+cmd_select_foe(char *cmd)
+{
+	struct character *curchar = get_current_character();
+	struct fight *f;
+	struct foe *foe;
+	int i;
+
+	CURCHAR_CHECK();
+
+	if (curchar->fight_active == 0) {
+		pm(DEFAULT, "You are not in a fight.  Enter one with enterthefray\n");
+		return;
+	}
+
+	f = curchar->fight;
+	if (strlen(cmd) == 0) {
+		for (i = 0; i < f->n_foes; i++) {
+			foe = &f->foes[i];
+			printf("%c %d %-25s Rank: %d Progress: %.2f/10\n",
+			    i == f->target ? '*' : ' ', i + 1, foe->name,
+			    foe->difficulty, foe->progress);
+		}
+		return;
+	}
+
+	if ((foe = find_foe(f, cmd)) == NULL) {
+		printf("There is no foe %s in this fight\n", cmd);
+		return;
+	}
+
+	f->target = foe - f->foes;
+	mark_dirty();
+	pm(DEFAULT, "You now face %s\n", foe->name);
+	update_prompt();
+}
+
+/*
+ * Ask for the foes of a new fight.  An empty name ends the list, the first
+ * foe is called "Foe" if no name is given.
+ */
+static void
+ask_for_foes(struct fight *f)
+{
+	struct foe *foe;
+	char *line;
+
+	f->n_foes = 0;
+	f->target = 0;
+
+	while (f->n_foes < MAX_FOES) {
+		printf("Enter the name of foe %d [empty to %s]: ", f->n_foes + 1,
+		    f->n_foes == 0 ? "skip" : "finish");
+		line = readline(NULL);
+		if ((line == NULL || strlen(line) == 0) && f->n_foes > 0) {
+			free(line);
+			break;
+		}
+
+		foe = &f->foes[f->n_foes++];
+		snprintf(foe->name, sizeof(foe->name), "%s",
+		    line == NULL || strlen(line) == 0 ? "Foe" : line);
+		free(line);
+
+		foe->difficulty = ask_for_fight_difficulty();
+		foe->progress = 0.0;
+
+		/* A nameless foe means a fight against a single foe */
+		if (strcmp(foe->name, "Foe") == 0 && f->n_foes == 1)
+			break;
+	}
 }
 
+/*
+ * Find a foe by its index, starting at 1, or by its name.
+ */
+static struct foe *
+find_foe(struct fight *f, const char *which)
+{
+	char *ep;
+	long lval;
+	int i;
+
+	errno = 0;
+	lval = strtol(which, &ep, 10);
+	if (which[0] != '\0' && *ep == '\0' && errno != ERANGE) {
+		if (lval < 1 || lval > f->n_foes)
+			return NULL;
+		return &f->foes[lval - 1];
+	}
+
+	for (i = 0; i < f->n_foes; i++) {
+		if (strcasecmp(f->foes[i].name, which) == 0)
+			return &f->foes[i];
+	}
+
+	return NULL;
+}
+
+/*
+ * Look for an @foe token in cmd, make that foe the target and cut the token
+ * off.  If bare is set, cmd may also consist of just the foe's name or index.
+ * Returns -1 if the foe does not exist.
+ */
+static int
+select_foe_from_cmd(struct fight *f, char *cmd, int bare)
+{
+	struct foe *foe;
+	char *at;
+
+	if (cmd == NULL || strlen(cmd) == 0)
+		return 0;
+
+	if ((at = strchr(cmd, '@')) == NULL) {
+		if (!bare)
+			return 0;
+		at = cmd;
+	} else
+		at++;
+
+	if ((foe = find_foe(f, at)) == NULL) {
+		printf("There is no foe %s in this fight\n", at);
+		return -1;
+	}
+
+	f->target = foe - f->foes;
+	mark_dirty();
+
+	/* Cut off the foe and trailing spaces */
+	if (at != cmd)
+		at--;
+	*at = '\0';
+	while (at > cmd && at[-1] == ' ')
+		*--at = '\0';
+
+	return 0;
+}
+
+static void
+remove_target_foe(struct fight *f)
+{
+	if (f->n_foes == 0)
+		return;
+
+	memmove(&f->foes[f->target], &f->foes[f->target + 1],
+	    (f->n_foes - f->target - 1) * sizeof(struct foe));
+	f->n_foes--;
+	f->target = 0;
+	mark_dirty();
+}
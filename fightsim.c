@@ -0,0 +1,369 @@
+/*
+ * Copyright (c) 2026 Matthias Schmidt <xhr@giessen.ccc.de>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Monte Carlo simulation of the rest of a fight.  Every simulated fight
+ * follows the rules of cmd_strike(), cmd_clash() and cmd_endure_harm(): strike
+ * while in control, clash otherwise and endure harm equal to the foe's rank
+ * whenever the price has to be paid.  After a strong hit the character tries
+ * to end the fight once progress reaches a threshold, and every threshold
+ * from 1 to 10 is simulated so that the player can see when ending the
+ * fight pays off.
+ *
+ * The fights are split between one thread per core.  Each thread has its
+ * own random number generator and result counters, so nothing is shared
+ * while the simulation runs.
+ */
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "isscrolls.h"
+
+#define FIGHTSIM_FIGHTS		20000	/* Fights per threshold */
+#define FIGHTSIM_MAX_MOVES	200	/* Give up on fights that do not end */
+#define FIGHTSIM_MAX_THREADS	32
+#define FIGHTSIM_THRESHOLDS	10
+
+struct sim_setup {
+	double progress;
+	int rank;
+	int initiative;
+	int strong_hit;
+	int attack;		/* Better of iron and edge */
+	int endure;		/* Better of iron and heart */
+	int health;
+	int momentum;
+	int weapon;
+};
+
+struct sim_result {
+	long wins;
+	long losses;
+	long moves;
+	long health;
+	long momentum;
+};
+
+struct sim_job {
+	const struct sim_setup *s;
+	struct sim_result res[FIGHTSIM_THRESHOLDS];
+	uint64_t rng;
+	long fights;
+	pthread_t thread;
+	int started;
+};
+
+static uint64_t
+sim_next(uint64_t *rng)
+{
+	/* xorshift64* */
+	*rng ^= *rng >> 12;
+	*rng ^= *rng << 25;
+	*rng ^= *rng >> 27;
+
+	return *rng * 2685821657736338717ULL;
+}
+
+static long
+sim_die(uint64_t *rng, int sides)
+{
+	return (long)((sim_next(rng) >> 33) % sides) + 1;
+}
+
+static int
+sim_action_roll(uint64_t *rng, int stat, int momentum)
+{
+	long a1, b, c1, c2;
+
+	a1 = sim_die(rng, 6);
+	/* Negative momentum equal to the action die cancels it */
+	if (momentum < 0 && momentum * -1 == a1)
+		a1 = 0;
+	b = a1 + stat;
+
+	c1 = sim_die(rng, 10);
+	c2 = sim_die(rng, 10);
+
+	if (b <= c1 && b <= c2)
+		return MISS;
+	else if (b <= c1 || b <= c2)
+		return WEAK;
+
+	return STRONG;
+}
+
+static int
+sim_progress_roll(uint64_t *rng, double progress)
+{
+	long c1, c2;
+
+	c1 = sim_die(rng, 10);
+	c2 = sim_die(rng, 10);
+
+	if (progress <= c1 && progress <= c2)
+		return MISS;
+	else if (progress <= c1 || progress <= c2)
+		return WEAK;
+
+	return STRONG;
+}
+
+static void
+sim_harm(const struct sim_setup *s, double *progress, int *rank, int times)
+{
+	int i;
+
+	/* A deadly weapon inflicts one more harm */
+	if (s->weapon == 2)
+		times++;
+
+	for (i = 0; i < times; i++)
+		mark_progress(progress, rank, INCREASE);
+}
+
+/*
+ * Simulate one fight and add its outcome to res.  The character tries to end
+ * the fight after a strong hit as soon as progress reached threshold.
+ */
+static void
+sim_fight(const struct sim_setup *s, uint64_t *rng, int threshold,
+    struct sim_result *res)
+{
+	double progress = s->progress;
+	int rank = s->rank;
+	int initiative = s->initiative;
+	int strong_hit = s->strong_hit;
+	int health = s->health;
+	int momentum = s->momentum;
+	int moves, ret, price;
+
+	for (moves = 0; moves < FIGHTSIM_MAX_MOVES; ) {
+		if (strong_hit && progress >= threshold) {
+			moves++;
+			if (sim_progress_roll(rng, progress) == MISS)
+				res->losses++;
+			else
+				res->wins++;
+			break;
+		}
+
+		moves++;
+		price = 0;
+		ret = sim_action_roll(rng, s->attack, momentum);
+		strong_hit = (ret == STRONG);
+
+		if (initiative) {
+			/* Strike */
+			if (ret == STRONG)
+				sim_harm(s, &progress, &rank, 2);
+			else if (ret == WEAK) {
+				sim_harm(s, &progress, &rank, 1);
+				initiative = 0;
+			} else {
+				initiative = 0;
+				price = 1;
+			}
+		} else {
+			/* Clash */
+			if (ret == STRONG) {
+				sim_harm(s, &progress, &rank, 1);
+				initiative = 1;
+			} else if (ret == WEAK) {
+				sim_harm(s, &progress, &rank, 1);
+				price = 1;
+			} else
+				price = 1;
+		}
+
+		if (!price)
+			continue;
+
+		/* Pay the price by enduring harm equal to the foe's rank */
+		moves++;
+		if (health - s->rank >= 0)
+			health -= s->rank;
+		else {
+			momentum -= s->rank - health;
+			health = 0;
+		}
+		if (momentum < -6)
+			momentum = -6;
+
+		ret = sim_action_roll(rng, s->endure, momentum);
+		strong_hit = (ret == STRONG);
+		if (ret == MISS) {
+			if (momentum > -6)
+				momentum--;
+			/* Maimed, wounded or worse, the fight is lost */
+			if (health == 0) {
+				res->losses++;
+				break;
+			}
+		}
+	}
+
+	res->moves += moves;
+	res->health += s->health - health;
+	res->momentum += s->momentum - momentum;
+}
+
+static void *
+sim_worker(void *arg)
+{
+	struct sim_job *job = arg;
+	long i;
+	int t;
+
+	for (t = 0; t < FIGHTSIM_THRESHOLDS; t++) {
+		for (i = 0; i < job->fights; i++)
+			sim_fight(job->s, &job->rng, t + 1, &job->res[t]);
+	}
+
+	return NULL;
+}
+
+static int
+sim_threads(void)
+{
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (n < 1)
+		return 1;
+	else if (n > FIGHTSIM_MAX_THREADS)
+		return FIGHTSIM_MAX_THREADS;
+
+	return (int)n;
+}
+
+void
+cmd_fight_sim(char *cmd)
+{
+	struct character *curchar = get_current_character();
+	struct sim_job jobs[FIGHTSIM_MAX_THREADS];
+	struct sim_result total[FIGHTSIM_THRESHOLDS];
+	struct sim_setup s;
+	struct timespec start, end;
+	struct foe *foe = NULL;
+	double rate, best = -1.0;
+	long fights;
+	int i, t, n_threads, best_t = 0;
+
+	CURCHAR_CHECK();
+
+	memset(&s, 0, sizeof(s));
+
+	if (curchar->fight_active) {
+		foe = fight_target(curchar->fight);
+		s.progress = foe->progress;
+		s.rank = foe->difficulty;
+		s.initiative = curchar->fight->initiative;
+		s.strong_hit = curchar->strong_hit;
+	} else {
+		/* Not in a fight, so simulate a new one against a foe of the
+		 * given rank */
+		s.rank = get_int_from_cmd(cmd);
+		if (s.rank < 1 || s.rank > 5) {
+			printf("You are not in a fight, so please specify the rank of "\
+				"the foe to simulate a fight against\n\n");
+			printf("1\t - Troublesome foe\n");
+			printf("2\t - Dangerous foe\n");
+			printf("3\t - Formidable foe\n");
+			printf("4\t - Extreme foe\n");
+			printf("5\t - Epic foe\n\n");
+			printf("Example: fightsim 3");
+			pm(DEFAULT, "\n");
+			return;
+		}
+	}
+
+	s.attack = curchar->iron > curchar->edge ? curchar->iron : curchar->edge;
+	s.endure = curchar->iron > curchar->heart ? curchar->iron : curchar->heart;
+	s.health = curchar->health;
+	s.momentum = curchar->momentum;
+	s.weapon = curchar->weapon;
+
+	n_threads = sim_threads();
+	fights = FIGHTSIM_FIGHTS / n_threads;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	memset(jobs, 0, sizeof(jobs));
+	for (i = 0; i < n_threads; i++) {
+		jobs[i].s = &s;
+		jobs[i].fights = fights;
+		/* Seed every thread from the game's generator, never zero */
+		jobs[i].rng = ((uint64_t)random() << 32 | (uint64_t)random()) | 1;
+		if (pthread_create(&jobs[i].thread, NULL, sim_worker, &jobs[i]) == 0)
+			jobs[i].started = 1;
+		else {
+			log_debug("Cannot start simulation thread %d, run it here\n", i);
+			sim_worker(&jobs[i]);
+		}
+	}
+
+	memset(total, 0, sizeof(total));
+	for (i = 0; i < n_threads; i++) {
+		if (jobs[i].started)
+			pthread_join(jobs[i].thread, NULL);
+		for (t = 0; t < FIGHTSIM_THRESHOLDS; t++) {
+			total[t].wins += jobs[i].res[t].wins;
+			total[t].losses += jobs[i].res[t].losses;
+			total[t].moves += jobs[i].res[t].moves;
+			total[t].health += jobs[i].res[t].health;
+			total[t].momentum += jobs[i].res[t].momentum;
+		}
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	log_debug("Simulated %ld fights on %d threads in %.3lfs\n",
+		fights * n_threads * FIGHTSIM_THRESHOLDS, n_threads,
+		(end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9);
+
+	fights *= n_threads;
+
+	printf("Simulated %ld fights against %s (rank %d, progress %.2lf/10) with "\
+		"attack %d, health %d and momentum %d\n\n", fights,
+		foe != NULL ? foe->name : "a new foe", s.rank, s.progress,
+		s.attack, s.health, s.momentum);
+
+	for (t = 0; t < FIGHTSIM_THRESHOLDS; t++) {
+		rate = (double)total[t].wins / fights;
+		if (rate > best) {
+			best = rate;
+			best_t = t;
+		}
+	}
+
+	printf("  End at   Won    Lost   Moves  Harm  Momentum\n");
+	for (t = 0; t < FIGHTSIM_THRESHOLDS; t++) {
+		printf("%c %6d %5.1lf%% %5.1lf%% %7.1lf %5.1lf %9.1lf\n",
+			t == best_t ? '*' : ' ', t + 1,
+			100.0 * total[t].wins / fights,
+			100.0 * total[t].losses / fights,
+			(double)total[t].moves / fights,
+			(double)total[t].health / fights,
+			(double)total[t].momentum / fights);
+	}
+
+	pm(DEFAULT, "\nEnd the fight after a strong hit once progress reaches %d "\
+		"for the best odds\n", best_t + 1);
+}
@@ -0,0 +1,264 @@
+/*
+ * Copyright (c) 2026 Matthias Schmidt <xhr@giessen.ccc.de>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Forecast the rest of a journey or an expedition.  Every roll of
+ * cmd_undertake_a_journey() and cmd_undertake_an_expedition() has the same
+ * odds, so the outcome only depends on the number of waypoints reached and
+ * the supply left.  Instead of simulating, the probability of every
+ * (waypoints, supply) state is propagated roll by roll until nearly all of it
+ * reached the end of the track.  This is exact up to FORECAST_EPSILON and
+ * takes well below a millisecond.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+
+#include "isscrolls.h"
+
+#define FORECAST_MAX_HITS	40	/* An epic track needs 40 ticks */
+#define FORECAST_MAX_SUPPLY	5
+#define FORECAST_MAX_ROLLS	1000
+#define FORECAST_EPSILON	1e-9
+
+struct forecast {
+	double progress[FORECAST_MAX_HITS + 1];	/* Progress after n waypoints */
+	double rolls[FORECAST_MAX_HITS + 1];	/* Expected rolls */
+	int rolls90[FORECAST_MAX_HITS + 1];	/* Rolls needed in 9 of 10 cases */
+	double used[FORECAST_MAX_HITS + 1];	/* Expected supply used */
+	double unprepared[FORECAST_MAX_HITS + 1];
+	double arrive[FORECAST_MAX_HITS + 1];	/* Hit on the final progress roll */
+	int hits;
+};
+
+/*
+ * Compute the chance of a strong and a weak hit for an action roll with the
+ * given stat and momentum.  Negative momentum equal to the action die
+ * cancels it, like in action_roll().
+ */
+static void
+action_odds(int stat, int momentum, double *strong, double *weak)
+{
+	int a1, b, c1, c2;
+	int n_strong = 0, n_weak = 0;
+
+	for (a1 = 1; a1 <= 6; a1++) {
+		b = a1 + stat;
+		if (momentum < 0 && momentum * -1 == a1)
+			b = stat;
+
+		for (c1 = 1; c1 <= 10; c1++) {
+			for (c2 = 1; c2 <= 10; c2++) {
+				if (b > c1 && b > c2)
+					n_strong++;
+				else if (b > c1 || b > c2)
+					n_weak++;
+			}
+		}
+	}
+
+	*strong = n_strong / 600.0;
+	*weak = n_weak / 600.0;
+}
+
+/* Chance of at least a weak hit on a progress roll, like progress_roll() */
+static double
+progress_odds(double progress)
+{
+	int c1, c2, n = 0;
+
+	for (c1 = 1; c1 <= 10; c1++) {
+		for (c2 = 1; c2 <= 10; c2++) {
+			if (progress > c1 || progress > c2)
+				n++;
+		}
+	}
+
+	return n / 100.0;
+}
+
+static void
+compute_forecast(struct forecast *f, double progress, int rank, int stat,
+    int supply, int momentum)
+{
+	double p[FORECAST_MAX_HITS][FORECAST_MAX_SUPPLY + 1];
+	double next[FORECAST_MAX_HITS][FORECAST_MAX_SUPPLY + 1];
+	double reached[FORECAST_MAX_HITS + 1];
+	double strong, weak, miss, left, m;
+	int h, s, n;
+
+	memset(f, 0, sizeof(*f));
+
+	/* Walk the track to find the progress after every waypoint */
+	f->progress[0] = progress;
+	while (f->hits < FORECAST_MAX_HITS && progress < 10) {
+		mark_progress(&progress, &rank, INCREASE);
+		f->progress[++f->hits] = progress;
+	}
+
+	for (h = 0; h <= f->hits; h++)
+		f->arrive[h] = progress_odds(f->progress[h]);
+
+	if (supply < 0)
+		supply = 0;
+	else if (supply > FORECAST_MAX_SUPPLY)
+		supply = FORECAST_MAX_SUPPLY;
+
+	f->unprepared[0] = supply == 0 ? 1.0 : 0.0;
+	if (f->hits == 0)
+		return;
+
+	action_odds(stat, momentum, &strong, &weak);
+	miss = 1.0 - strong - weak;
+
+	memset(p, 0, sizeof(p));
+	memset(reached, 0, sizeof(reached));
+	p[0][supply] = 1.0;
+	left = 1.0;
+
+	/*
+	 * p[h][s] is the chance of having reached h waypoints with s supply
+	 * left.  Probability that reaches a waypoint is recorded for it and
+	 * moves on, once the last waypoint is reached it leaves the table.
+	 */
+	for (n = 1; n <= FORECAST_MAX_ROLLS && left > FORECAST_EPSILON; n++) {
+		memset(next, 0, sizeof(next));
+		left = 0.0;
+
+		for (h = 0; h < f->hits; h++) {
+			for (s = 0; s <= FORECAST_MAX_SUPPLY; s++) {
+				if (p[h][s] == 0.0)
+					continue;
+
+				next[h][s] += p[h][s] * miss;
+
+				/* A strong hit reaches the next waypoint for free */
+				m = p[h][s] * strong;
+				f->rolls[h + 1] += n * m;
+				f->used[h + 1] += (supply - s) * m;
+				if (s == 0)
+					f->unprepared[h + 1] += m;
+				reached[h + 1] += m;
+				if (h + 1 < f->hits)
+					next[h + 1][s] += m;
+
+				/* A weak hit costs one supply */
+				m = p[h][s] * weak;
+				f->rolls[h + 1] += n * m;
+				f->used[h + 1] += (supply - (s > 0 ? s - 1 : 0)) * m;
+				if (s <= 1)
+					f->unprepared[h + 1] += m;
+				reached[h + 1] += m;
+				if (h + 1 < f->hits)
+					next[h + 1][s > 0 ? s - 1 : 0] += m;
+			}
+		}
+
+		for (h = 1; h <= f->hits; h++) {
+			if (f->rolls90[h] == 0 && reached[h] >= 0.9)
+				f->rolls90[h] = n;
+		}
+
+		memcpy(p, next, sizeof(p));
+		for (h = 0; h < f->hits; h++) {
+			for (s = 0; s <= FORECAST_MAX_SUPPLY; s++)
+				left += p[h][s];
+		}
+	}
+
+	log_debug("Forecast converged after %d rolls, %g left\n", n - 1, left);
+
+	/* Turn the sums into values per waypoint reached */
+	for (h = 1; h <= f->hits; h++) {
+		if (reached[h] == 0.0)
+			continue;
+		f->rolls[h] /= reached[h];
+		f->used[h] /= reached[h];
+		f->unprepared[h] /= reached[h];
+	}
+}
+
+static void
+forecast_track(const char *what, double progress, int rank, int stat,
+    int supply, int momentum)
+{
+	struct forecast f;
+	int h;
+
+	compute_forecast(&f, progress, rank, stat, supply, momentum);
+
+	printf("%s with rank %d at %.2lf/10, stat %d, supply %d and momentum %d\n\n",
+		what, rank, progress, stat, supply, momentum);
+	printf("Waypoints  Progress  Rolls  90%% in  Supply used  Unprepared  Arrive\n");
+
+	for (h = 0; h <= f.hits; h++) {
+		/* Only show waypoints that fill a box, and the end of the track */
+		if (h != 0 && h != f.hits &&
+		    f.progress[h] != (int)f.progress[h])
+			continue;
+
+		printf("%9d %9.2lf %6.1lf %7d %12.1lf %10.1lf%% %6.1lf%%\n",
+			h, f.progress[h], f.rolls[h], f.rolls90[h], f.used[h],
+			100.0 * f.unprepared[h], 100.0 * f.arrive[h]);
+	}
+	printf("\n");
+}
+
+void
+cmd_forecast(char *cmd)
+{
+	struct character *curchar = get_current_character();
+	int stat;
+
+	CURCHAR_CHECK();
+
+	if (curchar->journey_active == 0 && curchar->expedition_active == 0) {
+		pm(DEFAULT, "You are neither on a journey nor on an expedition\n");
+		return;
+	}
+
+	/* The expedition stat can be chosen, a journey is always made with wits */
+	if (cmd == NULL || strlen(cmd) == 0 || strcasecmp(cmd, "wits") == 0)
+		stat = curchar->wits;
+	else if (strcasecmp(cmd, "shadow") == 0)
+		stat = curchar->shadow;
+	else if (strcasecmp(cmd, "edge") == 0)
+		stat = curchar->edge;
+	else {
+		printf("Please specify the stat you'll use for the expedition\n\n");
+		printf("wits\t- You are staying vigilant\n");
+		printf("shadow\t- You are keeping a low profile\n");
+		printf("edge\t- You are navigating with speed\n\n");
+		printf("Example: forecast shadow");
+		pm(DEFAULT, "\n");
+		return;
+	}
+
+	if (curchar->journey_active) {
+		forecast_track("Journey", curchar->j->progress,
+			curchar->j->difficulty, curchar->wits, curchar->supply,
+			curchar->momentum);
+	}
+
+	if (curchar->expedition_active) {
+		forecast_track("Expedition", curchar->expedition->progress,
+			curchar->expedition->difficulty, stat, curchar->supply,
+			curchar->momentum);
+	}
+
+	pm(DEFAULT, "Arrive is the chance of a hit when you finish at that progress\n");
+}
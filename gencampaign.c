@@ -0,0 +1,337 @@
+/*
+ * Copyright (c) 2026 Matthias Schmidt <xhr@giessen.ccc.de>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Synthetic campaign generator for scale testing.  The files are streamed
+ * out with stdio instead of being built as json-c trees, so that campaigns
+ * with hundreds of thousands of vows fit into memory.  Character n owns
+ * vow and note n, n + characters, n + 2 * characters and so on, the first
+ * of its vows is the active one.
+ */
+
+#include <sys/param.h>
+#include <sys/stat.h>
+
+#include <err.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <json-c/json.h>
+
+#include "isscrolls.h"
+
+static const char *gen_names[] = {
+	"Arnorn", "Bera", "Cadigan", "Edda", "Gerda", "Haddon", "Ingrid",
+	"Jorrun", "Kolbein", "Lindi", "Magna", "Nessa", "Olfrid", "Rotan",
+	"Svala", "Torvald",
+};
+
+static const char *gen_verbs[] = {
+	"Avenge", "Find", "Protect", "Escort", "Destroy", "Recover",
+	"Unite", "Explore", "Banish", "Rebuild",
+};
+
+static const char *gen_objects[] = {
+	"the clan", "the heirloom", "the ruins", "the barrow", "the mystic",
+	"the village", "the old road", "the wyvern", "the iron shrine",
+	"the lost ship",
+};
+
+static const char *gen_places[] = {
+	"Hinterlands", "Flooded Lands", "Havens", "Ragged Coast", "Deep Wilds",
+	"Tempest Hills", "Veiled Mountains", "Shattered Wastes",
+};
+
+#define GEN_PICK(a)	((a)[random() % (sizeof(a) / sizeof((a)[0]))])
+
+static FILE *
+open_campaign_file(const char *dir, const char *name, char *path, size_t len)
+{
+	FILE *fp;
+	int ret;
+
+	ret = snprintf(path, len, "%s/%s", dir, name);
+	if (ret < 0 || (size_t)ret >= len) {
+		errx(1, "Path truncation happened.  Buffer too short to fit %s", path);
+	}
+
+	if ((fp = fopen(path, "w")) == NULL)
+		err(1, "Cannot create %s", path);
+
+	return fp;
+}
+
+static void
+close_campaign_file(FILE *fp, const char *path)
+{
+	if (ferror(fp) || fclose(fp) == EOF)
+		err(1, "Cannot write %s", path);
+}
+
+static void
+write_characters(const char *dir, const struct campaign_size *cs)
+{
+	char path[_POSIX_PATH_MAX];
+	FILE *fp;
+	long i;
+	int id;
+
+	fp = open_campaign_file(dir, "characters.json", path, sizeof(path));
+	fprintf(fp, "{\"characters\":[");
+	for (i = 0; i < cs->characters; i++) {
+		id = i + 1;
+		fprintf(fp, "%s{\"name\":\"%s%d\",\"id\":%d,\"vid\":%d,",
+		    i ? "," : "", GEN_PICK(gen_names), id, id,
+		    id <= cs->vows ? id : -1);
+		fprintf(fp, "\"edge\":%ld,\"heart\":%ld,\"iron\":%ld,"
+		    "\"shadow\":%ld,\"wits\":%ld,\"exp\":%ld,",
+		    1 + random() % 3, 1 + random() % 3, 1 + random() % 3,
+		    1 + random() % 3, 1 + random() % 3, random() % 31);
+		fprintf(fp, "\"momentum\":%ld,\"max_momentum\":10,"
+		    "\"momentum_reset\":2,\"health\":%ld,\"spirit\":%ld,"
+		    "\"supply\":%ld,", random() % 17 - 6, random() % 6,
+		    random() % 6, random() % 6);
+		fprintf(fp, "\"wounded\":0,\"unprepared\":0,\"shaken\":0,"
+		    "\"encumbered\":0,\"maimed\":0,\"battle_scarred\":0,"
+		    "\"cursed\":0,\"dead\":0,\"weapon\":%ld,\"strong_hit\":0,"
+		    "\"corrupted\":0,\"tormented\":0,\"exp_used\":0,",
+		    1 + random() % 2);
+		fprintf(fp, "\"bonds\":%.2f,\"failure_track\":%.2f,"
+		    "\"legacy_bonds\":%.2f,\"legacy_discoveries\":%.2f,"
+		    "\"legacy_quests\":%.2f,", (random() % 21) / 4.0,
+		    (random() % 41) / 4.0, (random() % 41) / 4.0,
+		    (random() % 41) / 4.0, (random() % 41) / 4.0);
+		fprintf(fp, "\"journey_active\":%d,\"fight_active\":%d,"
+		    "\"delve_active\":%d,\"vow_active\":%d,"
+		    "\"expedition_active\":%d,\"journaling\":0,"
+		    "\"quests\":%.2f,\"discoveries\":%.2f}",
+		    i < cs->journeys, i < cs->fights, i < cs->delves,
+		    id <= cs->vows, i < cs->expeditions,
+		    (random() % 41) / 4.0, (random() % 41) / 4.0);
+	}
+	fprintf(fp, "],\"last_used\":1}\n");
+	close_campaign_file(fp, path);
+}
+
+static void
+write_vows(const char *dir, const struct campaign_size *cs)
+{
+	char path[_POSIX_PATH_MAX], title[MAX_VOW_TITLE];
+	FILE *fp;
+	long i;
+
+	fp = open_campaign_file(dir, "vows.json", path, sizeof(path));
+	fprintf(fp, "{\"vow\":[");
+	for (i = 0; i < cs->vows; i++) {
+		snprintf(title, sizeof(title), "%s %s", GEN_PICK(gen_verbs),
+		    GEN_PICK(gen_objects));
+		fprintf(fp, "%s{\"id\":%ld,\"vid\":%ld,\"fulfilled\":%d,"
+		    "\"difficulty\":%ld,\"progress\":%.2f,\"title\":\"%s\","
+		    "\"description\":\"I swore upon iron to %s in the %s\"}",
+		    i ? "," : "", i % cs->characters + 1, i + 1,
+		    i >= cs->characters && random() % 5 == 0,
+		    1 + random() % 5, (random() % 41) / 4.0, title,
+		    title, GEN_PICK(gen_places));
+	}
+	fprintf(fp, "]}\n");
+	close_campaign_file(fp, path);
+}
+
+static void
+write_notes(const char *dir, const struct campaign_size *cs)
+{
+	char path[_POSIX_PATH_MAX];
+	FILE *fp;
+	long i;
+
+	fp = open_campaign_file(dir, "notes.json", path, sizeof(path));
+	fprintf(fp, "{\"note\":[");
+	for (i = 0; i < cs->notes; i++) {
+		fprintf(fp, "%s{\"id\":%ld,\"nid\":%ld,\"title\":\"%s\","
+		    "\"description\":\"Rumours of %s near the %s\"}",
+		    i ? "," : "", i % cs->characters + 1, i + 1,
+		    GEN_PICK(gen_places), GEN_PICK(gen_objects),
+		    GEN_PICK(gen_places));
+	}
+	fprintf(fp, "]}\n");
+	close_campaign_file(fp, path);
+}
+
+/* journey.json, fight.json, delve.json and expedition.json share a layout */
+static void
+write_tracks(const char *dir, const char *file, const char *key, long n,
+    int initiative)
+{
+	char path[_POSIX_PATH_MAX];
+	FILE *fp;
+	long i;
+
+	fp = open_campaign_file(dir, file, path, sizeof(path));
+	fprintf(fp, "{\"%s\":[", key);
+	for (i = 0; i < n; i++) {
+		fprintf(fp, "%s{\"id\":%ld,\"difficulty\":%ld,\"progress\":%.2f",
+		    i ? "," : "", i + 1, 1 + random() % 5,
+		    (random() % 41) / 4.0);
+		if (initiative)
+			fprintf(fp, ",\"initiative\":%ld", random() % 2);
+		fprintf(fp, "}");
+	}
+	fprintf(fp, "]}\n");
+	close_campaign_file(fp, path);
+}
+
+/*
+ * Write a complete campaign described by cs into dir, which is used as
+ * isscrolls directory as is.  Existing files are overwritten.
+ */
+void
+generate_campaign(const char *dir, const struct campaign_size *cs)
+{
+	struct campaign_size c = *cs;
+
+	if (c.characters < 1)
+		errx(1, "A campaign needs at least one character");
+
+	/* Every character has at most one active track of each kind */
+	c.journeys = MIN(c.journeys, c.characters);
+	c.fights = MIN(c.fights, c.characters);
+	c.delves = MIN(c.delves, c.characters);
+	c.expeditions = MIN(c.expeditions, c.characters);
+
+	srandom(c.seed);
+
+	write_characters(dir, &c);
+	write_vows(dir, &c);
+	write_notes(dir, &c);
+	write_tracks(dir, "journey.json", "journey", c.journeys, 0);
+	write_tracks(dir, "fight.json", "fight", c.fights, 1);
+	write_tracks(dir, "delve.json", "delve", c.delves, 0);
+	write_tracks(dir, "expedition.json", "expedition", c.expeditions, 0);
+}
+
+#ifndef NO_MAIN
+static __attribute__((noreturn)) void
+usage(void)
+{
+	fprintf(stderr, "usage: isscrolls-gencampaign [-c characters] "
+	    "[-D delves] [-e expeditions]\n\t[-f fights] [-j journeys] "
+	    "[-n notes] [-s seed] [-v vows] dir\n");
+	exit(1);
+}
+
+static long
+parse_count(const char *arg)
+{
+	char *ep;
+	long n;
+
+	errno = 0;
+	n = strtol(arg, &ep, 10);
+	if (arg[0] == '\0' || *ep != '\0' || errno == ERANGE || n < 0 ||
+	    n > INT_MAX)
+		errx(1, "invalid count: %s", arg);
+
+	return n;
+}
+
+int
+main(int argc, char **argv)
+{
+	struct campaign_size cs;
+	char dir[_POSIX_PATH_MAX];
+	int ch, ret;
+
+	cs.characters = 100;
+	cs.vows = cs.notes = -1;
+	cs.journeys = cs.fights = cs.delves = cs.expeditions = -1;
+	cs.seed = 1;
+
+	while ((ch = getopt(argc, argv, "c:D:e:f:j:n:s:v:")) != -1) {
+		switch (ch) {
+		case 'c':
+			cs.characters = parse_count(optarg);
+			break;
+		case 'D':
+			cs.delves = parse_count(optarg);
+			break;
+		case 'e':
+			cs.expeditions = parse_count(optarg);
+			break;
+		case 'f':
+			cs.fights = parse_count(optarg);
+			break;
+		case 'j':
+			cs.journeys = parse_count(optarg);
+			break;
+		case 'n':
+			cs.notes = parse_count(optarg);
+			break;
+		case 's':
+			cs.seed = parse_count(optarg);
+			break;
+		case 'v':
+			cs.vows = parse_count(optarg);
+			break;
+		default:
+			usage();
+		}
+	}
+
+	argc -= optind;
+	argv += optind;
+
+	if (argc != 1)
+		usage();
+
+	/* Defaults: ten vows and notes per character, half of them travel */
+	if (cs.vows == -1)
+		cs.vows = cs.characters * 10;
+	if (cs.notes == -1)
+		cs.notes = cs.characters * 10;
+	if (cs.journeys == -1)
+		cs.journeys = cs.characters / 2;
+	if (cs.fights == -1)
+		cs.fights = cs.characters / 4;
+	if (cs.delves == -1)
+		cs.delves = cs.characters / 4;
+	if (cs.expeditions == -1)
+		cs.expeditions = cs.characters / 4;
+
+	/* Write into dir/isscrolls so that dir can be used as XDG_CONFIG_HOME */
+	ret = snprintf(dir, sizeof(dir), "%s/isscrolls", argv[0]);
+	if (ret < 0 || (size_t)ret >= sizeof(dir))
+		errx(1, "Path truncation happened.  Buffer too short to fit %s", dir);
+	if (mkdir(argv[0], 0755) == -1 && errno != EEXIST)
+		err(1, "mkdir %s", argv[0]);
+	if (mkdir(dir, 0755) == -1 && errno != EEXIST)
+		err(1, "mkdir %s", dir);
+
+	generate_campaign(dir, &cs);
+
+	printf("Wrote %ld characters, %ld vows, %ld notes, %ld journeys, "
+	    "%ld fights, %ld delves and %ld expeditions to %s\n",
+	    cs.characters, cs.vows, cs.notes, MIN(cs.journeys, cs.characters),
+	    MIN(cs.fights, cs.characters), MIN(cs.delves, cs.characters),
+	    MIN(cs.expeditions, cs.characters), dir);
+
+	return 0;
+}
+#endif /* NO_MAIN */
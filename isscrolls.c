@@ -38,14 +38,30 @@ static char isscrolls_dir[_POSIX_PATH_MAX];
 static int debug = 0;
 static int color = 0;
 static int cursed = 0;
-static int banner = 1;
+static int perf = 0;
 static int output = 1;
+/* Threads that resolve moves without a console, like the simulator's */
+static _Thread_local int quiet = 0;
 
 static volatile sig_atomic_t sflag = 0;
 
+/*
+ * All console output of a command, printf() and pm() alike, collects in one
+ * buffer that is written with a single write(2) once the command is done or
+ * readline asks for input.  pm() takes its escape sequences from color_on,
+ * which holds empty strings if colors are disabled.
+ */
+#define OUTPUT_BUF_SIZE	65536
+
+static const char *color_on[COLORS + 1] = { "", "", "", "", "", "", "", "" };
+static const char *color_off = "";
+
 FILE *journal_file = NULL;
 int journal_this = 0;
 
+#ifndef NO_MAIN
+static int banner = 1;
+
 static void
 signal_handler(int signal)
 {
@@ -56,6 +72,7 @@ signal_handler(int signal)
 			break;
 	}
 }
+#endif /* NO_MAIN */
 
 void
 show_banner(__attribute__((unused)) char *unused)
@@ -78,9 +95,12 @@ show_banner(__attribute__((unused)) char *unused)
 	printf("Enter 'help' for available commands\n\n");
 }
 
+#ifndef NO_MAIN
 int
 main(int argc, char **argv)
 {
+	static char output_buf[OUTPUT_BUF_SIZE];
+	const char *client_path = NULL, *daemon_path = NULL;
 	char *line, *res;
 	int ch;
 
@@ -90,17 +110,38 @@ main(int argc, char **argv)
 	 */
 	srandom(time(NULL) ^ getpid());
 
-	while ((ch = getopt(argc, argv, "cdbx")) != -1) {
+	/* Must happen before anything is printed */
+	setvbuf(stdout, output_buf, _IOFBF, sizeof(output_buf));
+
+	while ((ch = getopt(argc, argv, "C:cdD:bf:Pt:x")) != -1) {
 		switch (ch) {
 		case 'b':
 			banner = 0;
 			break;
+		case 'C':
+			client_path = optarg;
+			break;
 		case 'c':
 			color = 1;
+			setup_colors();
 			break;
 		case 'd':
 			debug = 1;
 			break;
+		case 'D':
+			daemon_path = optarg;
+			banner = 0;
+			break;
+		case 'f':
+			if (set_character_format(optarg) == -1)
+				log_errx(1, "Unknown character format %s\n", optarg);
+			break;
+		case 'P':
+			perf = 1;
+			break;
+		case 't':
+			enable_tracing(optarg);
+			break;
 		case 'x':
 			cursed = 1;
 			break;
@@ -110,6 +151,9 @@ main(int argc, char **argv)
 	argc -= optind;
 	argv += optind;
 
+	if (client_path != NULL)
+		return run_client(client_path);
+
 	setup_base_dir();
 
 	initialize_readline(isscrolls_dir);
@@ -122,13 +166,26 @@ main(int argc, char **argv)
 	if (signal(SIGTERM, signal_handler) == SIG_ERR)
 		log_errx(1, "signal");
 
+	if (daemon_path != NULL && open_daemon_socket(daemon_path) == -1)
+		log_errx(1, "Cannot start the daemon\n");
+
 	sandbox(isscrolls_dir);
 
+	start_oracle_watch();
+
 	if (load_characters_list() == -1)
 		set_prompt("> ");
 
+	start_autosave();
+
+	fflush(stdout);
+	while (daemon_path != NULL && !sflag)
+		serve_next_client();
+
 	while (!sflag) {
+		autosave_idle();
 		line = readline(prompt);
+		autosave_busy();
 		if (line == NULL)
 			continue;
 		res = stripwhite(line);
@@ -137,6 +194,7 @@ main(int argc, char **argv)
 			add_history(res);
 			execute_command(res);
 		}
+		fflush(stdout);
 
 		free(line);
 	}
@@ -145,11 +203,12 @@ main(int argc, char **argv)
 
 	return 0;
 }
+#endif /* NO_MAIN */
 
 void
 set_prompt(const char *p)
 {
-	if (p == NULL || strlen(p) == 0)
+	if (p == NULL || strlen(p) == 0 || quiet)
 		return;
 
 	if (color)
@@ -166,10 +225,14 @@ sandbox(const char *dir)
 		log_errx(1, "unveil");
 	if (unveil(dir, "rwc") == -1)
 		log_errx(1, "unveil");
+	if (get_daemon_socket() != NULL &&
+	    unveil(get_daemon_socket(), "rwc") == -1)
+		log_errx(1, "unveil");
 	if (unveil(NULL, NULL) == -1)
 		log_errx(1, "unveil");
 
-	if (pledge("stdio rpath wpath cpath tty", NULL) == -1)
+	if (pledge(get_daemon_socket() != NULL ? "stdio rpath wpath cpath flock tty unix" :
+	    "stdio rpath wpath cpath flock tty", NULL) == -1)
 		log_errx(1, "pledge");
 }
 #else
@@ -190,6 +253,8 @@ initiate_shutdown(int exit_code)
 	char hist_path[_POSIX_PATH_MAX];
 	int ret;
 
+	/* Let a running autosave finish, everything is saved below */
+	stop_autosave();
 	save_current_character();
 
 	ret = snprintf(hist_path, sizeof(hist_path), "%s/history", isscrolls_dir);
@@ -200,7 +265,13 @@ initiate_shutdown(int exit_code)
 	log_debug("Writing history to %s\n", hist_path);
 	write_history(hist_path);
 
+	close_daemon_socket();
 	close_journal_file();
+	free_oracle_tables();
+
+	if (perf)
+		print_stats();
+	flush_trace();
 
 	exit(exit_code);
 }
@@ -255,6 +326,9 @@ log_errx(int prio, const char *fmt, ...)
 {
 	va_list ap;
 
+	/* Keep the order with what is still buffered for the console */
+	fflush(stdout);
+
 	va_start(ap, fmt);
 	vfprintf(stderr, fmt, ap);
 	va_end(ap);
@@ -262,37 +336,30 @@ log_errx(int prio, const char *fmt, ...)
 	initiate_shutdown(prio);
 }
 
+void
+setup_colors(void)
+{
+	color_on[RED] = ANSI_COLOR_RED;
+	color_on[YELLOW] = ANSI_COLOR_YELLOW;
+	color_on[GREEN] = ANSI_COLOR_GREEN;
+	color_on[BLUE] = ANSI_COLOR_CYAN;
+	color_off = ANSI_COLOR_RESET;
+}
+
 void
 pm(int what, const char *fmt, ...)
 {
 	va_list ap;
 
-	if (color && (what & NO_CONSOLE) == 0) {
-		switch (what & COLORS) {
-		case RED:
-			printf("%s", ANSI_COLOR_RED);
-			break;
-		case YELLOW:
-			printf("%s", ANSI_COLOR_YELLOW);
-			break;
-		case GREEN:
-			printf("%s", ANSI_COLOR_GREEN);
-			break;
-		case BLUE:
-			printf("%s", ANSI_COLOR_CYAN);
-			break;
-		default:
-			break;
-		}
-	}
+	if (quiet)
+		return;
+
 	if ((what & NO_CONSOLE) == 0) {
+		fputs(color_on[what & COLORS], stdout);
 		va_start(ap, fmt);
 		vprintf(fmt, ap);
 		va_end(ap);
-	}
-
-	if (color && (what & NO_CONSOLE) == 0) {
-		printf("%s", ANSI_COLOR_RESET);
+		fputs(color_off, stdout);
 	}
 
 	if ((what & NO_JOURNAL) == 0 && journal_this != 0) {
@@ -332,6 +399,24 @@ get_cursed(void)
 	return cursed;
 }
 
+void
+set_cursed(int value)
+{
+	cursed = value;
+}
+
+void
+set_quiet(int value)
+{
+	quiet = value;
+}
+
+int
+get_quiet(void)
+{
+	return quiet;
+}
+
 void
 print_to_journal(const char *format, ...)
 {
@@ -344,6 +429,7 @@ print_to_journal(const char *format, ...)
 void
 print_to_journal_v(const char *format, va_list *args)
 {
+	TRACE_FUNC("journal");
 
 	if (journaling() == 0)
 		return;
@@ -367,6 +453,7 @@ start_journal_entry(void)
 	char path[_POSIX_PATH_MAX];
 	time_t t;
 	struct tm *tm_ptr;
+	TRACE_FUNC("journal");
 
 	if (journaling() == 0)
 		return;
@@ -17,11 +17,10 @@
 #ifndef ISSCROLLS_H
 #define ISSCROLLS_H
 
-#include <sys/queue.h>
-
 #include <json-c/json.h>
 
 #include <stdarg.h>
+#include <stdint.h>
 #include <stdio.h>
 
 #define VERSION "2026.a"
@@ -41,6 +40,13 @@
 #define MAX_NOTE_DESC 255
 #define MAX_NOTES 255
 
+#define MAX_THREAT_NAME 25
+#define MAX_THREAT_GOAL 255
+#define MAX_THREATS 255
+
+#define MAX_FOE_NAME 25
+#define MAX_FOES 8
+
 #define STAT_WITS 	0x00001
 #define STAT_EDGE 	0x00010
 #define STAT_HEART 	0x00100
@@ -63,6 +69,72 @@
 	} 																\
 } while(0)
 
+struct threat {
+	char *name;
+	char *category;
+	char *goal;
+	double menace;
+	int id;
+	int tid;
+	int vid;
+	int difficulty;
+};
+
+enum event_types {
+	EVENT_ACTION_ROLL,
+	EVENT_PROGRESS_ROLL,
+	EVENT_CHANGE,
+};
+
+enum event_sinks {
+	SINK_CONSOLE = 1,
+	SINK_JOURNAL = 2,
+	SINK_JSON = 4,
+	SINK_DEFAULT = SINK_CONSOLE | SINK_JOURNAL,
+};
+
+/* Outcome of an action or a progress roll */
+struct roll_event {
+	long action;		/* Action die, 0 if cancelled by momentum */
+	long challenge[2];
+	long cursed;		/* Cursed die, 10 is a cursed result */
+	double score;		/* Action score or progress */
+	int stat;
+	int bonus;		/* -1 without a bonus */
+	int result;		/* MISS, WEAK or STRONG */
+	int match;
+};
+
+/* A character value changed from one value to another */
+struct change_event {
+	const char *what;
+	double from;
+	double to;
+	int is_double;
+};
+
+struct event {
+	int type;
+	union {
+		struct roll_event roll;
+		struct change_event change;
+	};
+};
+
+struct foe {
+	char name[MAX_FOE_NAME + 1];
+	double progress;
+	int difficulty;
+};
+
+struct fight {
+	struct foe foes[MAX_FOES];
+	int id;
+	int n_foes;
+	int target;		/* Index of the foe moves are made against */
+	int initiative;
+};
+
 struct note {
 	char *title;
 	char *description;
@@ -70,6 +142,47 @@ struct note {
 	int nid;
 };
 
+enum char_field_type {
+	FIELD_STRING,
+	FIELD_INT,
+	FIELD_DOUBLE,
+};
+
+/*
+ * Description of a character field.  key is the name in characters.json,
+ * min, max and def are used when loading and creating a character.  cmd is
+ * the name used by increase and decrease, limit the upper bound for them if
+ * it differs from max, or limit_key names the field holding the bound.
+ * Changing the field is refused while the blocker condition is set.
+ * Fields with a row are shown by print_character() using fmt.
+ */
+struct char_field {
+	const char *key;
+	size_t offset;
+	enum char_field_type type;
+	double min;
+	double max;
+	double def;
+	const char *cmd;
+	double limit;
+	const char *limit_key;
+	const char *blocker;
+	double step;
+	int row;
+	const char *fmt;
+};
+
+struct campaign_size {
+	long characters;
+	long vows;
+	long notes;
+	long journeys;
+	long fights;
+	long delves;
+	long expeditions;
+	unsigned int seed;
+};
+
 /* oracle.c */
 void cmd_show_iron_name(char *);
 void cmd_show_elf_name(char *);
@@ -90,10 +203,23 @@ void cmd_show_pay_the_price(char *);
 void cmd_reveal_a_danger(char *);
 void cmd_find_an_opportunity(char *);
 void cmd_generate_npc(char *);
+void cmd_generate(char *);
+void cmd_oracle(char *);
+void cmd_no_repeat(char *);
+void save_draws(void);
+void load_draws(int);
+void free_draws(void);
+void *detach_draws(void);
+void attach_draws(void *);
 void cmd_show_settlement_trouble(char *);
 void show_info_from_oracle(int, int, int);
 void convert_to_lowercase(char *);
 void read_oracle_from_json(int, int);
+long roll_on_oracle_table(const char *, const char *, char *, size_t);
+void cmd_generate_monstrosity(char *);
+void free_oracle_tables(void);
+void start_oracle_watch(void);
+void sync_oracle_tables(void);
 
 /* readline.c */
 char ** my_completion(const char *, int, int);
@@ -130,6 +256,8 @@ void cmd_write_your_epilogue(char *);
 long roll_action_die(void);
 long roll_challenge_die(void);
 long roll_oracle_die(void);
+void seed_thread_rng(uint64_t);
+const struct roll_event *last_action_roll(void);
 void yes_or_no(int);
 int action_roll(int[2]);
 int progress_roll(double[2]);
@@ -143,6 +271,7 @@ void show_banner(char *);
 void log_debug(const char *, ...);
 void log_errx(int, const char *, ...);
 void pm(int, const char *, ...);
+void setup_colors(void);
 void setup_base_dir(void);
 void initiate_shutdown(int) __attribute__((noreturn));
 void sandbox(const char *);
@@ -154,6 +283,9 @@ int get_output(void);
 int get_color(void);
 int get_si(void);
 int get_cursed(void);
+void set_cursed(int);
+void set_quiet(int);
+int get_quiet(void);
 int get_ironsworn(void);
 const char * get_isscrolls_dir(void);
 extern FILE *journal_file;
@@ -178,10 +310,14 @@ void save_character(void);
 void delete_saved_character(int);
 int load_character(int) __attribute((warn_unused_result));
 struct character * get_current_character(void);
+void set_thread_character(struct character *);
+void release_character(struct character *);
 int return_character_id(const char *) __attribute((warn_unused_result));
 int return_char_stat(const char *, int) __attribute((warn_unused_result));
 int load_characters_list(void)  __attribute((warn_unused_result));
 void save_current_character(void);
+void sync_campaign(void);
+void flush_character_cache(void);
 void cmd_increase_value(char *);
 void cmd_decrease_value(char *);
 void cmd_toggle(char *);
@@ -200,6 +336,13 @@ void modify_double(const char *, double *, double, double, double, int);
 void toggle_value(const char *, int *);
 void change_momentum_reset(int);
 void set_max_momentum(void);
+extern const struct char_field char_fields[];
+extern const size_t n_char_fields;
+void character_from_json(struct character *, json_object *);
+json_object *character_to_json(struct character *);
+void add_list_entry(int, const char *);
+int check_int_range(const char *, int, int, int, int);
+double check_double_range(const char *, double, double, double, double);
 int validate_int(json_object *, const char *, int, int, int);
 double validate_double(json_object *, const char *, double, double, double);
 int character_exists(const char *) __attribute((warn_unused_result));
@@ -231,11 +374,57 @@ void cmd_battle(char *);
 void cmd_endure_harm(char *);
 void cmd_take_decisive_action(char *);
 void mark_fight_progress(int);
-void ask_for_fight_difficulty(void);
+int ask_for_fight_difficulty(void);
+struct foe *fight_target(struct fight *);
+void cmd_select_foe(char *);
 void cmd_end_the_fight(char *);
 void set_initiative(int);
 void cmd_get_initiative(__attribute__((unused)) char *unused);
 
+/* fightsim.c */
+void cmd_fight_sim(char *);
+
+/* forecast.c */
+void cmd_forecast(char *);
+
+/* events.c */
+void emit_event(const struct event *);
+int get_event_sinks(void);
+void set_event_sinks(int);
+void cmd_events(char *);
+
+/* autosave.c */
+void start_autosave(void);
+void stop_autosave(void);
+void mark_dirty(void);
+void autosave_idle(void);
+void autosave_busy(void);
+void autosave_barrier(void);
+
+/* daemon.c */
+int open_daemon_socket(const char *);
+void close_daemon_socket(void);
+const char *get_daemon_socket(void);
+void serve_next_client(void);
+int run_client(const char *);
+
+/* lock.c */
+struct campaign_lock {
+	int held;
+};
+
+/* Hold the campaign lock from here to the end of the enclosing scope */
+#define CAMPAIGN_LOCK() \
+	struct campaign_lock campaign_lock_ __attribute__((cleanup(unlock_campaign))) = \
+	    lock_campaign()
+
+struct campaign_lock lock_campaign(void);
+void unlock_campaign(struct campaign_lock *);
+void note_campaign_write(void);
+uint64_t campaign_write_generation(void);
+int campaign_changed(void);
+void campaign_synced(void);
+
 /* delve.c */
 void cmd_discover_a_site(char *);
 void cmd_delve_the_depths(char *);
@@ -297,6 +486,87 @@ void save_note(struct note *);
 __attribute((warn_unused_result)) int load_note(int, struct note *);
 void delete_note(int);
 
+/* truths.c */
+void cmd_world_truths(char *);
+void save_truths(void);
+void load_truths(int);
+void free_truths(void);
+void *detach_truths(void);
+void attach_truths(void *);
+
+/* stats.c */
+uint64_t stats_now(void);
+json_object *read_json_file(const char *);
+int write_json_file(const char *, json_object *);
+void stats_command(const char *, uint64_t);
+void stats_rng_draw(void);
+void cmd_show_stats(char *);
+void print_stats(void);
+
+/* trace.c */
+struct trace_span {
+	const char *name;
+	const char *cat;
+	const char *detail;
+	uint64_t start;
+};
+
+/* Record a span from here to the end of the enclosing scope */
+#define TRACE_SPAN(name, cat, detail) \
+	struct trace_span trace_span_ __attribute__((cleanup(trace_end))) = \
+	    trace_begin((name), (cat), (detail))
+#define TRACE_FUNC(cat) TRACE_SPAN(__func__, (cat), NULL)
+
+void enable_tracing(const char *);
+struct trace_span trace_begin(const char *, const char *, const char *);
+void trace_end(struct trace_span *);
+void flush_trace(void);
+
+/* threat.c */
+void cmd_create_threat(char *);
+void cmd_show_threats(char *);
+void cmd_advance_threat(char *);
+void cmd_link_threat(char *);
+void cmd_delete_threat(char *);
+void advance_threats_of_vow(int);
+void mark_threat_menace(struct threat *, int);
+void save_threats(void);
+void load_threats(int);
+void free_threats(void);
+void *detach_threats(void);
+void attach_threats(void *);
+
+/* track.c */
+int mark_progress(double *, int *, int);
+
+/* snapshot.c */
+int set_character_format(const char *);
+int use_snapshot(void);
+void sync_character_store(void);
+int snapshot_load_character(int, struct character *);
+int snapshot_load_list(void (*)(int, const char *), int *);
+int snapshot_save_character(struct character *);
+int snapshot_character_saved(struct character *);
+void snapshot_set_last_used(int);
+void snapshot_delete_character(int);
+int snapshot_import(int);
+int snapshot_export(void);
+void cmd_snapshot(char *);
+
+/* roster.c */
+void roster_clear(void);
+void roster_add(int, const char *);
+void roster_remove(int);
+int roster_find_name(const char *);
+int roster_contains(int);
+size_t roster_count(void);
+const char *roster_name_at(size_t);
+void roster_set_generation(int, uint64_t);
+uint64_t roster_generation(int);
+
+/* gencampaign.c */
+void generate_campaign(const char *, const struct campaign_size *);
+
 enum oracle_codes {
 	ORACLE_IS_NAMES,
 	ORACLE_ELF_NAMES,
@@ -327,16 +597,6 @@ enum oracle_codes {
 	ORACLE_SETTLEMENT_TROUBLE,
 };
 
-enum oracle_json {
-	JSON_CHARACTERS,
-	JSON_NAMES,
-	JSON_MOVES,
-	JSON_ACTION,
-	JSON_TURNING,
-	JSON_PLACES,
-	JSON_SETTLEMENT,
-};
-
 enum dice_results {
 	MISS = 2,
 	MISS_MATCH = 12,
@@ -377,13 +637,6 @@ struct journey {
 	int difficulty;
 };
 
-struct fight {
-	double progress;
-	int id;
-	int difficulty;
-	int initiative;
-};
-
 struct expedition {
 	double progress;
 	int id;
@@ -397,8 +650,10 @@ struct delve {
 };
 
 struct vow {
-	char *title;
-	char *description;
+	char *title;		/* Points to title_buf or NULL */
+	char *description;	/* Points to description_buf or NULL */
+	char title_buf[MAX_VOW_TITLE + 1];
+	char description_buf[MAX_VOW_DESC + 1];
 	double progress;
 	int difficulty;
 	int id;
@@ -453,12 +708,8 @@ struct character {
 	int vid;
 	int strong_hit;
 	int journaling;
-};
-
-struct entry {
-	LIST_ENTRY(entry) entries;
-	char name[255];
-	int id;
+	uint64_t generation;	/* Campaign generation it was last saved in */
+	int changed;		/* Changed since it was last saved */
 };
 
 #endif
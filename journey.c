@@ -53,6 +53,7 @@ cmd_undertake_a_journey(char *cmd)
 	if (curchar->journey_active == 0) {
 		ask_for_journey_difficulty();
 		curchar->journey_active = 1;
+		mark_dirty();
 	}
 
 	ret = action_roll(ival);
@@ -103,6 +104,7 @@ cmd_reach_your_destination(char *cmd)
 		reach_your_destination_failed();
 	}
 
+	mark_dirty();
 	update_prompt();
 }
 
@@ -110,7 +112,6 @@ void
 mark_journey_progress(int what)
 {
 	struct character *curchar = get_current_character();
-	double amount = 0;
 
 	CURCHAR_CHECK();
 
@@ -119,38 +120,10 @@ mark_journey_progress(int what)
 		return;
 	}
 
-	switch (curchar->j->difficulty) {
-	case 1:
-		amount = 3.0;
-		break;
-	case 2:
-		amount = 2.0;
-		break;
-	case 3:
-		amount = 1.0;
-		break;
-	case 4:
-		amount = 0.5;
-		break;
-	case 5:
-		amount = 0.25;
-		break;
-	default:
-		curchar->j->difficulty = 1;
-		log_errx(1, "Unknown difficulty.  This should not happen.  Set it to 1\n");
-	}
-
-	if (what == INCREASE)
-		curchar->j->progress += amount;
-	else
-		curchar->j->progress -= amount;
-
-	if (curchar->j->progress > 10) {
+	if (mark_progress(&curchar->j->progress, &curchar->j->difficulty, what))
 		pm(DEFAULT, "Your reached all milestones of your journey.  Consider ending it\n");
-		curchar->j->progress = 10;
-	} else if (curchar->j->progress < 0)
-		curchar->j->progress = 0;
 
+	mark_dirty();
 	update_prompt();
 }
 
@@ -191,6 +164,8 @@ save_journey(void)
 	json_object *root, *items, *id;
 	size_t temp_n, i;
 	int ret;
+	TRACE_FUNC("save");
+	CAMPAIGN_LOCK();
 
 	if (curchar == NULL) {
 		log_debug("No character loaded.  No journey to save.\n");
@@ -214,7 +189,7 @@ save_journey(void)
 		log_errx(1, "Path truncation happened.  Buffer too short to fit %s\n", path);
 	}
 
-	if ((root = json_object_from_file(path)) == NULL) {
+	if ((root = read_json_file(path)) == NULL) {
 		log_debug("No journey JSON file found\n");
 		root = json_object_new_object();
 		if (!root)
@@ -247,7 +222,7 @@ save_journey(void)
 	}
 
 out:
-	if (json_object_to_file(path, root))
+	if (write_json_file(path, root))
 		printf("Error saving %s\n", path);
 	else
 		log_debug("Successfully saved %s\n", path);
@@ -262,13 +237,14 @@ delete_journey(int id)
 	json_object *root, *lid;
 	size_t temp_n, i;
 	int ret;
+	CAMPAIGN_LOCK();
 
 	ret = snprintf(path, sizeof(path), "%s/journey.json", get_isscrolls_dir());
 	if (ret < 0 || (size_t)ret >= sizeof(path)) {
 		log_errx(1, "Path truncation happened.  Buffer too short to fit %s\n", path);
 	}
 
-	if ((root = json_object_from_file(path)) == NULL) {
+	if ((root = read_json_file(path)) == NULL) {
 		log_debug("No journey JSON file found\n");
 		return;
 	}
@@ -289,7 +265,7 @@ delete_journey(int id)
 		}
 	}
 
-	if (json_object_to_file(path, root))
+	if (write_json_file(path, root))
 		printf("Error saving %s\n", path);
 	else
 		log_debug("Successfully saved %s\n", path);
@@ -305,6 +281,8 @@ load_journey(int id)
 	json_object *root, *lid;
 	size_t temp_n, i;
 	int ret;
+	TRACE_FUNC("load");
+	CAMPAIGN_LOCK();
 
 	if (curchar == NULL) {
 		log_debug("No character loaded\n");
@@ -316,7 +294,7 @@ load_journey(int id)
 		log_errx(1, "Path truncation happened.  Buffer too short to fit %s\n", path);
 	}
 
-	if ((root = json_object_from_file(path)) == NULL) {
+	if ((root = read_json_file(path)) == NULL) {
 		log_debug("No journey JSON file found\n");
 		return;
 	}
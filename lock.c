@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2026 Matthias Schmidt <xhr@giessen.ccc.de>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Several isscrolls processes may share one configuration directory.  Every
+ * function that reads or writes the campaign's files holds an advisory lock
+ * on the lock file in that directory, so that the read, modify and write of
+ * one process is never interleaved with another one.  The lock nests, only
+ * the outermost holder takes and releases the file lock.
+ *
+ * The lock file also holds the campaign's generation, which is increased
+ * whenever a holder of the lock wrote something.  A process that sees a
+ * generation it doesn't know has to pick up what others saved.
+ */
+
+#include <sys/file.h>
+#include <sys/types.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "isscrolls.h"
+
+static pthread_once_t lock_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t lock_mtx;
+
+static int lock_fd = -1;
+static int lock_depth = 0;
+static int lock_wrote = 0;
+
+static uint64_t disk_generation = 0;	/* As read when the lock was taken */
+static uint64_t seen_generation = 0;	/* Last one we are up to date with */
+
+static void
+init_lock(void)
+{
+	pthread_mutexattr_t attr;
+	char path[_POSIX_PATH_MAX];
+	int ret;
+
+	/* Threads of one process nest like the functions of one thread */
+	pthread_mutexattr_init(&attr);
+	pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+	pthread_mutex_init(&lock_mtx, &attr);
+	pthread_mutexattr_destroy(&attr);
+
+	ret = snprintf(path, sizeof(path), "%s/lock", get_isscrolls_dir());
+	if (ret < 0 || (size_t)ret >= sizeof(path)) {
+		log_errx(1, "Path truncation happened.  Buffer too short to fit %s\n", path);
+	}
+
+	if ((lock_fd = open(path, O_RDWR | O_CREAT, 0644)) == -1)
+		log_debug("Cannot open %s, running without file lock: %s\n", path,
+			strerror(errno));
+}
+
+static uint64_t
+read_generation(void)
+{
+	char buf[32];
+	ssize_t n;
+
+	if (lock_fd == -1)
+		return 0;
+
+	if ((n = pread(lock_fd, buf, sizeof(buf) - 1, 0)) <= 0)
+		return 0;
+	buf[n] = '\0';
+
+	return strtoull(buf, NULL, 10);
+}
+
+static void
+write_generation(uint64_t gen)
+{
+	char buf[32];
+	int len;
+
+	if (lock_fd == -1)
+		return;
+
+	len = snprintf(buf, sizeof(buf), "%llu\n", (unsigned long long)gen);
+	if (pwrite(lock_fd, buf, len, 0) != len || ftruncate(lock_fd, len) == -1)
+		log_debug("Cannot update the campaign generation: %s\n",
+			strerror(errno));
+}
+
+struct campaign_lock
+lock_campaign(void)
+{
+	struct campaign_lock l = { 1 };
+
+	pthread_once(&lock_once, init_lock);
+	pthread_mutex_lock(&lock_mtx);
+
+	if (lock_depth++ > 0)
+		return l;
+
+	if (lock_fd != -1 && flock(lock_fd, LOCK_EX | LOCK_NB) == -1) {
+		log_debug("Waiting for another isscrolls to finish saving\n");
+		while (flock(lock_fd, LOCK_EX) == -1 && errno == EINTR)
+			;
+	}
+
+	disk_generation = read_generation();
+	lock_wrote = 0;
+
+	return l;
+}
+
+void
+unlock_campaign(struct campaign_lock *l)
+{
+	if (l->held == 0)
+		return;
+
+	if (--lock_depth == 0) {
+		if (lock_wrote) {
+			write_generation(disk_generation + 1);
+			/* Our own write is nothing we have to pick up later */
+			if (seen_generation == disk_generation)
+				seen_generation = disk_generation + 1;
+		}
+		if (lock_fd != -1)
+			flock(lock_fd, LOCK_UN);
+	}
+
+	l->held = 0;
+	pthread_mutex_unlock(&lock_mtx);
+}
+
+/* Called by everything that writes campaign files while holding the lock */
+void
+note_campaign_write(void)
+{
+	if (lock_depth > 0)
+		lock_wrote = 1;
+}
+
+/* The generation the campaign will have once the current holder is done */
+uint64_t
+campaign_write_generation(void)
+{
+	note_campaign_write();
+
+	return disk_generation + 1;
+}
+
+/* Did another process save something since campaign_synced()? */
+int
+campaign_changed(void)
+{
+	return disk_generation != seen_generation;
+}
+
+void
+campaign_synced(void)
+{
+	seen_generation = disk_generation;
+}
@@ -68,19 +68,24 @@ descagain:
 		goto descagain;
 	}
 
-	/* Every new note gets a highest ID (nid) ... */
-	n.nid = get_max_note_id();
+	/* Nobody else may take the ID until the note is saved */
+	{
+		CAMPAIGN_LOCK();
 
-	/* If we don't have any notes yet, start with 1 */
-	if (n.nid == -1)
-		n.nid = 1;
-	else
-		n.nid++;
+		/* Every new note gets a highest ID (nid) ... */
+		n.nid = get_max_note_id();
 
-	/* ... and belongs to one character (id) */
-	n.id = curchar->id;
+		/* If we don't have any notes yet, start with 1 */
+		if (n.nid == -1)
+			n.nid = 1;
+		else
+			n.nid++;
 
-	save_note(&n);
+		/* ... and belongs to one character (id) */
+		n.id = curchar->id;
+
+		save_note(&n);
+	}
 	free_note(&n);
 }
 
@@ -168,6 +173,7 @@ cmd_show_all_notes(__attribute__((unused)) char *unused)
 	json_object *root, *title, *description, *nid, *id;
 	size_t temp_n, i;
 	int ret;
+	CAMPAIGN_LOCK();
 
 	if (curchar == NULL) {
 		log_debug("No character loaded\n");
@@ -179,7 +185,7 @@ cmd_show_all_notes(__attribute__((unused)) char *unused)
 		log_errx(1, "Path truncation happened.  Buffer too short to fit %s\n", path);
 	}
 
-	if ((root = json_object_from_file(path)) == NULL) {
+	if ((root = read_json_file(path)) == NULL) {
 		log_debug("No note JSON file found (%s)\n", path);
 		return;
 	}
@@ -219,6 +225,8 @@ get_max_note_id(void)
 	json_object *root, *nid, *id;
 	size_t temp_n, i;
 	int ret, tvid, max;
+	CAMPAIGN_LOCK();
+
 	tvid = max = 0;
 
 	if (curchar == NULL) {
@@ -231,7 +239,7 @@ get_max_note_id(void)
 		log_errx(1, "Path truncation happened.  Buffer too short to fit %s\n", path);
 	}
 
-	if ((root = json_object_from_file(path)) == NULL) {
+	if ((root = read_json_file(path)) == NULL) {
 		log_debug("No note JSON file found (%s)\n", path);
 		return -1;
 	}
@@ -272,6 +280,8 @@ save_note(struct note *n)
 	json_object *root, *items, *id, *nid_json;
 	size_t temp_n, i;
 	int ret;
+	TRACE_FUNC("save");
+	CAMPAIGN_LOCK();
 
 	if (curchar == NULL) {
 		log_debug("No character loaded.  No note to save.\n");
@@ -295,7 +305,7 @@ save_note(struct note *n)
 		log_errx(1, "Path truncation happened.  Buffer too short to fit %s\n", path);
 	}
 
-	if ((root = json_object_from_file(path)) == NULL) {
+	if ((root = read_json_file(path)) == NULL) {
 		log_debug("No note JSON file found (%s)\n", path);
 		root = json_object_new_object();
 		if (!root)
@@ -329,7 +339,7 @@ save_note(struct note *n)
 	}
 
 out:
-	if (json_object_to_file(path, root))
+	if (write_json_file(path, root))
 		printf("Error saving %s\n", path);
 	else
 		log_debug("Successfully saved %s\n", path);
@@ -346,6 +356,8 @@ load_note(int nid, struct note *n)
 	json_object *root, *lid, *title, *desc, *id;
 	size_t temp_n, i;
 	int rval, ret = -1;
+	TRACE_FUNC("load");
+	CAMPAIGN_LOCK();
 
 	if (curchar == NULL) {
 		log_debug("No character loaded\n");
@@ -357,7 +369,7 @@ load_note(int nid, struct note *n)
 		log_errx(1, "Path truncation happened.  Buffer too short to fit %s\n", path);
 	}
 
-	if ((root = json_object_from_file(path)) == NULL) {
+	if ((root = read_json_file(path)) == NULL) {
 		log_debug("No note JSON file found (%s)\n", path);
 		return ret;
 	}
@@ -417,13 +429,14 @@ delete_note(int nid)
 	json_object *root, *lid;
 	size_t temp_n, i;
 	int ret;
+	CAMPAIGN_LOCK();
 
 	ret = snprintf(path, sizeof(path), "%s/notes.json", get_isscrolls_dir());
 	if (ret < 0 || (size_t)ret >= sizeof(path)) {
 		log_errx(1, "Path truncation happened.  Buffer too short to fit %s\n", path);
 	}
 
-	if ((root = json_object_from_file(path)) == NULL) {
+	if ((root = read_json_file(path)) == NULL) {
 		log_debug("No note JSON file found (%s)\n", path);
 		return;
 	}
@@ -445,7 +458,7 @@ delete_note(int nid)
 		}
 	}
 
-	if (json_object_to_file(path, root))
+	if (write_json_file(path, root))
 		printf("Error saving %s\n", path);
 	else
 		log_debug("Successfully saved %s\n", path);
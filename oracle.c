@@ -18,259 +18,803 @@
 
 #include <json-c/json.h>
 
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif
+
 #include <ctype.h>
+#include <dirent.h>
+#include <errno.h>
 #include <limits.h>
+#include <pthread.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+
+#ifndef nitems
+#define nitems(_a) (sizeof((_a)) / sizeof((_a)[0]))
+#endif
+
+#define CHARACTER_JSON "ironsworn_oracles_character.json"
+#define NAMES_JSON "ironsworn_oracles_names.json"
+#define MOVES_JSON "ironsworn_move_oracles.json"
+#define PROMPTS_JSON "ironsworn_oracles_prompts.json"
+#define TURNING_POINT_JSON "ironsworn_oracles_turning_point.json"
+#define PLACE_JSON "ironsworn_oracles_place.json"
+#define SETTLEMENT_JSON "ironsworn_oracles_settlement.json"
+#define MONSTROSITY_JSON "ironsworn_oracles_monstrosity.json"
+#define MAX_TEMPLATE_OUTPUT 1024
+#define MAX_TEMPLATE_REF 64
+#define MAX_GENERATE_COUNT 1000
+
+/*
+ * Oracle tables are parsed once per session and stay resident afterwards.
+ * Every table carries a slot array with one element per possible die result
+ * pointing to the matching entry, so rolling on a table is an array access.
+ */
+struct oracle_entry {
+	char *desc;
+	int chance;
+};
+
+struct oracle_table {
+	char *name;
+	struct oracle_entry *entries;
+	unsigned short *slot;
+	size_t n_entries;
+	int max;
+	unsigned int set_id;	/* Of the set the table was compiled into */
+	const char *file;	/* Of the oracle file the set belongs to */
+};
+
+/*
+ * All tables compiled from one file.  A changed file is compiled into a new
+ * set that replaces the old one as a whole.
+ */
+struct oracle_set {
+	struct oracle_table *tables;
+	size_t n_tables;
+	struct oracle_set *next;
+};
+
+struct oracle_file {
+	char *file;
+	char *path;
+	struct oracle_set *set;
+};
+
+static struct oracle_file *oracle_files = NULL;
+static size_t n_oracle_files = 0;
+
+/* Protects oracle_files against the watcher thread and the retired sets */
+static pthread_mutex_t oracle_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct oracle_set *retired_sets = NULL;
+static unsigned int oracle_generation = 0;
+static unsigned int oracle_set_ids = 0;
+
+#ifdef __linux__
+static struct {
+	char dir[_POSIX_PATH_MAX];
+	int wd;
+} watch_dirs[2];
+static pthread_t watch_thread;
+#endif
+static int watch_fd = -1;
+
+static const struct {
+	const char *file;
+	const char *table;
+} oracle_sources[] = {
+	[ORACLE_IS_NAMES] = { NAMES_JSON, "Ironlander Names" },
+	[ORACLE_ELF_NAMES] = { NAMES_JSON, "Elf Names" },
+	[ORACLE_GIANT_NAMES] = { NAMES_JSON, "Giant Names" },
+	[ORACLE_VAROU_NAMES] = { NAMES_JSON, "Varou Names" },
+	[ORACLE_TROLL_NAMES] = { NAMES_JSON, "Troll Names" },
+	[ORACLE_ACTIONS] = { PROMPTS_JSON, "Action" },
+	[ORACLE_THEMES] = { PROMPTS_JSON, "Theme" },
+	[ORACLE_RANKS] = { TURNING_POINT_JSON, "Challenge Rank" },
+	[ORACLE_COMBAT_ACTIONS] = { TURNING_POINT_JSON, "Combat Action" },
+	[ORACLE_PLOT_TWISTS] = { TURNING_POINT_JSON, "Major Plot Twist" },
+	[ORACLE_MYSTIC_BACKSLASH] = { TURNING_POINT_JSON, "Mystic Backlash" },
+	[ORACLE_REGION] = { PLACE_JSON, "Region" },
+	[ORACLE_LOCATION] = { PLACE_JSON, "Location" },
+	[ORACLE_COASTAL] = { PLACE_JSON, "Coastal Waters Location" },
+	[ORACLE_DESCRIPTION] = { PLACE_JSON, "Location Descriptors" },
+	[ORACLE_PAYTHEPRICE] = { MOVES_JSON, "Pay the Price" },
+	[ORACLE_DELVE_THE_DEPTHS_EDGE] = { MOVES_JSON, "Delve the Depths - Edge" },
+	[ORACLE_DELVE_THE_DEPTHS_SHADOW] = { MOVES_JSON, "Delve the Depths - Shadow" },
+	[ORACLE_DELVE_THE_DEPTHS_WITS] = { MOVES_JSON, "Delve the Depths - Wits" },
+	[ORACLE_DELVE_OPPORTUNITY] = { MOVES_JSON, "Find an Opportunity" },
+	[ORACLE_DELVE_DANGER] = { MOVES_JSON, "Reveal a Danger" },
+	[ORACLE_CHAR_ROLE] = { CHARACTER_JSON, "Role" },
+	[ORACLE_CHAR_GOAL] = { CHARACTER_JSON, "Goal" },
+	[ORACLE_CHAR_DESC] = { CHARACTER_JSON, "Descriptor" },
+	[ORACLE_CHAR_DISPOSITION] = { CHARACTER_JSON, "Disposition" },
+	[ORACLE_CHAR_ACTIVITY] = { CHARACTER_JSON, "Activity" },
+	[ORACLE_SETTLEMENT_TROUBLE] = { SETTLEMENT_JSON, "Settlement Trouble" },
+};
+
+static const char *oracle_share_files[] = {
+	CHARACTER_JSON,
+	NAMES_JSON,
+	PLACE_JSON,
+	PROMPTS_JSON,
+	SETTLEMENT_JSON,
+	TURNING_POINT_JSON,
+	"ironsworn_oracles_threat.json",
+	MONSTROSITY_JSON,
+	MOVES_JSON,
+	NULL
+};
+
+/* Short names used by the oracle commands that differ from the table name */
+static const struct {
+	const char *alias;
+	const char *file;
+	const char *table;
+} oracle_aliases[] = {
+	{ "ironlandername", NAMES_JSON, "Ironlander Names" },
+	{ "elfname", NAMES_JSON, "Elf Names" },
+	{ "giantname", NAMES_JSON, "Giant Names" },
+	{ "varouname", NAMES_JSON, "Varou Names" },
+	{ "trollname", NAMES_JSON, "Troll Names" },
+	{ "locationdescription", PLACE_JSON, "Location Descriptors" },
+	{ "coastalwaterlocation", PLACE_JSON, "Coastal Waters Location" },
+	{ "plottwist", TURNING_POINT_JSON, "Major Plot Twist" },
+	{ "rank", TURNING_POINT_JSON, "Challenge Rank" },
+	{ NULL, NULL, NULL }
+};
+
+/*
+ * A template consists of literal text and references to oracle tables.  The
+ * references are resolved when the template is compiled.
+ */
+struct template_part {
+	const struct oracle_table *table;
+	char *text;
+	int lower;
+};
+
+struct generator {
+	char *name;
+	struct template_part *parts;
+	size_t n_parts;
+};
+
+static const struct {
+	const char *name;
+	const char *template;
+} builtin_generators[] = {
+	{ "npc", "{ironlandername} the {role|lower} is a {descriptor|lower} person "
+	    "whose goal is to {goal|lower}." },
+	{ "place", "{locationdescription} {location|lower} in the {region}" },
+	{ NULL, NULL }
+};
+
+/*
+ * No-repeat state of one table for the current character.  used is a bitset
+ * of the drawn entries, faces holds the die faces of all entries not drawn
+ * yet and pos the position of every face in faces.  faces and pos were built
+ * for the table of set set_id with max faces, 0 means they need a rebuild.
+ * States belong to a table name in an oracle file, so that a user file can
+ * have a table named like a shared one.
+ */
+struct oracle_draws {
+	char *name;
+	char *file;		/* NULL for states saved without a file */
+	unsigned char *used;
+	unsigned short *faces;
+	unsigned short *pos;
+	size_t n_entries;
+	unsigned int set_id;
+	int max;
+	int remaining;
+};
+
+static struct oracle_draws *draws = NULL;
+static size_t n_draws = 0;
+static int draws_dirty = 0;
+static int norepeat = 0;
+
+struct draws_state {
+	struct oracle_draws *draws;
+	size_t n_draws;
+	int dirty;
+	int norepeat;
+};
+
+static struct generator *generators = NULL;
+static size_t n_generators = 0;
+static unsigned int generators_generation = 0;
+
+static const struct oracle_set *load_oracle_file(const char *);
+static const struct oracle_set *parse_oracle_file(const char *, const char *, int);
+static const struct oracle_set *oracle_file_set(const struct oracle_file *);
+static struct oracle_set *compile_oracle_set(const char *);
+static void free_oracle_set(struct oracle_set *);
+static void free_oracle_table(struct oracle_table *);
+static void set_oracle_file(struct oracle_set *, const char *);
+static void stop_oracle_watch(void);
+#ifdef __linux__
+static void *oracle_watch_loop(void *);
+static int oracle_file_is_resident(const char *);
+#endif
+static int compile_oracle_table(struct oracle_table *, json_object *);
+static const struct oracle_table *find_oracle_table(const char *, const char *);
+static const char *roll_on_table(const struct oracle_table *, long *);
+static void print_oracle_roll(const char *, const char *, const char *);
+static void print_table_roll(const char *, const struct oracle_table *);
+static void load_user_oracles(void);
+static void generate_from_template(const char *, long);
+static void render_generator(const struct generator *, char *, size_t);
+static void load_generators(void);
+static int compile_template(struct generator *, const char *, const char *);
+static void free_generators(void);
+static const struct oracle_table *lookup_oracle_table(const char *);
+static int oracle_name_matches(const char *, const char *);
+static const char *draw_without_repeat(const struct oracle_table *, long *);
+static void remove_face(struct oracle_draws *, size_t);
+static struct oracle_draws *get_draws(const struct oracle_table *);
+static void rebuild_draws(struct oracle_draws *, const struct oracle_table *);
 
 void
 read_oracle_from_json(int focus, int generate)
 {
-	char path[_POSIX_PATH_MAX], temp_name[255];
-	json_object *root, *oracles, *temp, *table, *name, *desc, *chance;
-	size_t n_oracles, n_entries, i, j;
+	const struct oracle_table *t;
+	char temp_name[255];
+	const char *desc;
 	long die;
-	int what, ret, id, id_temp, max = 100, action;
-
-	switch(focus) {
-		case ORACLE_CHAR_ROLE:
-		case ORACLE_CHAR_GOAL:
-		case ORACLE_CHAR_DESC:
-		case ORACLE_CHAR_DISPOSITION:
-		case ORACLE_CHAR_ACTIVITY:
-			action = JSON_CHARACTERS;
-			ret = snprintf(path, sizeof(path), "%s/ironsworn_oracles_character.json", PATH_SHARE_DIR);
-			break;
-		case ORACLE_IS_NAMES:
-		case ORACLE_ELF_NAMES:
-		case ORACLE_VAROU_NAMES:
-		case ORACLE_TROLL_NAMES:
-			action = JSON_NAMES;
-			max = 200;
-			ret = snprintf(path, sizeof(path), "%s/ironsworn_oracles_names.json", PATH_SHARE_DIR);
-			break;
-		case ORACLE_PAYTHEPRICE:
-		case ORACLE_DELVE_THE_DEPTHS_EDGE:
-		case ORACLE_DELVE_THE_DEPTHS_SHADOW:
-		case ORACLE_DELVE_THE_DEPTHS_WITS:
-		case ORACLE_DELVE_OPPORTUNITY:
-		case ORACLE_DELVE_DANGER:
-			action = JSON_MOVES;
-			ret = snprintf(path, sizeof(path), "%s/ironsworn_move_oracles.json", PATH_SHARE_DIR);
-			break;
-		case ORACLE_ACTIONS:
-		case ORACLE_THEMES:
-			action = JSON_ACTION;
-			ret = snprintf(path, sizeof(path), "%s/ironsworn_oracles_prompts.json", PATH_SHARE_DIR);
-			break;
-		case ORACLE_RANKS:
-		case ORACLE_COMBAT_ACTIONS:
-		case ORACLE_PLOT_TWISTS:
-		case ORACLE_MYSTIC_BACKSLASH:
-			action = JSON_TURNING;
-			ret = snprintf(path, sizeof(path), "%s/ironsworn_oracles_turning_point.json", PATH_SHARE_DIR);
-			break;
-		case ORACLE_REGION:
-		case ORACLE_LOCATION:
-		case ORACLE_COASTAL:
-		case ORACLE_DESCRIPTION:
-			action = JSON_PLACES;
-			ret = snprintf(path, sizeof(path), "%s/ironsworn_oracles_place.json", PATH_SHARE_DIR);
-			break;
-		case ORACLE_SETTLEMENT_TROUBLE:
-			action = JSON_SETTLEMENT;
-			ret = snprintf(path, sizeof(path), "%s/ironsworn_oracles_settlement.json", PATH_SHARE_DIR);
-			break;
-		default:
-			log_debug("Unknown focus.  Abort\n");
-			return;
+	TRACE_FUNC("oracle");
+
+	if (focus < 0 || (size_t)focus >= nitems(oracle_sources) ||
+	    oracle_sources[focus].file == NULL) {
+		log_debug("Unknown oracle %d.  Abort\n", focus);
+		return;
+	}
+
+	if ((t = find_oracle_table(oracle_sources[focus].file,
+	    oracle_sources[focus].table)) == NULL) {
+		printf("Cannot roll on the %s oracle\n", oracle_sources[focus].table);
+		return;
+	}
+
+	desc = roll_on_table(t, &die);
+
+	/* User called 'generatenpc' so avoid newlines */
+	if (generate) {
+		snprintf(temp_name, sizeof(temp_name), "%s", desc);
+		convert_to_lowercase(temp_name);
+		printf("%s", temp_name);
+	} else
+		printf("%s <%ld>\n", desc, die);
+}
+
+/*
+ * Roll on the oracle table named table inside the JSON file called file and
+ * copy the description into buf.  The file is looked up in PATH_SHARE_DIR.
+ * Returns the die roll or -1 if the table cannot be found.
+ */
+long
+roll_on_oracle_table(const char *file, const char *table, char *buf, size_t len)
+{
+	const struct oracle_table *t;
+	const char *desc;
+	long die;
+	TRACE_FUNC("oracle");
+
+	if (buf == NULL || len == 0)
+		return -1;
+
+	buf[0] = '\0';
+
+	if ((t = find_oracle_table(file, table)) == NULL)
+		return -1;
+
+	desc = roll_on_table(t, &die);
+	snprintf(buf, len, "%s", desc);
+
+	return die;
+}
+
+/*
+ * Free the oracle sets the watcher replaced since the last command.  Called
+ * before a command runs, so nothing points into them anymore.
+ */
+void
+sync_oracle_tables(void)
+{
+	struct oracle_set *set, *next;
+
+	pthread_mutex_lock(&oracle_lock);
+	set = retired_sets;
+	retired_sets = NULL;
+	pthread_mutex_unlock(&oracle_lock);
+
+	for (; set != NULL; set = next) {
+		next = set->next;
+		free_oracle_set(set);
+	}
+}
+
+void
+free_oracle_tables(void)
+{
+	size_t i;
+
+	stop_oracle_watch();
+
+	/* Generators point into the tables, so they go first */
+	free_generators();
+	sync_oracle_tables();
+
+	for (i = 0; i < n_oracle_files; i++) {
+		free_oracle_set(oracle_files[i].set);
+		free(oracle_files[i].file);
+		free(oracle_files[i].path);
+	}
+
+	free(oracle_files);
+	oracle_files = NULL;
+	n_oracle_files = 0;
+}
+
+static void
+free_oracle_set(struct oracle_set *set)
+{
+	size_t i;
+
+	if (set == NULL)
+		return;
+
+	for (i = 0; i < set->n_tables; i++)
+		free_oracle_table(&set->tables[i]);
+
+	free(set->tables);
+	free(set);
+}
+
+/* Tell the tables of set which oracle file they are from */
+static void
+set_oracle_file(struct oracle_set *set, const char *file)
+{
+	size_t i;
+
+	for (i = 0; i < set->n_tables; i++)
+		set->tables[i].file = file;
+}
+
+static void
+free_oracle_table(struct oracle_table *t)
+{
+	size_t i;
+
+	if (t->entries != NULL) {
+		for (i = 0; i < t->n_entries; i++)
+			free(t->entries[i].desc);
 	}
+	free(t->entries);
+	free(t->slot);
+	free(t->name);
+	memset(t, 0, sizeof(struct oracle_table));
+}
+
+static const char *
+roll_on_table(const struct oracle_table *t, long *die)
+{
+	if (norepeat)
+		return draw_without_repeat(t, die);
+
+	stats_rng_draw();
+	*die = (random() % t->max) + 1;
+
+	return t->entries[t->slot[*die - 1]].desc;
+}
 
+static const struct oracle_table *
+find_oracle_table(const char *file, const char *table)
+{
+	const struct oracle_set *set;
+	size_t i;
+
+	if ((set = load_oracle_file(file)) == NULL)
+		return NULL;
+
+	for (i = 0; i < set->n_tables; i++) {
+		if (strcmp(set->tables[i].name, table) == 0)
+			return &set->tables[i];
+	}
+
+	log_debug("Cannot find oracle table %s in %s\n", table, file);
+
+	return NULL;
+}
+
+/*
+ * The watcher thread replaces the set of a file, so always read it through
+ * here.
+ */
+static const struct oracle_set *
+oracle_file_set(const struct oracle_file *of)
+{
+	return __atomic_load_n(&of->set, __ATOMIC_ACQUIRE);
+}
+
+/*
+ * Return the tables of file, parse and compile them on first use.
+ */
+static const struct oracle_set *
+load_oracle_file(const char *file)
+{
+	char path[_POSIX_PATH_MAX];
+	size_t i;
+	int ret;
+
+	for (i = 0; i < n_oracle_files; i++) {
+		if (strcmp(oracle_files[i].file, file) == 0)
+			return oracle_file_set(&oracle_files[i]);
+	}
+
+	ret = snprintf(path, sizeof(path), "%s/%s", PATH_SHARE_DIR, file);
 	if (ret < 0 || (size_t)ret >= sizeof(path)) {
 		log_errx(1, "Path truncation happened.  Buffer too short to fit %s\n", path);
 	}
 
-	if ((root = json_object_from_file(path)) == NULL) {
-		log_errx(1, "Cannot open %s\n", path);
+	return parse_oracle_file(file, path, 1);
+}
+
+/*
+ * Parse the oracle file at path and remember its tables under the name file.
+ * A missing shared file is fatal, a broken user file is skipped.
+ */
+static const struct oracle_set *
+parse_oracle_file(const char *file, const char *path, int required)
+{
+	struct oracle_file *of;
+	struct oracle_set *set;
+
+	if ((set = compile_oracle_set(path)) == NULL) {
+		if (required)
+			log_errx(1, "Cannot read %s\n", path);
+		printf("Cannot read oracle file %s\n", path);
+		return NULL;
+	}
+
+	/* The watcher walks the list, so do not move it under its feet */
+	pthread_mutex_lock(&oracle_lock);
+	of = reallocarray(oracle_files, n_oracle_files + 1, sizeof(struct oracle_file));
+	if (of == NULL)
+		log_errx(1, "reallocarray oracle files\n");
+	oracle_files = of;
+	of = &oracle_files[n_oracle_files];
+	memset(of, 0, sizeof(struct oracle_file));
+
+	if ((of->file = strdup(file)) == NULL)
+		log_errx(1, "strdup\n");
+	if ((of->path = strdup(path)) == NULL)
+		log_errx(1, "strdup\n");
+	set_oracle_file(set, of->file);
+	of->set = set;
+	n_oracle_files++;
+	pthread_mutex_unlock(&oracle_lock);
+
+	return set;
+}
+
+/*
+ * Read the oracle file at path and compile all of its tables into a new set.
+ * Returns NULL if the file cannot be read or we run out of memory.  The
+ * watcher thread calls this, too, so it must not take the fatal path.
+ */
+static struct oracle_set *
+compile_oracle_set(const char *path)
+{
+	struct oracle_set *set = NULL;
+	json_object *root, *oracles;
+	size_t n_oracles, i;
+	unsigned int set_id;
+	int ret;
+	TRACE_FUNC("oracle");
+
+	if ((root = read_json_file(path)) == NULL) {
+		log_debug("Cannot open %s\n", path);
+		return NULL;
 	}
 
 	if (!json_object_object_get_ex(root, "Oracles", &oracles)) {
 		log_debug("Cannot find a [Oracles] array in %s\n", path);
-		return;
+		json_object_put(root);
+		return NULL;
 	}
 
-	memset(temp_name, 0, sizeof(temp_name));
-
-again:
-	die = roll_oracle_die();
-	if (die < 0 || die > max)
-		goto again;
-
 	n_oracles = json_object_array_length(oracles);
+	if ((set = calloc(1, sizeof(struct oracle_set))) == NULL ||
+	    (set->tables = calloc(n_oracles, sizeof(struct oracle_table))) == NULL) {
+		log_debug("calloc oracle set\n");
+		goto fail;
+	}
+
+	/* Draw states tell the tables of a reloaded file apart by it */
+	set_id = __atomic_add_fetch(&oracle_set_ids, 1, __ATOMIC_RELAXED);
 
-	log_debug("number of oracles: %lu\n", n_oracles);
 	for (i = 0; i < n_oracles; i++) {
-		temp = json_object_array_get_idx(oracles, i);
-		json_object_object_get_ex(temp, "Oracle Table", &table);
-		json_object_object_get_ex(temp, "Name", &name);
-		log_debug("Name %s\n", json_object_get_string(name));
-
-		switch (action) {
-			case JSON_CHARACTERS:
-				if ((strcmp(json_object_get_string(name), "Role") == 0))
-					what = ORACLE_CHAR_ROLE;
-				else if ((strcmp(json_object_get_string(name), "Goal") == 0))
-					what = ORACLE_CHAR_GOAL;
-				else if ((strcmp(json_object_get_string(name), "Descriptor") == 0))
-					what = ORACLE_CHAR_DESC;
-				else if ((strcmp(json_object_get_string(name), "Disposition") == 0))
-					what = ORACLE_CHAR_DISPOSITION;
-				else if ((strcmp(json_object_get_string(name), "Activity") == 0))
-					what = ORACLE_CHAR_ACTIVITY;
-				else {
-					what = -1;
-					continue;
-				}
-				break;
-			case JSON_MOVES:
-				if ((strcmp(json_object_get_string(name), "Pay the Price") == 0))
-					what = ORACLE_PAYTHEPRICE;
-				else if ((strcmp(json_object_get_string(name), "Delve the Depths - Edge") == 0))
-					what = ORACLE_DELVE_THE_DEPTHS_EDGE;
-				else if ((strcmp(json_object_get_string(name), "Delve the Depths - Shadow") == 0))
-					what = ORACLE_DELVE_THE_DEPTHS_SHADOW;
-				else if ((strcmp(json_object_get_string(name), "Delve the Depths - Wits") == 0))
-					what = ORACLE_DELVE_THE_DEPTHS_WITS;
-				else if ((strcmp(json_object_get_string(name), "Find an Opportunity") == 0))
-					what = ORACLE_DELVE_OPPORTUNITY;
-				else if ((strcmp(json_object_get_string(name), "Reveal a Danger") == 0))
-					what = ORACLE_DELVE_DANGER;
-				else {
-					what = -1;
-					continue;
-				}
-				break;
-			case JSON_ACTION:
-				if ((strcmp(json_object_get_string(name), "Action") == 0))
-					what = ORACLE_ACTIONS;
-				else if ((strcmp(json_object_get_string(name), "Theme") == 0))
-					what = ORACLE_THEMES;
-				/* The following oracles are not yet supported */
-				else if ((strcmp(json_object_get_string(name), "Feature") == 0))
-					continue;
-				else if ((strcmp(json_object_get_string(name), "Focus") == 0))
-					continue;
-				else if ((strcmp(json_object_get_string(name), "Trap") == 0))
-					continue;
-				else if ((strcmp(json_object_get_string(name), "Combat Event") == 0))
-					continue;
-				else {
-					what = -1;
-					continue;
-				}
-				break;
-			case JSON_TURNING:
-				if ((strcmp(json_object_get_string(name), "Challenge Rank") == 0))
-					what = ORACLE_RANKS;
-				else if ((strcmp(json_object_get_string(name), "Combat Action") == 0))
-					what = ORACLE_COMBAT_ACTIONS;
-				else if ((strcmp(json_object_get_string(name), "Major Plot Twist") == 0))
-					what = ORACLE_PLOT_TWISTS;
-				else if ((strcmp(json_object_get_string(name), "Mystic Backlash") == 0))
-					what = ORACLE_MYSTIC_BACKSLASH;
-				else {
-					what = -1;
-					continue;
-				}
-				break;
-			case JSON_PLACES:
-				if ((strcmp(json_object_get_string(name), "Region") == 0))
-					what = ORACLE_REGION;
-				else if ((strcmp(json_object_get_string(name), "Location") == 0))
-					what = ORACLE_LOCATION;
-				else if ((strcmp(json_object_get_string(name), "Coastal Waters Location") == 0))
-					what = ORACLE_COASTAL;
-				else if ((strcmp(json_object_get_string(name), "Location Descriptors") == 0))
-					what = ORACLE_DESCRIPTION;
-				else {
-					what = -1;
-					continue;
-				}
-				break;
-			case JSON_NAMES:
-				if ((strcmp(json_object_get_string(name), "Ironlander Names") == 0))
-					what = ORACLE_IS_NAMES;
-				else if ((strcmp(json_object_get_string(name), "Elf Names") == 0))
-					what = ORACLE_ELF_NAMES;
-				else if ((strcmp(json_object_get_string(name), "Giant Names") == 0))
-					what = ORACLE_GIANT_NAMES;
-				else if ((strcmp(json_object_get_string(name), "Varou Names") == 0))
-					what = ORACLE_VAROU_NAMES;
-				else if ((strcmp(json_object_get_string(name), "Troll Names") == 0))
-					what = ORACLE_TROLL_NAMES;
-				else {
-					what = -1;
-					continue;
-				}
-				break;
-			case JSON_SETTLEMENT:
-				if ((strcmp(json_object_get_string(name), "Settlement Trouble") == 0))
-					what = ORACLE_SETTLEMENT_TROUBLE;
-				else {
-					what = -1;
-					continue;
-				}
-				break;
-			default:
-				log_debug("Unknown action.  Abort\n");
-				return;
+		ret = compile_oracle_table(&set->tables[set->n_tables],
+		    json_object_array_get_idx(oracles, i));
+		if (ret == -2)
+			goto fail;
+		if (ret == 0)
+			set->tables[set->n_tables++].set_id = set_id;
+	}
+
+	log_debug("Compiled %zu oracle tables from %s\n", set->n_tables, path);
+
+	json_object_put(root);
+
+	return set;
+fail:
+	free_oracle_set(set);
+	json_object_put(root);
+
+	return NULL;
+}
+
+#ifdef __linux__
+/*
+ * Watch the directories with oracle files.  Whenever a file that is already
+ * resident is written, its tables are compiled in this thread and swapped in
+ * as a whole.  The old set is freed by the command loop.
+ */
+static void *
+oracle_watch_loop(__attribute__((unused)) void *arg)
+{
+	char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	char path[_POSIX_PATH_MAX];
+	const struct inotify_event *ev;
+	struct oracle_set *set, *old;
+	ssize_t len;
+	size_t i;
+	char *p;
+	int ret;
+
+	pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+
+	for (;;) {
+		/* Only allow to be stopped while waiting for events */
+		pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+		len = read(watch_fd, buf, sizeof(buf));
+		pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+
+		if (len <= 0) {
+			if (len == -1 && errno == EINTR)
+				continue;
+			break;
 		}
 
-		if (what != focus)
-			continue;
+		for (p = buf; p < buf + len; p += sizeof(*ev) + ev->len) {
+			ev = (const struct inotify_event *)p;
+			if (ev->len == 0)
+				continue;
+
+			for (i = 0; i < nitems(watch_dirs); i++) {
+				if (watch_dirs[i].wd == ev->wd)
+					break;
+			}
+			if (i == nitems(watch_dirs))
+				continue;
+
+			ret = snprintf(path, sizeof(path), "%s/%s",
+			    watch_dirs[i].dir, ev->name);
+			if (ret < 0 || (size_t)ret >= sizeof(path))
+				continue;
 
-		id_temp = 0;
-		n_entries = json_object_array_length(table);
-		for (j = 0; j < n_entries; j++) {
-			temp = json_object_array_get_idx(table, j);
-			json_object_object_get_ex(temp, "Description", &desc);
-			json_object_object_get_ex(temp, "Chance", &chance);
-			id = json_object_get_int(chance);
-			log_debug("%s %d <%ld>\n", json_object_get_string(desc), id, die);
-
-			/* Save the current string for later use, since some oracle tables don't
-			 * have a value for every key (die roll from 1 to 100.  In case there is a
-			 * gap, use the save value */
-			snprintf(temp_name, sizeof(temp_name), "%s", json_object_get_string(desc));
-
-			/* Die roll matches exactly the oracle key */
-			if (id == die) {
-				/* User called 'generatenpc' so avoid newlines */
-				if (generate) {
-					convert_to_lowercase(temp_name);
-					printf("%s", temp_name);
-				} else
-					printf("%s <%ld>\n", temp_name, die);
-				goto out;
-			/* We have a gap */
-			} else if (id > die) {
-				log_debug("ID %d larger than the last one %d, we have a gap (die %ld)\n",
-					id, id_temp, die);
-				/* User called 'generatenpc' so avoid newlines */
-				if (generate) {
-					convert_to_lowercase(temp_name);
-					printf("%s", temp_name);
-				} else
-					printf("%s <%ld>\n", temp_name, die);
-				goto out;
+			if (!oracle_file_is_resident(path))
+				continue;
+
+			/* A broken file leaves the tables we have alone */
+			if ((set = compile_oracle_set(path)) == NULL) {
+				log_debug("Cannot reload %s, keep the old tables\n",
+				    path);
+				continue;
 			}
-			id_temp = id;
+
+			pthread_mutex_lock(&oracle_lock);
+			for (i = 0; i < n_oracle_files; i++) {
+				if (strcmp(oracle_files[i].path, path) == 0)
+					break;
+			}
+			if (i == n_oracle_files) {
+				pthread_mutex_unlock(&oracle_lock);
+				free_oracle_set(set);
+				continue;
+			}
+			set_oracle_file(set, oracle_files[i].file);
+			old = __atomic_exchange_n(&oracle_files[i].set, set,
+			    __ATOMIC_ACQ_REL);
+			old->next = retired_sets;
+			retired_sets = old;
+			__atomic_add_fetch(&oracle_generation, 1, __ATOMIC_RELEASE);
+			pthread_mutex_unlock(&oracle_lock);
+
+			log_debug("Reloaded %s\n", path);
 		}
 	}
 
-out:
-	/* Decrement the reference count of json_object and free if it reaches zero. */
-	json_object_put(root);
+	return NULL;
+}
+
+static int
+oracle_file_is_resident(const char *path)
+{
+	size_t i;
+	int found = 0;
+
+	pthread_mutex_lock(&oracle_lock);
+	for (i = 0; i < n_oracle_files && !found; i++)
+		found = strcmp(oracle_files[i].path, path) == 0;
+	pthread_mutex_unlock(&oracle_lock);
+
+	return found;
+}
+
+void
+start_oracle_watch(void)
+{
+	size_t i;
+	int ret;
+
+	if ((watch_fd = inotify_init1(IN_CLOEXEC)) == -1) {
+		log_debug("inotify_init1 failed.  No live reload of oracles\n");
+		return;
+	}
+
+	snprintf(watch_dirs[0].dir, sizeof(watch_dirs[0].dir), "%s", PATH_SHARE_DIR);
+	ret = snprintf(watch_dirs[1].dir, sizeof(watch_dirs[1].dir), "%s/oracles",
+	    get_isscrolls_dir());
+	if (ret < 0 || (size_t)ret >= sizeof(watch_dirs[1].dir))
+		watch_dirs[1].dir[0] = '\0';
+
+	for (i = 0; i < nitems(watch_dirs); i++) {
+		watch_dirs[i].wd = -1;
+		if (watch_dirs[i].dir[0] == '\0')
+			continue;
+		watch_dirs[i].wd = inotify_add_watch(watch_fd, watch_dirs[i].dir,
+		    IN_CLOSE_WRITE | IN_MOVED_TO);
+		if (watch_dirs[i].wd == -1)
+			log_debug("Cannot watch %s\n", watch_dirs[i].dir);
+	}
+
+	if (pthread_create(&watch_thread, NULL, oracle_watch_loop, NULL) != 0) {
+		log_debug("Cannot start the oracle watcher\n");
+		close(watch_fd);
+		watch_fd = -1;
+	}
+}
+
+static void
+stop_oracle_watch(void)
+{
+	/* The watcher cannot wait for itself to finish */
+	if (watch_fd == -1 || pthread_equal(pthread_self(), watch_thread))
+		return;
+
+	pthread_cancel(watch_thread);
+	pthread_join(watch_thread, NULL);
+	close(watch_fd);
+	watch_fd = -1;
+}
+#else
+void
+start_oracle_watch(void)
+{
+	log_debug("Live reload of oracles is only supported on Linux\n");
+}
+
+static void
+stop_oracle_watch(void)
+{
+}
+#endif /* __linux__ */
+
+/*
+ * Compile all JSON files in the oracles directory inside the isscrolls
+ * directory once per session.  Their tables are used like the shared ones.
+ */
+static void
+load_user_oracles(void)
+{
+	static int loaded = 0;
+	char dir[_POSIX_PATH_MAX], path[_POSIX_PATH_MAX], file[_POSIX_PATH_MAX];
+	struct dirent *dp;
+	DIR *dirp;
+	size_t len;
+	int ret;
+
+	if (loaded)
+		return;
+	loaded = 1;
+
+	ret = snprintf(dir, sizeof(dir), "%s/oracles", get_isscrolls_dir());
+	if (ret < 0 || (size_t)ret >= sizeof(dir)) {
+		log_errx(1, "Path truncation happened.  Buffer too short to fit %s\n", dir);
+	}
+
+	if ((dirp = opendir(dir)) == NULL) {
+		log_debug("No user oracles in %s\n", dir);
+		return;
+	}
+
+	while ((dp = readdir(dirp)) != NULL) {
+		len = strlen(dp->d_name);
+		if (len < 6 || strcmp(dp->d_name + len - 5, ".json") != 0)
+			continue;
+
+		ret = snprintf(path, sizeof(path), "%s/%s", dir, dp->d_name);
+		if (ret < 0 || (size_t)ret >= sizeof(path)) {
+			log_debug("Path truncation happened.  Skip %s\n", dp->d_name);
+			continue;
+		}
+		snprintf(file, sizeof(file), "oracles/%s", dp->d_name);
+
+		parse_oracle_file(file, path, 0);
+	}
+
+	closedir(dirp);
+}
+
+/*
+ * Compile one table of an oracle file into t.  Returns -1 for a table that is
+ * to be skipped and -2 if we run out of memory.
+ */
+static int
+compile_oracle_table(struct oracle_table *t, json_object *oracle)
+{
+	json_object *name, *d, *entries, *temp, *desc, *chance;
+	size_t n_entries, i, j;
+
+	if (!json_object_object_get_ex(oracle, "Name", &name) ||
+	    !json_object_object_get_ex(oracle, "Oracle Table", &entries))
+		return -1;
+
+	if ((n_entries = json_object_array_length(entries)) == 0)
+		return -1;
+
+	/* Tables without a die size use a d100 */
+	t->max = 100;
+	if (json_object_object_get_ex(oracle, "d", &d) && json_object_get_int(d) > 0)
+		t->max = json_object_get_int(d);
+
+	if ((t->name = strdup(json_object_get_string(name))) == NULL ||
+	    (t->entries = calloc(n_entries, sizeof(struct oracle_entry))) == NULL ||
+	    (t->slot = calloc(t->max, sizeof(unsigned short))) == NULL)
+		goto fail;
+	t->n_entries = n_entries;
+
+	for (i = 0; i < n_entries; i++) {
+		temp = json_object_array_get_idx(entries, i);
+		json_object_object_get_ex(temp, "Description", &desc);
+		json_object_object_get_ex(temp, "Chance", &chance);
+		if ((t->entries[i].desc = strdup(json_object_get_string(desc))) == NULL)
+			goto fail;
+		t->entries[i].chance = json_object_get_int(chance);
+	}
+
+	/*
+	 * Chance is the upper bound of the range an entry covers.  Die results
+	 * above the last bound fall onto the last entry.
+	 */
+	for (i = 0, j = 0; i < (size_t)t->max; i++) {
+		while (j < n_entries - 1 && t->entries[j].chance < (int)i + 1)
+			j++;
+		t->slot[i] = j;
+	}
+
+	return 0;
+fail:
+	log_debug("Out of memory compiling oracle table %s\n",
+	    t->name != NULL ? t->name : "");
+	free_oracle_table(t);
+
+	return -2;
 }
 
 void
@@ -390,14 +934,780 @@ cmd_show_settlement_trouble(__attribute__((unused))char *unused)
 void
 cmd_generate_npc(__attribute__((unused))char *unused)
 {
-	read_oracle_from_json(ORACLE_IS_NAMES, 1);
-	printf(" the ");
-	read_oracle_from_json(ORACLE_CHAR_ROLE, 1);
-	printf(" is a ");
-	read_oracle_from_json(ORACLE_CHAR_DESC, 1);
-	printf(" person whose goal is to ");
-	read_oracle_from_json(ORACLE_CHAR_GOAL, 1);
-	printf(".\n");
+	generate_from_template("npc", 1);
+}
+
+void
+cmd_generate(char *cmd)
+{
+	char *name, *count, *last, *ep;
+	long lval = 1;
+	size_t i;
+
+	load_generators();
+
+	if ((name = strtok_r(cmd, " ", &last)) == NULL) {
+		printf("Please provide the name of a generator\n\n");
+		printf("Available generators:\n");
+		for (i = 0; i < n_generators; i++)
+			printf("  %s\n", generators[i].name);
+		return;
+	}
+
+	if ((count = strtok_r(NULL, " ", &last)) != NULL) {
+		errno = 0;
+		lval = strtol(count, &ep, 10);
+		if (*ep != '\0' || errno == ERANGE || lval <= 0 ||
+		    lval > MAX_GENERATE_COUNT) {
+			printf("Please provide a number between 1 and %d\n",
+			    MAX_GENERATE_COUNT);
+			return;
+		}
+	}
+
+	generate_from_template(name, lval);
+}
+
+/*
+ * Render the generator called name count times.  Every result is rendered
+ * into one buffer which is written in one go.
+ */
+static void
+generate_from_template(const char *name, long count)
+{
+	const struct generator *g = NULL;
+	char buf[MAX_TEMPLATE_OUTPUT];
+	size_t i;
+	long n;
+
+	load_generators();
+
+	for (i = 0; i < n_generators; i++) {
+		if (strcasecmp(generators[i].name, name) == 0) {
+			g = &generators[i];
+			break;
+		}
+	}
+
+	if (g == NULL) {
+		printf("Unknown generator %s\n", name);
+		return;
+	}
+
+	for (n = 0; n < count; n++) {
+		render_generator(g, buf, sizeof(buf));
+		printf("%s\n", buf);
+	}
+}
+
+static void
+render_generator(const struct generator *g, char *buf, size_t len)
+{
+	const struct template_part *tp;
+	const char *desc;
+	char *start;
+	size_t i, pos = 0;
+	long die;
+	int n;
+
+	buf[0] = '\0';
+
+	for (i = 0; i < g->n_parts && pos < len - 1; i++) {
+		tp = &g->parts[i];
+		if (tp->table == NULL) {
+			desc = tp->text;
+		} else {
+			/* There is no second slot in a sentence, roll again */
+			do {
+				desc = roll_on_table(tp->table, &die);
+			} while (strstr(desc, "[Roll twice]") != NULL);
+		}
+
+		start = buf + pos;
+		n = snprintf(start, len - pos, "%s", desc);
+		if (n < 0 || (size_t)n >= len - pos)
+			pos = len - 1;
+		else
+			pos += n;
+
+		if (tp->lower)
+			convert_to_lowercase(start);
+	}
+}
+
+/*
+ * Compile the built-in generators and the ones from generators.json in the
+ * isscrolls directory.  This happens once per session.
+ */
+static void
+load_generators(void)
+{
+	char path[_POSIX_PATH_MAX];
+	json_object *root, *items, *temp, *name, *tmpl;
+	size_t n_items = 0, i;
+	int ret;
+
+	/* Recompile if the watcher replaced tables the generators point to */
+	if (generators != NULL) {
+		if (generators_generation ==
+		    __atomic_load_n(&oracle_generation, __ATOMIC_ACQUIRE))
+			return;
+		free_generators();
+	}
+	generators_generation = __atomic_load_n(&oracle_generation, __ATOMIC_ACQUIRE);
+
+	ret = snprintf(path, sizeof(path), "%s/generators.json", get_isscrolls_dir());
+	if (ret < 0 || (size_t)ret >= sizeof(path)) {
+		log_errx(1, "Path truncation happened.  Buffer too short to fit %s\n", path);
+	}
+
+	if ((root = read_json_file(path)) == NULL)
+		log_debug("No generator JSON file found\n");
+	else if (!json_object_object_get_ex(root, "Generators", &items))
+		log_debug("Cannot find a [Generators] array in %s\n", path);
+	else
+		n_items = json_object_array_length(items);
+
+	for (i = 0; builtin_generators[i].name != NULL; i++)
+		;
+
+	generators = calloc(i + n_items, sizeof(struct generator));
+	if (generators == NULL)
+		log_errx(1, "calloc generators\n");
+
+	for (i = 0; builtin_generators[i].name != NULL; i++) {
+		if (compile_template(&generators[n_generators],
+		    builtin_generators[i].name, builtin_generators[i].template) == 0)
+			n_generators++;
+	}
+
+	for (i = 0; i < n_items; i++) {
+		temp = json_object_array_get_idx(items, i);
+		if (!json_object_object_get_ex(temp, "Name", &name) ||
+		    !json_object_object_get_ex(temp, "Template", &tmpl))
+			continue;
+		if (compile_template(&generators[n_generators],
+		    json_object_get_string(name), json_object_get_string(tmpl)) == 0)
+			n_generators++;
+	}
+
+	if (root != NULL)
+		json_object_put(root);
+}
+
+/*
+ * Split a template into literal text and {table} references.  Every table
+ * is looked up once here, rendering only rolls on the referenced tables.
+ * A reference ending in '|lower' is converted to lowercase.
+ */
+static int
+compile_template(struct generator *g, const char *name, const char *tmpl)
+{
+	struct template_part *tp;
+	const char *p, *end;
+	char ref[MAX_TEMPLATE_REF];
+	size_t n, i;
+
+	if (name == NULL || tmpl == NULL)
+		return -1;
+
+	/* Every reference can split a literal, so this is an upper bound */
+	for (n = 1, p = tmpl; *p != '\0'; p++) {
+		if (*p == '{')
+			n += 2;
+	}
+
+	memset(g, 0, sizeof(struct generator));
+	if ((g->parts = calloc(n, sizeof(struct template_part))) == NULL)
+		log_errx(1, "calloc template parts\n");
+	if ((g->name = strdup(name)) == NULL)
+		log_errx(1, "strdup\n");
+
+	for (p = tmpl; *p != '\0'; p = end) {
+		tp = &g->parts[g->n_parts];
+
+		if (*p != '{') {
+			if ((end = strchr(p, '{')) == NULL)
+				end = p + strlen(p);
+			if ((tp->text = strndup(p, end - p)) == NULL)
+				log_errx(1, "strndup\n");
+			g->n_parts++;
+			continue;
+		}
+
+		if ((end = strchr(p, '}')) == NULL || (size_t)(end - p) > sizeof(ref)) {
+			printf("Generator %s: unterminated or too long reference\n", name);
+			goto fail;
+		}
+		snprintf(ref, sizeof(ref), "%.*s", (int)(end - p - 1), p + 1);
+		end++;
+
+		n = strlen(ref);
+		if (n > 6 && strcmp(ref + n - 6, "|lower") == 0) {
+			ref[n - 6] = '\0';
+			tp->lower = 1;
+		}
+
+		if ((tp->table = lookup_oracle_table(ref)) == NULL) {
+			printf("Generator %s: unknown oracle table %s\n", name, ref);
+			goto fail;
+		}
+		g->n_parts++;
+	}
+
+	return 0;
+
+fail:
+	for (i = 0; i < g->n_parts; i++)
+		free(g->parts[i].text);
+	free(g->parts);
+	free(g->name);
+	memset(g, 0, sizeof(struct generator));
+
+	return -1;
+}
+
+static void
+free_generators(void)
+{
+	size_t i, j;
+
+	for (i = 0; i < n_generators; i++) {
+		for (j = 0; j < generators[i].n_parts; j++)
+			free(generators[i].parts[j].text);
+		free(generators[i].parts);
+		free(generators[i].name);
+	}
+
+	free(generators);
+	generators = NULL;
+	n_generators = 0;
+}
+
+/*
+ * Find a table by its name in the user oracle files, by a short alias such as
+ * 'ironlandername' or by its name in any of the shared oracle files.  Case,
+ * spaces and punctuation are ignored, so 'settlementtrouble' finds the
+ * 'Settlement Trouble' table.
+ */
+static const struct oracle_table *
+lookup_oracle_table(const char *name)
+{
+	const struct oracle_set *set;
+	size_t i, j;
+
+	/* Homebrew tables take precedence over the shared ones */
+	load_user_oracles();
+	for (i = 0; i < n_oracle_files; i++) {
+		if (strncmp(oracle_files[i].file, "oracles/", 8) != 0)
+			continue;
+		set = oracle_file_set(&oracle_files[i]);
+		for (j = 0; j < set->n_tables; j++) {
+			if (oracle_name_matches(set->tables[j].name, name))
+				return &set->tables[j];
+		}
+	}
+
+	for (i = 0; oracle_aliases[i].alias != NULL; i++) {
+		if (oracle_name_matches(oracle_aliases[i].alias, name))
+			return find_oracle_table(oracle_aliases[i].file,
+			    oracle_aliases[i].table);
+	}
+
+	for (i = 0; oracle_share_files[i] != NULL; i++) {
+		if ((set = load_oracle_file(oracle_share_files[i])) == NULL)
+			continue;
+		for (j = 0; j < set->n_tables; j++) {
+			if (oracle_name_matches(set->tables[j].name, name))
+				return &set->tables[j];
+		}
+	}
+
+	return NULL;
+}
+
+static int
+oracle_name_matches(const char *a, const char *b)
+{
+	for (;;) {
+		while (*a != '\0' && !isalnum((unsigned char)*a))
+			a++;
+		while (*b != '\0' && !isalnum((unsigned char)*b))
+			b++;
+		if (*a == '\0' || *b == '\0')
+			return *a == *b;
+		if (tolower((unsigned char)*a++) != tolower((unsigned char)*b++))
+			return 0;
+	}
+}
+
+void
+cmd_oracle(char *cmd)
+{
+	const struct oracle_table *t;
+	const struct oracle_set *set;
+	size_t i, j;
+
+	if (cmd == NULL || strlen(cmd) == 0) {
+		cmd_roll_oracle_die(NULL);
+		return;
+	}
+
+	if ((t = lookup_oracle_table(cmd)) != NULL) {
+		print_table_roll(NULL, t);
+		return;
+	}
+
+	printf("Cannot find the oracle table %s\n", cmd);
+	for (i = 0; i < n_oracle_files; i++) {
+		if (strncmp(oracle_files[i].file, "oracles/", 8) != 0)
+			continue;
+		set = oracle_file_set(&oracle_files[i]);
+		printf("\nTables in %s:\n", oracle_files[i].file);
+		for (j = 0; j < set->n_tables; j++)
+			printf("  %s\n", set->tables[j].name);
+	}
+}
+
+void
+cmd_no_repeat(char *cmd)
+{
+	struct character *curchar = get_current_character();
+	size_t i;
+
+	CURCHAR_CHECK();
+
+	if (cmd == NULL || strlen(cmd) == 0) {
+		printf("No-repeat oracle draws are %s\n", norepeat ? "on" : "off");
+		return;
+	}
+
+	if (strcmp(cmd, "on") == 0) {
+		norepeat = 1;
+		printf("Oracle results are not repeated until a table is exhausted\n");
+	} else if (strcmp(cmd, "off") == 0) {
+		norepeat = 0;
+		printf("Oracle results can repeat\n");
+	} else if (strcmp(cmd, "reset") == 0) {
+		for (i = 0; i < n_draws; i++) {
+			memset(draws[i].used, 0, (draws[i].n_entries + 7) / 8);
+			draws[i].set_id = 0;
+		}
+		printf("All oracle results are available again\n");
+	} else {
+		printf("Please provide on, off or reset as argument\n");
+		return;
+	}
+
+	draws_dirty = 1;
+	mark_dirty();
+}
+
+/*
+ * Draw a result from t that was not drawn before in this campaign.  The die
+ * faces of all unused entries are kept in an array, a draw picks a random
+ * element and removes the faces of the drawn entry by swapping them with the
+ * last elements.  A draw costs time in the number of faces of the drawn
+ * entry, no matter how many entries are left.
+ */
+static const char *
+draw_without_repeat(const struct oracle_table *t, long *die)
+{
+	struct oracle_draws *d;
+	size_t e, lo, hi, f;
+	int face;
+
+	d = get_draws(t);
+
+	if (d->remaining == 0) {
+		pm(YELLOW, "All results of %s were drawn.  Starting over\n", t->name);
+		memset(d->used, 0, (d->n_entries + 7) / 8);
+		rebuild_draws(d, t);
+	}
+
+	stats_rng_draw();
+	face = d->faces[random() % d->remaining];
+	e = t->slot[face];
+
+	/* An entry covers a contiguous range of faces */
+	for (lo = face; lo > 0 && t->slot[lo - 1] == e; lo--)
+		;
+	for (hi = face; hi + 1 < (size_t)t->max && t->slot[hi + 1] == e; hi++)
+		;
+	for (f = lo; f <= hi; f++)
+		remove_face(d, f);
+
+	d->used[e / 8] |= 1 << (e % 8);
+	draws_dirty = 1;
+	mark_dirty();
+
+	*die = face + 1;
+
+	return t->entries[e].desc;
+}
+
+static void
+remove_face(struct oracle_draws *d, size_t f)
+{
+	unsigned short last;
+	size_t p;
+
+	p = d->pos[f];
+	if (p >= (size_t)d->remaining || d->faces[p] != f)
+		return;
+
+	last = d->faces[--d->remaining];
+	d->faces[p] = last;
+	d->pos[last] = p;
+}
+
+/*
+ * Return the draw state for t.  States are kept per table name and oracle
+ * file, so they survive a reload of the table.  The faces are collected again whenever the
+ * table comes from another set than they were built for, a reloaded table
+ * might even live at the address of the old one.  If the table changed its
+ * size, the state starts over.
+ */
+static struct oracle_draws *
+get_draws(const struct oracle_table *t)
+{
+	struct oracle_draws *d;
+	size_t i;
+
+	for (i = 0; i < n_draws; i++) {
+		if (strcmp(draws[i].name, t->name) != 0 ||
+		    (draws[i].file != NULL && strcmp(draws[i].file, t->file) != 0))
+			continue;
+		d = &draws[i];
+		if (d->file == NULL && (d->file = strdup(t->file)) == NULL)
+			log_errx(1, "strdup\n");
+		if (d->set_id == t->set_id && d->faces != NULL &&
+		    d->max == t->max && d->n_entries == t->n_entries)
+			return d;
+		break;
+	}
+
+	if (i == n_draws) {
+		if ((d = reallocarray(draws, n_draws + 1, sizeof(*d))) == NULL)
+			log_errx(1, "reallocarray draws\n");
+		draws = d;
+		d = &draws[n_draws++];
+		memset(d, 0, sizeof(*d));
+		if ((d->name = strdup(t->name)) == NULL ||
+		    (d->file = strdup(t->file)) == NULL)
+			log_errx(1, "strdup\n");
+	} else
+		d = &draws[i];
+
+	if (d->used == NULL || d->n_entries != t->n_entries) {
+		free(d->used);
+		d->n_entries = t->n_entries;
+		if ((d->used = calloc((d->n_entries + 7) / 8, 1)) == NULL)
+			log_errx(1, "calloc draws\n");
+	}
+
+	rebuild_draws(d, t);
+	d->set_id = t->set_id;
+	d->max = t->max;
+
+	return d;
+}
+
+/*
+ * Collect the die faces of all entries of t that are not used yet.
+ */
+static void
+rebuild_draws(struct oracle_draws *d, const struct oracle_table *t)
+{
+	size_t f, e;
+
+	free(d->faces);
+	free(d->pos);
+	if ((d->faces = calloc(t->max, sizeof(unsigned short))) == NULL)
+		log_errx(1, "calloc draws\n");
+	if ((d->pos = calloc(t->max, sizeof(unsigned short))) == NULL)
+		log_errx(1, "calloc draws\n");
+
+	d->remaining = 0;
+	for (f = 0; f < (size_t)t->max; f++) {
+		e = t->slot[f];
+		if (d->used[e / 8] & (1 << (e % 8)))
+			continue;
+		d->pos[f] = d->remaining;
+		d->faces[d->remaining++] = f;
+	}
+
+	/* Every entry is used, start over */
+	if (d->remaining == 0 && t->max > 0) {
+		memset(d->used, 0, (d->n_entries + 7) / 8);
+		rebuild_draws(d, t);
+	}
+}
+
+void
+save_draws(void)
+{
+	struct character *curchar = get_current_character();
+	char path[_POSIX_PATH_MAX], *hex;
+	json_object *root, *items, *keep, *id, *tables;
+	size_t temp_n, i, j, n;
+	int ret;
+	TRACE_FUNC("save");
+	CAMPAIGN_LOCK();
+
+	if (curchar == NULL) {
+		log_debug("No character loaded.  No oracle draws to save.\n");
+		return;
+	}
+
+	if (draws_dirty == 0) {
+		log_debug("Oracle draws unchanged.  Nothing to save.\n");
+		return;
+	}
+
+	ret = snprintf(path, sizeof(path), "%s/draws.json", get_isscrolls_dir());
+	if (ret < 0 || (size_t)ret >= sizeof(path)) {
+		log_errx(1, "Path truncation happened.  Buffer too short to fit %s\n", path);
+	}
+
+	if ((root = read_json_file(path)) == NULL) {
+		log_debug("No draws JSON file found\n");
+		if ((root = json_object_new_object()) == NULL)
+			log_errx(1, "Cannot create draws JSON object\n");
+	}
+
+	/* Carry over the draws of all other characters ... */
+	keep = json_object_new_array();
+	if (json_object_object_get_ex(root, "draws", &items)) {
+		temp_n = json_object_array_length(items);
+		for (i = 0; i < temp_n; i++) {
+			json_object *temp = json_object_array_get_idx(items, i);
+			json_object_object_get_ex(temp, "id", &id);
+			if (curchar->id == json_object_get_int(id))
+				continue;
+			json_object_array_add(keep, json_object_get(temp));
+		}
+	}
+
+	/* ... and add one record with the used entries of every table as bitset */
+	json_object *cobj = json_object_new_object();
+	json_object_object_add(cobj, "id", json_object_new_int(curchar->id));
+	json_object_object_add(cobj, "norepeat", json_object_new_int(norepeat));
+	tables = json_object_new_array();
+	for (i = 0; i < n_draws; i++) {
+		n = (draws[i].n_entries + 7) / 8;
+		if ((hex = calloc(n * 2 + 1, 1)) == NULL)
+			log_errx(1, "calloc\n");
+		for (j = 0; j < n; j++)
+			snprintf(hex + j * 2, 3, "%02x", draws[i].used[j]);
+
+		json_object *tobj = json_object_new_object();
+		json_object_object_add(tobj, "table", json_object_new_string(draws[i].name));
+		if (draws[i].file != NULL)
+			json_object_object_add(tobj, "file",
+				json_object_new_string(draws[i].file));
+		json_object_object_add(tobj, "entries",
+			json_object_new_int(draws[i].n_entries));
+		json_object_object_add(tobj, "used", json_object_new_string(hex));
+		json_object_array_add(tables, tobj);
+		free(hex);
+	}
+	json_object_object_add(cobj, "tables", tables);
+	json_object_array_add(keep, cobj);
+
+	json_object_object_add(root, "draws", keep);
+
+	if (write_json_file(path, root))
+		printf("Error saving %s\n", path);
+	else {
+		log_debug("Successfully saved %s\n", path);
+		draws_dirty = 0;
+	}
+
+	json_object_put(root);
+}
+
+void
+load_draws(int id)
+{
+	char path[_POSIX_PATH_MAX], byte[3];
+	struct oracle_draws *d;
+	json_object *root, *items, *lid, *tables, *val;
+	const char *hex;
+	size_t temp_n, i, j, k, n;
+	int ret;
+	TRACE_FUNC("load");
+	CAMPAIGN_LOCK();
+
+	free_draws();
+
+	ret = snprintf(path, sizeof(path), "%s/draws.json", get_isscrolls_dir());
+	if (ret < 0 || (size_t)ret >= sizeof(path)) {
+		log_errx(1, "Path truncation happened.  Buffer too short to fit %s\n", path);
+	}
+
+	if ((root = read_json_file(path)) == NULL) {
+		log_debug("No draws JSON file found\n");
+		return;
+	}
+
+	if (!json_object_object_get_ex(root, "draws", &items)) {
+		log_debug("Cannot find a [draws] array in %s\n", path);
+		json_object_put(root);
+		return;
+	}
+
+	temp_n = json_object_array_length(items);
+	for (i = 0; i < temp_n; i++) {
+		json_object *temp = json_object_array_get_idx(items, i);
+		json_object_object_get_ex(temp, "id", &lid);
+		if (id != json_object_get_int(lid))
+			continue;
+
+		norepeat = validate_int(temp, "norepeat", 0, 1, 0);
+		if (!json_object_object_get_ex(temp, "tables", &tables))
+			break;
+
+		n = json_object_array_length(tables);
+		if ((draws = calloc(n, sizeof(struct oracle_draws))) == NULL)
+			log_errx(1, "calloc draws\n");
+
+		for (j = 0; j < n; j++) {
+			json_object *tobj = json_object_array_get_idx(tables, j);
+			if (!json_object_object_get_ex(tobj, "table", &val))
+				continue;
+
+			d = &draws[n_draws];
+			if ((d->name = strdup(json_object_get_string(val))) == NULL)
+				log_errx(1, "strdup\n");
+			if (json_object_object_get_ex(tobj, "file", &val) &&
+			    (d->file = strdup(json_object_get_string(val))) == NULL)
+				log_errx(1, "strdup\n");
+			d->n_entries = validate_int(tobj, "entries", 0, USHRT_MAX, 0);
+			if ((d->used = calloc((d->n_entries + 7) / 8, 1)) == NULL)
+				log_errx(1, "calloc draws\n");
+
+			json_object_object_get_ex(tobj, "used", &val);
+			hex = json_object_get_string(val);
+			for (k = 0; hex != NULL && k < (d->n_entries + 7) / 8 &&
+			    hex[k * 2] != '\0' && hex[k * 2 + 1] != '\0'; k++) {
+				snprintf(byte, sizeof(byte), "%.2s", hex + k * 2);
+				d->used[k] = strtol(byte, NULL, 16);
+			}
+			n_draws++;
+		}
+		break;
+	}
+
+	json_object_put(root);
+}
+
+void
+free_draws(void)
+{
+	size_t i;
+
+	for (i = 0; i < n_draws; i++) {
+		free(draws[i].name);
+		free(draws[i].file);
+		free(draws[i].used);
+		free(draws[i].faces);
+		free(draws[i].pos);
+	}
+
+	free(draws);
+	draws = NULL;
+	n_draws = 0;
+	draws_dirty = 0;
+	norepeat = 0;
+}
+
+void *
+detach_draws(void)
+{
+	struct draws_state *ds;
+
+	if ((ds = malloc(sizeof(*ds))) == NULL)
+		log_errx(1, "cannot allocate memory\n");
+
+	ds->draws = draws;
+	ds->n_draws = n_draws;
+	ds->dirty = draws_dirty;
+	ds->norepeat = norepeat;
+
+	draws = NULL;
+	n_draws = 0;
+	draws_dirty = 0;
+	norepeat = 0;
+
+	return ds;
+}
+
+void
+attach_draws(void *state)
+{
+	struct draws_state *ds = state;
+
+	free_draws();
+	if (ds == NULL)
+		return;
+
+	draws = ds->draws;
+	n_draws = ds->n_draws;
+	draws_dirty = ds->dirty;
+	norepeat = ds->norepeat;
+	free(ds);
+}
+
+void
+cmd_generate_monstrosity(__attribute__((unused))char *unused)
+{
+	print_oracle_roll("Size", MONSTROSITY_JSON, "Size");
+	print_oracle_roll("Primary form", MONSTROSITY_JSON, "Primary Form");
+	print_oracle_roll("Characteristic", MONSTROSITY_JSON, "Characteristics");
+	print_oracle_roll("Ability", MONSTROSITY_JSON, "Abilities");
+}
+
+/*
+ * Roll on a resident table and print the result.  A '[Roll twice]' result
+ * is replaced by two more rolls on the same table.
+ */
+static void
+print_oracle_roll(const char *label, const char *file, const char *table)
+{
+	const struct oracle_table *t;
+
+	if ((t = find_oracle_table(file, table)) == NULL) {
+		printf("Cannot roll on the %s oracle\n", table);
+		return;
+	}
+
+	print_table_roll(label, t);
+}
+
+static void
+print_table_roll(const char *label, const struct oracle_table *t)
+{
+	const char *desc, *p;
+	long die;
+	int i;
+
+	if (label != NULL)
+		printf("%s: ", label);
+
+	desc = roll_on_table(t, &die);
+	if ((p = strstr(desc, "[Roll twice]")) == NULL) {
+		printf("%s <%ld>\n", desc, die);
+		return;
+	}
+
+	printf("%.*s<%ld>\n", (int)(p - desc), desc, die);
+	for (i = 0; i < 2; i++) {
+		do {
+			desc = roll_on_table(t, &die);
+		} while (strstr(desc, "[Roll twice]") != NULL);
+		printf("  %s <%ld>\n", desc, die);
+	}
 }
 
 void
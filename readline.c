@@ -25,11 +25,14 @@
 static struct command commands[] = {
 	{ "cd", cmd_cd, "Switch to or from a character", 0, 0, 1},
 	{ "cds", cmd_cds, "Switch to a character and show all vows", 0, 0, 1},
+	{ "events", cmd_events, "Show or toggle where rolls and changes are sent to", 0, 0, 0},
 	{ "help", cmd_usage, "Show help", 0, 0, 0},
 	{ "ls", cmd_ls, "List all characters", 0, 0, 0},
 	{ "quit", cmd_quit, "Quit the program", 0, 0, 0},
 	{ "q", cmd_quit, "Quit the program", 1, 0, 0},
 	{ "save", cmd_save, "Save the current character", 0, 0, 0},
+	{ "snapshot", cmd_snapshot, "Show, import or export the binary character snapshot", 0, 0, 0},
+	{ "stats", cmd_show_stats, "Show performance counters", 0, 0, 0},
 	{ "startautojournal", cmd_startautojournal, "Start saving commands automatically to the journal", 0, 0, 0},
 	{ "stopautojournal", cmd_stopautojournal, "Stop saving commands automatically to the journal", 0, 0, 0},
 	{ "journal", cmd_journal, "Write text to the journal", 0, 0, 0},
@@ -39,7 +42,7 @@ static struct command commands[] = {
 	{ "actionoracle", cmd_show_action, "Show a random action oracle", 0, 0, 1},
 	{ "burnmomentum", cmd_burn_momentum, "Burn your character's momentum", 0, 0, 1},
 	{ "challenge", cmd_roll_challenge_die, "Roll a challenge die", 0, 0, 1},
-	{ "oracle", cmd_roll_oracle_die, "Roll two challenge dice as oracle", 0, 0, 1},
+	{ "oracle", cmd_oracle, "Roll two challenge dice as oracle or roll on a table", 0, 0, 1},
 	{ "yesorno", cmd_yes_or_no, "Roll oracle to answer a yes/no question", 0, 0, 1},
 	{ "--- CHARACTER COMMANDS ---", NULL, "", 0, 0, 1},
 	{ "create", cmd_create_character, "Create a new character", 0, 0, 1},
@@ -65,6 +68,9 @@ static struct command commands[] = {
 	{ "facedanger", cmd_face_danger, "Roll a 'face danger' move", 0, 0, 1},
 	{ "facedesolation", cmd_face_desolation, "Roll a 'face desolation' move", 0, 0, 1},
 	{ "facedeath", cmd_face_death, "Roll a 'face death' move", 0, 0, 1},
+	{ "fightsim", cmd_fight_sim, "Simulate the odds of the current fight", 0, 0, 1},
+	{ "foe", cmd_select_foe, "Select the foe to make fight moves against", 0, 0, 1},
+	{ "forecast", cmd_forecast, "Forecast the rest of a journey or an expedition", 0, 0, 1},
 	{ "forgeabond", cmd_forge_a_bond, "Roll a 'forge a bond' move", 0, 0, 1},
 	{ "gatherinformation", cmd_gather_information, "Roll a 'gather information' move", 0, 0, 1},
 	{ "heal", cmd_heal, "Roll a 'heal' move", 0, 0, 1},
@@ -100,6 +106,12 @@ static struct command commands[] = {
 	{ "noteedit", cmd_edit_note, "Edit a note", 0, 0, 1},
 	{ "noteshow", cmd_show_all_notes, "Show all notes of the current character", 0, 0, 1},
 	{ "notedelete", cmd_delete_note, "Irrecoverably delete a note", 0, 0, 1},
+	{ "--- WORK WITH THREATS ---", NULL, "", 0, 0, 0},
+	{ "threatnew", cmd_create_threat, "Create a new threat", 0, 0, 1},
+	{ "threatadvance", cmd_advance_threat, "Advance a threat and mark menace", 0, 0, 1},
+	{ "threatlink", cmd_link_threat, "Link a threat to the active vow", 0, 0, 1},
+	{ "threatshow", cmd_show_threats, "Show all threats of the current character", 0, 0, 1},
+	{ "threatdelete", cmd_delete_threat, "Irrecoverably delete a threat", 0, 0, 1},
 	{ "--- STARFORGED MOVES ---", NULL, "", 0, 1, 0},
 	{ "undertakeanexpedition", cmd_undertake_an_expedition, "Roll a 'undertake an expedition ' move", 0, 1, 1},
 	{ "finishanexpedition", cmd_finish_an_expedition, "Roll a 'finish an expedition ' move", 0, 1, 1},
@@ -116,13 +128,16 @@ static struct command commands[] = {
 	{ "coastalwaterlocation", cmd_show_coastal_location, "Show a random coastal water location", 0, 0, 1},
 	{ "elfname", cmd_show_elf_name, "Show a random Elf name", 0, 0, 1},
 	{ "findanopportunity", cmd_find_an_opportunity, "Show a random opportunity", 0, 0, 1},
+	{ "generate", cmd_generate, "Run a generator template", 0, 0, 1},
 	{ "generatenpc", cmd_generate_npc, "Generate a random NPC", 0, 0, 1},
 	{ "giantname", cmd_show_giant_name, "Show a random Giant name", 0, 0, 1},
 	{ "ironlandername", cmd_show_iron_name, "Show a random Ironlander name", 0, 0, 1},
 	{ "location", cmd_show_location, "Show a random location", 0, 0, 1},
 	{ "locationdescription", cmd_show_location_description, "Show a random location description", 0, 0, 1},
+	{ "monstrosity", cmd_generate_monstrosity, "Generate a random monstrosity", 0, 0, 1},
 	{ "moonoracle", cmd_moon_oracle, "Show moon phases from Sundered Isles ", 0, 0, 1},
 	{ "mysticbackslash", cmd_show_mystic_backshlash, "Show a random mystic backlash", 0, 0, 1},
+	{ "norepeat", cmd_no_repeat, "Turn no-repeat oracle draws on or off", 0, 0, 1},
 	{ "paytheprice", cmd_show_pay_the_price, "Show a random pay the price result", 0, 0, 1},
 	{ "plottwist", cmd_show_plot_twist, "Show a random major plot twist", 0, 0, 1},
 	{ "rank", cmd_show_rank, "Show a random challenge rank", 0, 0, 1},
@@ -132,6 +147,7 @@ static struct command commands[] = {
 	{ "theme", cmd_show_theme, "Show a random theme oracle", 0, 0, 1},
 	{ "trollname", cmd_show_troll_name, "Show a random Troll name", 0, 0, 1},
 	{ "varouname", cmd_show_varou_name, "Show a random Varou name", 0, 0, 1},
+	{ "worldtruths", cmd_world_truths, "Set up or show the truths of your world", 0, 0, 1},
 	{ (char *)NULL, NULL, (char *)NULL, 0, 0, 0}
 };
 
@@ -244,9 +260,13 @@ void
 execute_command(char *line)
 {
 	struct command *cmd;
+	uint64_t start;
 	char *word;
 	int i = 0;
 
+	sync_oracle_tables();
+	sync_campaign();
+
 	/* Skip over white spaces */
 	while (line[i] && isspace(line[i]))
 		i++;
@@ -281,7 +301,12 @@ execute_command(char *line)
 
 	word = line + i;
 
-	((*(cmd->cmd)) (word));
+	start = stats_now();
+	{
+		TRACE_SPAN(cmd->name, "command", NULL);
+		((*(cmd->cmd)) (word));
+	}
+	stats_command(cmd->name, stats_now() - start);
 	return;
 }
 
@@ -16,6 +16,7 @@
 
 #include <errno.h>
 #include <limits.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -24,6 +25,15 @@
 
 #define MAXTOKENS 3
 
+/*
+ * Threads that roll a lot of dice, like the simulator's workers, seed a
+ * generator of their own instead of sharing random() with everybody else.
+ */
+static _Thread_local uint64_t thread_rng = 0;
+
+/* The last action roll of this thread */
+static _Thread_local struct roll_event last_roll;
+
 static const char *odds[] = {
 	"Almost certain",
 	"Likely",
@@ -140,6 +150,7 @@ cmd_forge_a_bond(char *cmd)
 	if (ret == STRONG || ret == STRONG_MATCH) {
 		printf("You forge a bond and choose one option -> Rulebook\n");
 		curchar->bonds += 0.25;
+		mark_dirty();
 	} else if (ret == WEAK || ret == WEAK_MATCH) {
 		printf("They ask something from you first -> Rulebook\n");
 	} else if (ret == MISS || ret == MISS_MATCH)
@@ -156,6 +167,7 @@ cmd_mark_a_bond(__attribute__((unused))char *cmd)
 	if (curchar->bonds <= 30) {
 		printf("You mark a bond\n");
 		curchar->bonds += 0.25;
+		mark_dirty();
 	}
 }
 
@@ -168,10 +180,11 @@ cmd_burn_momentum(__attribute__((unused))char *cmd)
 
 	if (curchar->momentum > curchar->momentum_reset) {
 		curchar->momentum = curchar->momentum_reset;
-		printf("You burn your momentum and reset it to %d\n",
+		mark_dirty();
+		pm(NO_JOURNAL, "You burn your momentum and reset it to %d\n",
 			curchar->momentum_reset);
 	} else {
-		printf("Your momentum is lower than your reset momentum.  "
+		pm(NO_JOURNAL, "Your momentum is lower than your reset momentum.  "
 			"Nothing to burn.\n");
 	}
 }
@@ -201,6 +214,7 @@ cmd_test_your_bond(char *cmd)
 	} else if (ret == MISS || ret == MISS_MATCH) {
 		printf("Your bond is cleared.  Pay the price -> Rulebook\n");
 		curchar->bonds -= 0.25;
+		mark_dirty();
 	}
 }
 
@@ -235,6 +249,8 @@ cmd_endure_stress(char *cmd)
 			"momentum is down to %d\n",	ival[1], curchar->momentum);
 	}
 
+	mark_dirty();
+
 	/* Reset ival[1] since we need no bonus for the roll */
 	ival[1] = -1;
 	ival[0] = curchar->heart;
@@ -274,6 +290,7 @@ cmd_face_death(char *cmd)
 	} else if (ret == MISS || ret == MISS_MATCH) {
 		printf("You are dead\n");
 		curchar->dead = 1;
+		mark_dirty();
 	}
 }
 
@@ -595,10 +612,34 @@ cmd_roll_oracle_die(__attribute__((unused)) char *unused)
 		pm(DEFAULT, "%ld\n", roll_oracle_die());
 }
 
+void
+seed_thread_rng(uint64_t seed)
+{
+	thread_rng = seed != 0 ? seed : 1;
+}
+
+static long
+next_random(void)
+{
+	if (thread_rng == 0) {
+		stats_rng_draw();
+		return random();
+	}
+
+	/* xorshift64* */
+	thread_rng ^= thread_rng >> 12;
+	thread_rng ^= thread_rng << 25;
+	thread_rng ^= thread_rng >> 27;
+
+	return (long)((thread_rng * 2685821657736338717ULL) >> 33);
+}
+
 long
 roll_action_die(void)
 {
-	long ret = random() % 6;
+	long ret;
+
+	ret = next_random() % 6;
 
 	return ret == 0 ? 6 : ret;
 }
@@ -606,13 +647,20 @@ roll_action_die(void)
 long
 roll_challenge_die(void)
 {
-	return random() % 10;
+	return next_random() % 10;
 }
 
 long
 roll_oracle_die(void)
 {
-	return random() % 100;
+	return next_random() % 100;
+}
+
+/* Return the outcome of the last action roll of this thread */
+const struct roll_event *
+last_action_roll(void)
+{
+	return &last_roll;
 }
 
 void
@@ -681,8 +729,9 @@ int
 action_roll(int args[2])
 {
 	struct character *curchar = get_current_character();
-	long c1, c2, a1, b, cd;
-	int ret = 0, match = 0;
+	struct event ev;
+	struct roll_event *r = &ev.roll;
+	long a1, b;
 
 	log_debug("Action args: %d, %d\n", args[0], args[1]);
 
@@ -707,82 +756,60 @@ action_roll(int args[2])
 	if (args[1] != -1)
 		b += args[1];
 
-	cd = roll_challenge_die();
-	cd = (cd == 0 ? 10 : cd);
+	memset(&ev, 0, sizeof(ev));
+	ev.type = EVENT_ACTION_ROLL;
+	r->action = a1;
+	r->stat = args[0];
+	r->bonus = args[1];
+	r->score = b;
 
-	if (get_cursed()) {
-		if (cd == 10) {
-			pm(BLUE, "Cursed result: ");
-		}
-	}
-
-	if (args[1] == -1) {
-		if (get_color())
-			pm(DEFAULT, "<%ld> + %d = %ld ", a1, args[0], b);
-		else
-			pm(DEFAULT, "%ld + %d = %ld ", a1, args[0], b);
-	}
-	else {
-		if (get_color())
-			pm(DEFAULT, "<%ld> + %d + %d = %ld ", a1, args[0], args[1], b);
-		else
-			pm(DEFAULT, "%ld + %d + %d = %ld ", a1, args[0], args[1], b);
-	}
+	r->cursed = roll_challenge_die();
+	r->cursed = (r->cursed == 0 ? 10 : r->cursed);
 
 	/* Roll challenge die and replace a 0 with 10 for both cosmetic and
 	 * arithmetic reasons */
-	c1 = roll_challenge_die();
-	c2 = roll_challenge_die();
-	c1 = (c1 == 0 ? 10 : c1);
-	c2 = (c2 == 0 ? 10 : c2);
+	r->challenge[0] = roll_challenge_die();
+	r->challenge[1] = roll_challenge_die();
+	r->challenge[0] = (r->challenge[0] == 0 ? 10 : r->challenge[0]);
+	r->challenge[1] = (r->challenge[1] == 0 ? 10 : r->challenge[1]);
+	r->match = (r->challenge[0] == r->challenge[1]);
+
+	if (b <= r->challenge[0] && b <= r->challenge[1])
+		r->result = MISS;
+	else if (b <= r->challenge[0] || b <= r->challenge[1])
+		r->result = WEAK;
+	else
+		r->result = STRONG;
 
-	/* Use a special way to display matches so that they don't get
-	 * unnoticed for the player */
-	if (c1 == c2) {
-		match = 10;
-
-		if (get_color())
-			pm(DEFAULT, "vs <%ld> match ", c1);
-		else
-			pm(DEFAULT, "vs %ld match ", c1);
-	} else {
-		if (get_color())
-			pm(DEFAULT, "vs <%ld><%ld> ", c1, c2);
-		else
-			pm(DEFAULT, "vs %ld, %ld ", c1, c2);
-	}
+	last_roll = *r;
+	emit_event(&ev);
 
 	/* Reset strong hit indicator for the loaded character, it will be re-set in
 	 * the next code block */
 	if (curchar != NULL)
 		curchar->strong_hit = 0;
 
-	if (b <= c1 && b <= c2) {
-		pm(RED, "miss\n");
-		ret = MISS;
+	if (r->result == MISS && curchar != NULL) {
 		/* Increase the failure track by one tick on every miss */
 		modify_double("failure", &curchar->failure_track, 10.0, 0.0, 0.25, INCREASE);
-	} else if (b <= c1 || b <= c2) {
-		pm(YELLOW, "weak hit\n");
-		ret = WEAK;
-	} else if (b > c1 && b > c2) {
-		pm(GREEN, "strong hit\n");
-		if (curchar != NULL)
-			curchar->strong_hit = 1;
-		ret = STRONG;
-	}
+		/* A miss in pursuit of a vow lets linked threats grow in menace */
+		if (curchar->vow_active)
+			advance_threats_of_vow(curchar->vid);
+	} else if (r->result == STRONG && curchar != NULL)
+		curchar->strong_hit = 1;
+	mark_dirty();
 
 	/* In case of a match, 10 are added */
-	return ret + match;
+	return r->result + (r->match ? 10 : 0);
 }
 
 int
 progress_roll(double args[2])
 {
 	struct character *curchar = get_current_character();
+	struct event ev;
+	struct roll_event *r = &ev.roll;
 	double pr_score;
-	long c1, c2;
-	int ret = 0, match = 0;
 
 	if (args[0] == -1) {
 		log_errx(1, "No attribute value provided. This should not happen!");
@@ -792,48 +819,39 @@ progress_roll(double args[2])
 	if (curchar == NULL)
 		return -1;
 
-	/* Roll challenge die and replace a 0 with 10 for both cosmetic and
-	 * arithmetic reasons */
-	c1 = roll_challenge_die();
-	c2 = roll_challenge_die();
-	c1 = (c1 == 0 ? 10 : c1);
-	c2 = (c2 == 0 ? 10 : c2);
-
 	log_debug("args[0] %.2lf args[1] %.2lf\n", args[0], args[1]);
 
 	pr_score = args[0];
 	if (args[1] != -1)
 		pr_score += args[1];
 
-	if (c1 == c2) {
-		match = 10;
-		if (get_color())
-			pm(DEFAULT, "<%ld> match vs ", c1);
-		else
-			pm(DEFAULT, "%ld match vs ", c1);
-	} else {
-		if (get_color())
-			pm(DEFAULT, "<%ld><%ld> vs ", c1, c2);
-		else
-			pm(DEFAULT, "%ld, %ld vs ", c1, c2);
-	}
+	memset(&ev, 0, sizeof(ev));
+	ev.type = EVENT_PROGRESS_ROLL;
+	r->score = pr_score;
+	r->bonus = -1;
+
+	/* Roll challenge die and replace a 0 with 10 for both cosmetic and
+	 * arithmetic reasons */
+	r->challenge[0] = roll_challenge_die();
+	r->challenge[1] = roll_challenge_die();
+	r->challenge[0] = (r->challenge[0] == 0 ? 10 : r->challenge[0]);
+	r->challenge[1] = (r->challenge[1] == 0 ? 10 : r->challenge[1]);
+	r->match = (r->challenge[0] == r->challenge[1]);
+
+	if (pr_score <= r->challenge[0] && pr_score <= r->challenge[1])
+		r->result = MISS;
+	else if (pr_score <= r->challenge[0] || pr_score <= r->challenge[1])
+		r->result = WEAK;
+	else
+		r->result = STRONG;
 
-	pm(DEFAULT, "Progress: %.2lf ", pr_score);
+	emit_event(&ev);
 
-	if (pr_score <= c1 && pr_score <= c2) {
-		pm(RED, "miss\n");
-		ret = MISS;
-		/* Increase the failure track by two ticks on every miss */
+	/* Increase the failure track by two ticks on every miss */
+	if (r->result == MISS)
 		modify_double("failure", &curchar->failure_track, 10.0, 0.0, 0.5, INCREASE);
-	} else if (pr_score <= c1 || pr_score <= c2) {
-		pm(YELLOW, "weak hit\n");
-		ret = WEAK;
-	} else if (pr_score > c1 && pr_score > c2) {
-		pm(GREEN, "strong hit\n");
-		ret = STRONG;
-	}
 
-	return ret + match;
+	return r->result + (r->match ? 10 : 0);
 }
 
 int
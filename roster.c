@@ -0,0 +1,312 @@
+/*
+ * Copyright (c) 2026 Matthias Schmidt <xhr@giessen.ccc.de>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * The roster is the index of all existing characters.  Entries live in one
+ * contiguous array, names are interned into a single string pool and two
+ * open addressing hash tables map a case-insensitive name and an id to the
+ * array slot.  Slots in the tables store the array index plus one, so that
+ * zero marks an empty bucket.
+ */
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "isscrolls.h"
+
+#define ROSTER_MIN_BUCKETS	64
+
+struct roster_entry {
+	int id;
+	uint32_t hash;
+	size_t name;		/* Offset into the string pool */
+	uint64_t generation;	/* Campaign generation of the saved record */
+};
+
+static struct roster_entry *entries = NULL;
+static size_t n_entries = 0;
+static size_t cap_entries = 0;
+
+static char *pool = NULL;
+static size_t pool_len = 0;
+static size_t pool_cap = 0;
+
+static uint32_t *by_name = NULL;
+static uint32_t *by_id = NULL;
+static size_t n_buckets = 0;
+
+static uint32_t
+hash_name(const char *name)
+{
+	uint32_t h = 2166136261u;
+
+	/* FNV-1a over the lower cased name */
+	for (; *name != '\0'; name++) {
+		h ^= (unsigned char)tolower((unsigned char)*name);
+		h *= 16777619u;
+	}
+
+	return h;
+}
+
+static uint32_t
+hash_id(int id)
+{
+	uint32_t h = (uint32_t)id;
+
+	h ^= h >> 16;
+	h *= 0x7feb352du;
+	h ^= h >> 15;
+	h *= 0x846ca68bu;
+	h ^= h >> 16;
+
+	return h;
+}
+
+static const char *
+entry_name(size_t idx)
+{
+	return pool + entries[idx].name;
+}
+
+static void
+insert_buckets(size_t idx)
+{
+	size_t mask = n_buckets - 1;
+	size_t b;
+
+	for (b = entries[idx].hash & mask; by_name[b] != 0; b = (b + 1) & mask)
+		;
+	by_name[b] = idx + 1;
+
+	for (b = hash_id(entries[idx].id) & mask; by_id[b] != 0; b = (b + 1) & mask)
+		;
+	by_id[b] = idx + 1;
+}
+
+static void
+rebuild_buckets(size_t buckets)
+{
+	size_t i;
+
+	free(by_name);
+	free(by_id);
+
+	if ((by_name = calloc(buckets, sizeof(*by_name))) == NULL ||
+	    (by_id = calloc(buckets, sizeof(*by_id))) == NULL)
+		log_errx(1, "cannot allocate memory\n");
+	n_buckets = buckets;
+
+	for (i = 0; i < n_entries; i++)
+		insert_buckets(i);
+}
+
+static size_t
+intern_name(const char *name)
+{
+	size_t len = strlen(name) + 1;
+	size_t off = pool_len;
+	char *temp;
+
+	if (pool_len + len > pool_cap) {
+		size_t ncap = pool_cap == 0 ? 4096 : pool_cap;
+
+		while (pool_len + len > ncap)
+			ncap *= 2;
+		if ((temp = realloc(pool, ncap)) == NULL)
+			log_errx(1, "cannot allocate memory\n");
+		pool = temp;
+		pool_cap = ncap;
+	}
+
+	memcpy(pool + off, name, len);
+	pool_len += len;
+
+	return off;
+}
+
+/*
+ * Drop the names of removed characters from the string pool.  Only called
+ * from roster_remove() once half of the pool is garbage.
+ */
+static void
+compact_pool(void)
+{
+	char *npool;
+	size_t i, len, off = 0;
+
+	if ((npool = malloc(pool_cap)) == NULL)
+		log_errx(1, "cannot allocate memory\n");
+
+	for (i = 0; i < n_entries; i++) {
+		len = strlen(entry_name(i)) + 1;
+		memcpy(npool + off, entry_name(i), len);
+		entries[i].name = off;
+		off += len;
+	}
+
+	free(pool);
+	pool = npool;
+	pool_len = off;
+}
+
+static long
+find_id(int id)
+{
+	size_t mask = n_buckets - 1;
+	size_t b;
+
+	if (n_buckets == 0)
+		return -1;
+
+	for (b = hash_id(id) & mask; by_id[b] != 0; b = (b + 1) & mask) {
+		if (entries[by_id[b] - 1].id == id)
+			return by_id[b] - 1;
+	}
+
+	return -1;
+}
+
+void
+roster_clear(void)
+{
+	free(entries);
+	free(pool);
+	free(by_name);
+	free(by_id);
+
+	entries = NULL;
+	pool = NULL;
+	by_name = by_id = NULL;
+	n_entries = cap_entries = pool_len = pool_cap = n_buckets = 0;
+}
+
+void
+roster_add(int id, const char *name)
+{
+	struct roster_entry *temp;
+
+	if (find_id(id) != -1) {
+		log_debug("Character id %d is already in the roster\n", id);
+		return;
+	}
+
+	if (n_entries == cap_entries) {
+		size_t ncap = cap_entries == 0 ? 32 : cap_entries * 2;
+
+		if ((temp = reallocarray(entries, ncap, sizeof(*entries))) == NULL)
+			log_errx(1, "cannot allocate memory\n");
+		entries = temp;
+		cap_entries = ncap;
+	}
+
+	entries[n_entries].id = id;
+	entries[n_entries].hash = hash_name(name);
+	entries[n_entries].name = intern_name(name);
+	entries[n_entries].generation = 0;
+	n_entries++;
+
+	/* Keep the load factor of the tables at or below one half */
+	if (n_entries * 2 > n_buckets)
+		rebuild_buckets(n_buckets == 0 ? ROSTER_MIN_BUCKETS : n_buckets * 2);
+	else
+		insert_buckets(n_entries - 1);
+}
+
+void
+roster_remove(int id)
+{
+	long idx;
+	size_t live = 0, i;
+
+	if ((idx = find_id(id)) == -1)
+		return;
+
+	/* Move the last entry into the hole and rehash, deletes are rare */
+	entries[idx] = entries[--n_entries];
+	rebuild_buckets(n_buckets);
+
+	for (i = 0; i < n_entries; i++)
+		live += strlen(entry_name(i)) + 1;
+	if (live < pool_len / 2)
+		compact_pool();
+}
+
+int
+roster_find_name(const char *name)
+{
+	size_t mask = n_buckets - 1;
+	size_t b;
+	uint32_t h, idx;
+
+	if (name == NULL || n_buckets == 0)
+		return -1;
+
+	h = hash_name(name);
+	for (b = h & mask; by_name[b] != 0; b = (b + 1) & mask) {
+		idx = by_name[b] - 1;
+		if (entries[idx].hash == h &&
+		    strcasecmp(entry_name(idx), name) == 0)
+			return entries[idx].id;
+	}
+
+	return -1;
+}
+
+int
+roster_contains(int id)
+{
+	return find_id(id) != -1;
+}
+
+size_t
+roster_count(void)
+{
+	return n_entries;
+}
+
+const char *
+roster_name_at(size_t idx)
+{
+	if (idx >= n_entries)
+		return NULL;
+
+	return entry_name(idx);
+}
+
+void
+roster_set_generation(int id, uint64_t generation)
+{
+	long idx;
+
+	if ((idx = find_id(id)) != -1)
+		entries[idx].generation = generation;
+}
+
+uint64_t
+roster_generation(int id)
+{
+	long idx;
+
+	if ((idx = find_id(id)) == -1)
+		return 0;
+
+	return entries[idx].generation;
+}
@@ -0,0 +1,467 @@
+/*
+ * Copyright (c) 2026 Matthias Schmidt <xhr@giessen.ccc.de>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Headless campaign simulator for balancing house rules.  Plays vows or
+ * journeys with a scripted strategy through the real move functions,
+ * action_roll(), progress_roll() and the mark_*_progress() family.  Every
+ * worker thread has its own character, dice, quiet console and no event
+ * sinks, so the engine runs without output and without sharing state.
+ *
+ * The runs are split into one range per worker.  A worker takes batches from
+ * the front of its own range and, once that is empty, steals the back half of
+ * the largest range left, so that all cores stay busy until the end.
+ */
+
+#include <limits.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "isscrolls.h"
+
+#define SIM_DEFAULT_RUNS	1000000
+#define SIM_BATCH		512
+#define SIM_MAX_ROLLS		500	/* Runs that take longer are stalled */
+#define SIM_MAX_THREADS		64
+
+enum sim_mode {
+	SIM_VOW,
+	SIM_JOURNEY,
+};
+
+struct sim_options {
+	long runs;
+	int mode;
+	int rank;
+	int stat;
+	int reset;
+	int threshold;
+	int threads;
+};
+
+struct sim_stats {
+	long runs;
+	long strong;
+	long weak;
+	long miss;
+	long stalled;
+	long rolls;
+	long burns;
+	long cursed;
+	long supply;
+	long unprepared;
+	long steals;
+};
+
+struct sim_worker {
+	pthread_mutex_t lock;
+	long next;		/* Runs [next, end) are left in this worker's range */
+	long end;
+	struct sim_stats st;
+	uint64_t seed;
+	pthread_t thread;
+};
+
+static struct sim_options opts = {
+	.runs = SIM_DEFAULT_RUNS,
+	.mode = SIM_VOW,
+	.rank = 3,
+	.stat = 2,
+	.reset = 2,
+	.threshold = 7,
+	.threads = 0,
+};
+
+static struct sim_worker *workers = NULL;
+
+static int
+is_strong(int ret)
+{
+	return ret == STRONG || ret == STRONG_MATCH;
+}
+
+static int
+is_weak(int ret)
+{
+	return ret == WEAK || ret == WEAK_MATCH;
+}
+
+/*
+ * Make an action roll and burn momentum if that turns a miss into a hit or a
+ * weak hit into a strong hit.
+ */
+static int
+sim_action(struct character *c, struct sim_stats *st)
+{
+	const struct roll_event *r;
+	int ival[2] = { -1, -1 };
+	int ret, beats;
+
+	ival[0] = opts.stat;
+	ret = action_roll(ival);
+	r = last_action_roll();
+	if (get_cursed() && r->cursed == 10)
+		st->cursed++;
+
+	if (is_strong(ret) || c->momentum <= c->momentum_reset)
+		return ret;
+
+	beats = (c->momentum > r->challenge[0]) + (c->momentum > r->challenge[1]);
+	if (beats == 2 || (beats == 1 && !is_weak(ret))) {
+		cmd_burn_momentum(NULL);
+		st->burns++;
+		return beats == 2 ? STRONG : WEAK;
+	}
+
+	return ret;
+}
+
+static double *
+sim_progress(struct character *c)
+{
+	return opts.mode == SIM_VOW ? &c->vow->progress : &c->j->progress;
+}
+
+static void
+sim_reset(struct character *c)
+{
+	c->momentum = 2;
+	c->max_momentum = 10;
+	c->momentum_reset = opts.reset;
+	c->health = c->spirit = c->supply = 5;
+	c->failure_track = 0;
+	c->vid = -1;		/* No threats are linked to simulated vows */
+
+	c->vow_active = opts.mode == SIM_VOW;
+	c->vow->difficulty = opts.rank;
+	c->vow->progress = 0;
+
+	c->journey_active = opts.mode == SIM_JOURNEY;
+	c->j->difficulty = opts.rank;
+	c->j->progress = 0;
+}
+
+/*
+ * Play one vow or journey: roll until progress reached the threshold, then
+ * make the progress move.  Strong hits mark progress and +1 momentum, weak
+ * hits mark progress, on journeys at the cost of -1 supply, misses cost -1
+ * momentum.
+ */
+static void
+sim_run(struct character *c, struct sim_stats *st)
+{
+	double dval[2] = { -1.0, -1.0 };
+	int rolls, ret;
+
+	sim_reset(c);
+
+	for (rolls = 0; rolls < SIM_MAX_ROLLS; rolls++) {
+		if (*sim_progress(c) >= opts.threshold)
+			break;
+
+		ret = sim_action(c, st);
+		if (is_strong(ret) || is_weak(ret)) {
+			if (opts.mode == SIM_VOW)
+				mark_vow_progress(INCREASE);
+			else {
+				if (is_weak(ret))
+					change_char_value("supply", DECREASE, 1);
+				mark_journey_progress(INCREASE);
+			}
+		}
+
+		if (is_strong(ret))
+			change_char_value("momentum", INCREASE, 1);
+		else if (!is_weak(ret))
+			change_char_value("momentum", DECREASE, 1);
+	}
+
+	st->runs++;
+	st->rolls += rolls;
+	st->supply += 5 - c->supply;
+	if (c->supply == 0)
+		st->unprepared++;
+
+	if (rolls == SIM_MAX_ROLLS) {
+		st->stalled++;
+		return;
+	}
+
+	dval[0] = *sim_progress(c);
+	ret = progress_roll(dval);
+	if (is_strong(ret))
+		st->strong++;
+	else if (is_weak(ret))
+		st->weak++;
+	else
+		st->miss++;
+}
+
+/* Take the next batch of runs from w's own range */
+static long
+take_batch(struct sim_worker *w)
+{
+	long n = 0;
+
+	pthread_mutex_lock(&w->lock);
+	if (w->next < w->end) {
+		n = w->end - w->next < SIM_BATCH ? w->end - w->next : SIM_BATCH;
+		w->next += n;
+	}
+	pthread_mutex_unlock(&w->lock);
+
+	return n;
+}
+
+/* Move the back half of the largest range left over to w's range */
+static int
+steal_batch(struct sim_worker *w)
+{
+	struct sim_worker *v, *victim = NULL;
+	long left, most = 0, mid, end;
+	int i;
+
+	for (i = 0; i < opts.threads; i++) {
+		v = &workers[i];
+		if (v == w)
+			continue;
+		/* A racy peek is fine, the victim is checked again under lock */
+		left = __atomic_load_n(&v->end, __ATOMIC_RELAXED) -
+		    __atomic_load_n(&v->next, __ATOMIC_RELAXED);
+		if (left > most) {
+			most = left;
+			victim = v;
+		}
+	}
+
+	if (victim == NULL)
+		return 0;
+
+	pthread_mutex_lock(&victim->lock);
+	left = victim->end - victim->next;
+	if (left <= 0) {
+		pthread_mutex_unlock(&victim->lock);
+		return 1;	/* Somebody else was faster, look again */
+	}
+	mid = victim->next + left / 2;
+	end = victim->end;
+	victim->end = mid;
+	pthread_mutex_unlock(&victim->lock);
+
+	pthread_mutex_lock(&w->lock);
+	w->next = mid;
+	w->end = end;
+	pthread_mutex_unlock(&w->lock);
+	w->st.steals++;
+
+	return 1;
+}
+
+static void *
+sim_worker(void *arg)
+{
+	struct sim_worker *w = arg;
+	struct character *c;
+	long n;
+
+	set_quiet(1);
+	set_event_sinks(0);
+	seed_thread_rng(w->seed);
+
+	c = init_character_struct();
+	set_thread_character(c);
+
+	for (;;) {
+		while ((n = take_batch(w)) > 0) {
+			while (n-- > 0)
+				sim_run(c, &w->st);
+		}
+		if (!steal_batch(w))
+			break;
+	}
+
+	set_thread_character(NULL);
+	release_character(c);
+
+	return NULL;
+}
+
+static int
+online_cores(void)
+{
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+
+	if (n < 1)
+		return 1;
+	else if (n > SIM_MAX_THREADS)
+		return SIM_MAX_THREADS;
+
+	return (int)n;
+}
+
+static long
+parse_number(const char *arg, long min, long max)
+{
+	char *ep;
+	long val;
+
+	val = strtol(arg, &ep, 10);
+	if (*arg == '\0' || *ep != '\0' || val < min || val > max) {
+		fprintf(stderr, "%s is not a number between %ld and %ld\n",
+			arg, min, max);
+		exit(1);
+	}
+
+	return val;
+}
+
+static void
+print_report(const struct sim_stats *t, double elapsed)
+{
+	double runs = t->runs > 0 ? t->runs : 1;
+
+	printf("mode %s rank %d stat %d reset %d threshold %d cursed %s\n",
+		opts.mode == SIM_VOW ? "vow" : "journey", opts.rank, opts.stat,
+		opts.reset, opts.threshold, get_cursed() ? "yes" : "no");
+	printf("runs %ld threads %d steals %ld time %.2lfs (%.0lf runs/s)\n\n",
+		t->runs, opts.threads, t->steals, elapsed, t->runs / elapsed);
+
+	printf("strong hit   %6.2lf%%\n", 100.0 * t->strong / runs);
+	printf("weak hit     %6.2lf%%\n", 100.0 * t->weak / runs);
+	printf("miss         %6.2lf%%\n", 100.0 * t->miss / runs);
+	printf("stalled      %6.2lf%%\n", 100.0 * t->stalled / runs);
+	printf("rolls/run    %7.2lf\n", t->rolls / runs);
+	printf("burns/run    %7.2lf\n", t->burns / runs);
+	if (get_cursed())
+		printf("cursed/run   %7.2lf\n", t->cursed / runs);
+	if (opts.mode == SIM_JOURNEY) {
+		printf("supply/run   %7.2lf\n", t->supply / runs);
+		printf("unprepared   %6.2lf%%\n", 100.0 * t->unprepared / runs);
+	}
+}
+
+static __attribute__((noreturn)) void
+usage(void)
+{
+	fprintf(stderr, "usage: isscrolls-sim [-x] [-m vow|journey] [-n runs] "
+		"[-r rank] [-R reset]\n\t[-s stat] [-T threshold] [-t threads]\n");
+	exit(1);
+}
+
+int
+main(int argc, char **argv)
+{
+	struct sim_stats total;
+	struct timespec start, end;
+	long share;
+	int ch, i;
+
+	while ((ch = getopt(argc, argv, "m:n:r:R:s:t:T:x")) != -1) {
+		switch (ch) {
+		case 'm':
+			if (strcasecmp(optarg, "vow") == 0)
+				opts.mode = SIM_VOW;
+			else if (strcasecmp(optarg, "journey") == 0)
+				opts.mode = SIM_JOURNEY;
+			else
+				usage();
+			break;
+		case 'n':
+			opts.runs = parse_number(optarg, 1, LONG_MAX / 2);
+			break;
+		case 'r':
+			opts.rank = parse_number(optarg, 1, 5);
+			break;
+		case 'R':
+			opts.reset = parse_number(optarg, -6, 2);
+			break;
+		case 's':
+			opts.stat = parse_number(optarg, 0, 4);
+			break;
+		case 't':
+			opts.threads = parse_number(optarg, 1, SIM_MAX_THREADS);
+			break;
+		case 'T':
+			opts.threshold = parse_number(optarg, 1, 10);
+			break;
+		case 'x':
+			set_cursed(1);
+			break;
+		default:
+			usage();
+		}
+	}
+
+	if (argc != optind)
+		usage();
+
+	if (opts.threads == 0)
+		opts.threads = online_cores();
+
+	if ((workers = calloc(opts.threads, sizeof(*workers))) == NULL)
+		log_errx(1, "calloc\n");
+
+	srandom(time(NULL) ^ getpid());
+
+	/* Hand every worker an equal share, stealing evens out the rest */
+	share = opts.runs / opts.threads;
+	for (i = 0; i < opts.threads; i++) {
+		pthread_mutex_init(&workers[i].lock, NULL);
+		workers[i].next = share * i;
+		workers[i].end = i == opts.threads - 1 ? opts.runs : share * (i + 1);
+		workers[i].seed = (uint64_t)random() << 32 | (uint64_t)random();
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for (i = 0; i < opts.threads; i++) {
+		if (pthread_create(&workers[i].thread, NULL, sim_worker,
+		    &workers[i]) != 0)
+			log_errx(1, "Cannot start worker thread %d\n", i);
+	}
+
+	memset(&total, 0, sizeof(total));
+	for (i = 0; i < opts.threads; i++) {
+		pthread_join(workers[i].thread, NULL);
+		total.runs += workers[i].st.runs;
+		total.strong += workers[i].st.strong;
+		total.weak += workers[i].st.weak;
+		total.miss += workers[i].st.miss;
+		total.stalled += workers[i].st.stalled;
+		total.rolls += workers[i].st.rolls;
+		total.burns += workers[i].st.burns;
+		total.cursed += workers[i].st.cursed;
+		total.supply += workers[i].st.supply;
+		total.unprepared += workers[i].st.unprepared;
+		total.steals += workers[i].st.steals;
+		pthread_mutex_destroy(&workers[i].lock);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	print_report(&total, (end.tv_sec - start.tv_sec) +
+		(end.tv_nsec - start.tv_nsec) / 1e9);
+
+	free(workers);
+
+	return 0;
+}
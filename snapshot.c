@@ -0,0 +1,894 @@
+/*
+ * Copyright (c) 2026 Matthias Schmidt <xhr@giessen.ccc.de>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+/*
+ * Binary snapshot of all characters in characters.bin.  The file starts
+ * with a fixed size header followed by one fixed size record per character.
+ * A record holds the fields of char_fields[] in table order, ints as 4 and
+ * doubles as 8 bytes in host byte order, strings as MAX_CHAR_LEN bytes, and
+ * ends with the 8 byte campaign generation the character was saved in and
+ * a CRC32 of the record.  The header carries a CRC32 of the
+ * character schema, so that a file written with a different field table is
+ * rejected instead of misread.  Every change writes a new file that is moved
+ * over the old one, so a reader never sees a record half written.
+ *
+ * Whichever of characters.json and characters.bin was written last holds
+ * the current state.  On startup the store of the configured format is
+ * brought up to date by converting the other one.
+ */
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <json-c/json.h>
+
+#include "isscrolls.h"
+
+#ifdef __APPLE__
+#define st_mtim st_mtimespec
+#endif
+
+#define SNAPSHOT_MAGIC		"ISSCROLL"
+#define SNAPSHOT_VERSION	2
+#define SNAPSHOT_BYTEORDER	0x01020304
+
+struct snapshot_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t byteorder;
+	uint32_t record_size;
+	uint32_t n_fields;
+	uint32_t schema_crc;
+	uint32_t n_records;
+	int32_t last_used;
+	uint32_t reserved[6];
+	uint32_t crc;
+};
+
+struct snapshot_map {
+	struct snapshot_header h;
+	unsigned char *base;
+	size_t len;
+	int mapped;
+};
+
+static int snapshot = 0;
+
+static uint32_t crc_table[256];
+static size_t record_size;
+static size_t id_offset;
+static uint32_t schema_crc;
+
+static uint32_t
+snapshot_crc32(uint32_t crc, const void *buf, size_t len)
+{
+	const unsigned char *p = buf;
+	uint32_t c;
+	int i, k;
+
+	if (crc_table[1] == 0) {
+		for (i = 0; i < 256; i++) {
+			c = i;
+			for (k = 0; k < 8; k++)
+				c = c & 1 ? 0xedb88320 ^ (c >> 1) : c >> 1;
+			crc_table[i] = c;
+		}
+	}
+
+	crc = ~crc;
+	while (len--)
+		crc = crc_table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+
+	return ~crc;
+}
+
+static size_t
+field_size(const struct char_field *f)
+{
+	switch (f->type) {
+	case FIELD_STRING:
+		return MAX_CHAR_LEN;
+	case FIELD_INT:
+		return sizeof(int32_t);
+	case FIELD_DOUBLE:
+		return sizeof(double);
+	}
+
+	return 0;
+}
+
+/* Derive the record layout from the character schema */
+static void
+init_layout(void)
+{
+	const struct char_field *f;
+	uint32_t type;
+
+	if (record_size != 0)
+		return;
+
+	schema_crc = snapshot_crc32(0, "MAX_CHAR_LEN", 12);
+	type = MAX_CHAR_LEN;
+	schema_crc = snapshot_crc32(schema_crc, &type, sizeof(type));
+
+	for (f = char_fields; f < char_fields + n_char_fields; f++) {
+		if (strcmp(f->key, "id") == 0)
+			id_offset = record_size;
+		record_size += field_size(f);
+
+		type = f->type;
+		schema_crc = snapshot_crc32(schema_crc, f->key, strlen(f->key) + 1);
+		schema_crc = snapshot_crc32(schema_crc, &type, sizeof(type));
+	}
+
+	/* Trailing generation and CRC32 */
+	record_size += sizeof(uint64_t) + sizeof(uint32_t);
+}
+
+static void
+snapshot_path(char *path, size_t len, const char *file)
+{
+	int ret;
+
+	ret = snprintf(path, len, "%s/%s", get_isscrolls_dir(), file);
+	if (ret < 0 || (size_t)ret >= len) {
+		log_errx(1, "Path truncation happened.  Buffer too short to fit %s\n", path);
+	}
+}
+
+static void
+pack_record(unsigned char *rec, struct character *c)
+{
+	const struct char_field *f;
+	unsigned char *p = rec;
+	const char *name;
+	int32_t i32;
+	uint32_t crc;
+
+	for (f = char_fields; f < char_fields + n_char_fields; f++) {
+		switch (f->type) {
+		case FIELD_STRING:
+			memset(p, 0, MAX_CHAR_LEN);
+			memcpy(&name, (char *)c + f->offset, sizeof(name));
+			if (name != NULL)
+				memcpy(p, name, strnlen(name, MAX_CHAR_LEN - 1));
+			break;
+		case FIELD_INT:
+			i32 = *(int *)(void *)((char *)c + f->offset);
+			memcpy(p, &i32, sizeof(i32));
+			break;
+		case FIELD_DOUBLE:
+			memcpy(p, (char *)c + f->offset, sizeof(double));
+			break;
+		}
+		p += field_size(f);
+	}
+
+	memcpy(p, &c->generation, sizeof(c->generation));
+	p += sizeof(c->generation);
+
+	crc = snapshot_crc32(0, rec, p - rec);
+	memcpy(p, &crc, sizeof(crc));
+}
+
+static int
+record_valid(const unsigned char *rec)
+{
+	uint32_t crc;
+
+	memcpy(&crc, rec + record_size - sizeof(crc), sizeof(crc));
+
+	return crc == snapshot_crc32(0, rec, record_size - sizeof(crc));
+}
+
+static int32_t
+record_id(const unsigned char *rec)
+{
+	int32_t id;
+
+	memcpy(&id, rec + id_offset, sizeof(id));
+
+	return id;
+}
+
+/* Copy a record into c, which must provide a MAX_CHAR_LEN name buffer */
+static void
+unpack_record(const unsigned char *rec, struct character *c)
+{
+	const struct char_field *f;
+	const unsigned char *p = rec;
+	int32_t i32;
+	char *name;
+
+	for (f = char_fields; f < char_fields + n_char_fields; f++) {
+		switch (f->type) {
+		case FIELD_STRING:
+			memcpy(&name, (char *)c + f->offset, sizeof(name));
+			memcpy(name, p, MAX_CHAR_LEN);
+			name[MAX_CHAR_LEN - 1] = '\0';
+			break;
+		case FIELD_INT:
+			memcpy(&i32, p, sizeof(i32));
+			*(int *)(void *)((char *)c + f->offset) = i32;
+			break;
+		case FIELD_DOUBLE:
+			memcpy((char *)c + f->offset, p, sizeof(double));
+			break;
+		}
+		p += field_size(f);
+	}
+
+	memcpy(&c->generation, p, sizeof(c->generation));
+}
+
+static void
+init_header(struct snapshot_header *h)
+{
+	init_layout();
+
+	memset(h, 0, sizeof(*h));
+	memcpy(h->magic, SNAPSHOT_MAGIC, sizeof(h->magic));
+	h->version = SNAPSHOT_VERSION;
+	h->byteorder = SNAPSHOT_BYTEORDER;
+	h->record_size = record_size;
+	h->n_fields = n_char_fields;
+	h->schema_crc = schema_crc;
+	h->last_used = -1;
+}
+
+static int
+header_valid(const struct snapshot_header *h, size_t len)
+{
+	init_layout();
+
+	if (memcmp(h->magic, SNAPSHOT_MAGIC, sizeof(h->magic)) != 0) {
+		printf("characters.bin is not a character snapshot\n");
+		return 0;
+	}
+	if (h->crc != snapshot_crc32(0, h, offsetof(struct snapshot_header, crc))) {
+		printf("characters.bin has a corrupt header\n");
+		return 0;
+	}
+	if (h->version != SNAPSHOT_VERSION || h->byteorder != SNAPSHOT_BYTEORDER ||
+	    h->record_size != record_size || h->n_fields != n_char_fields ||
+	    h->schema_crc != schema_crc) {
+		printf("characters.bin was written by an incompatible version\n");
+		return 0;
+	}
+	if (len < sizeof(*h) + (size_t)h->n_records * record_size) {
+		printf("characters.bin is truncated\n");
+		return 0;
+	}
+
+	return 1;
+}
+
+/*
+ * Map characters.bin read-only, or read it into memory if mmap is not
+ * available.  Returns -1 if the file does not exist or is invalid.
+ */
+static int
+map_snapshot(struct snapshot_map *m)
+{
+	char path[_POSIX_PATH_MAX];
+	struct stat sb;
+	ssize_t n;
+	size_t off;
+	int fd;
+
+	memset(m, 0, sizeof(*m));
+	snapshot_path(path, sizeof(path), "characters.bin");
+
+	if ((fd = open(path, O_RDONLY)) == -1) {
+		log_debug("Cannot open %s: %s\n", path, strerror(errno));
+		return -1;
+	}
+	if (fstat(fd, &sb) == -1 || (size_t)sb.st_size < sizeof(m->h)) {
+		printf("characters.bin is truncated\n");
+		close(fd);
+		return -1;
+	}
+	m->len = sb.st_size;
+
+	m->base = mmap(NULL, m->len, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (m->base != MAP_FAILED) {
+		m->mapped = 1;
+	} else {
+		log_debug("mmap %s failed, reading it instead\n", path);
+		if ((m->base = malloc(m->len)) == NULL)
+			log_errx(1, "malloc\n");
+		for (off = 0; off < m->len; off += n) {
+			if ((n = pread(fd, m->base + off, m->len - off, off)) <= 0) {
+				printf("Cannot read %s\n", path);
+				free(m->base);
+				close(fd);
+				return -1;
+			}
+		}
+	}
+	close(fd);
+
+	memcpy(&m->h, m->base, sizeof(m->h));
+	if (!header_valid(&m->h, m->len)) {
+		if (m->mapped)
+			munmap(m->base, m->len);
+		else
+			free(m->base);
+		return -1;
+	}
+
+	return 0;
+}
+
+static void
+unmap_snapshot(struct snapshot_map *m)
+{
+	if (m->mapped)
+		munmap(m->base, m->len);
+	else
+		free(m->base);
+	m->base = NULL;
+}
+
+static const unsigned char *
+snapshot_record(const struct snapshot_map *m, uint32_t i)
+{
+	return m->base + sizeof(m->h) + (size_t)i * record_size;
+}
+
+/* Index of the record for id, or n_records if there is none */
+static uint32_t
+find_record(const struct snapshot_map *m, int id)
+{
+	uint32_t i;
+
+	for (i = 0; i < m->h.n_records; i++) {
+		if (record_id(snapshot_record(m, i)) == id)
+			break;
+	}
+
+	return i;
+}
+
+int
+set_character_format(const char *format)
+{
+	if (strcmp(format, "json") == 0)
+		snapshot = 0;
+	else if (strcmp(format, "binary") == 0)
+		snapshot = 1;
+	else
+		return -1;
+
+	return 0;
+}
+
+int
+use_snapshot(void)
+{
+	return snapshot;
+}
+
+int
+snapshot_load_character(int id, struct character *c)
+{
+	struct snapshot_map m;
+	const unsigned char *rec;
+	uint32_t i;
+	TRACE_FUNC("load");
+	CAMPAIGN_LOCK();
+
+	if (map_snapshot(&m) == -1)
+		return -1;
+
+	if ((i = find_record(&m, id)) == m.h.n_records) {
+		log_debug("No character with id %d in characters.bin\n", id);
+		unmap_snapshot(&m);
+		return -1;
+	}
+
+	rec = snapshot_record(&m, i);
+	if (!record_valid(rec)) {
+		printf("The record of character %d in characters.bin is corrupt\n", id);
+		unmap_snapshot(&m);
+		return -1;
+	}
+
+	unpack_record(rec, c);
+	log_debug("Loading character %s, id: %d\n", c->name, c->id);
+
+	unmap_snapshot(&m);
+
+	return 0;
+}
+
+int
+snapshot_load_list(void (*add)(int, const char *), int *last_used)
+{
+	struct snapshot_map m;
+	const unsigned char *rec;
+	char name[MAX_CHAR_LEN];
+	struct character c;
+	uint32_t i;
+	TRACE_FUNC("load");
+	CAMPAIGN_LOCK();
+
+	if (map_snapshot(&m) == -1)
+		return -1;
+
+	*last_used = m.h.last_used;
+
+	memset(&c, 0, sizeof(c));
+	c.name = name;
+	for (i = 0; i < m.h.n_records; i++) {
+		rec = snapshot_record(&m, i);
+		if (!record_valid(rec)) {
+			printf("Skipping corrupt character record %u in "
+			    "characters.bin\n", i);
+			continue;
+		}
+		unpack_record(rec, &c);
+		add(c.id, c.name);
+		roster_set_generation(c.id, c.generation);
+	}
+
+	unmap_snapshot(&m);
+
+	return 0;
+}
+
+/*
+ * Returns 1 if characters.bin holds c exactly as it is, generation included,
+ * and c is the last used character.
+ */
+int
+snapshot_character_saved(struct character *c)
+{
+	struct snapshot_map m;
+	unsigned char *rec;
+	uint32_t i;
+	int ret = 0;
+	CAMPAIGN_LOCK();
+
+	if (map_snapshot(&m) == -1)
+		return 0;
+
+	if (m.h.last_used == c->id &&
+	    (i = find_record(&m, c->id)) != m.h.n_records) {
+		if ((rec = malloc(record_size)) == NULL)
+			log_errx(1, "malloc\n");
+		pack_record(rec, c);
+		ret = memcmp(rec, snapshot_record(&m, i), record_size) == 0;
+		free(rec);
+	}
+
+	unmap_snapshot(&m);
+
+	return ret;
+}
+
+/*
+ * Read characters.bin into memory to change it, with room for one more
+ * record.  Without a snapshot yet, an empty one is made up.
+ */
+static int
+read_snapshot(struct snapshot_map *m)
+{
+	char path[_POSIX_PATH_MAX];
+	struct snapshot_map old;
+	struct stat sb;
+
+	memset(m, 0, sizeof(*m));
+	memset(&old, 0, sizeof(old));
+	snapshot_path(path, sizeof(path), "characters.bin");
+
+	if (stat(path, &sb) == -1) {
+		if (errno != ENOENT) {
+			printf("Cannot stat %s: %s\n", path, strerror(errno));
+			return -1;
+		}
+		sb.st_size = 0;
+	}
+
+	if (sb.st_size == 0) {
+		init_header(&m->h);
+		m->len = sizeof(m->h);
+	} else {
+		if (map_snapshot(&old) == -1)
+			return -1;
+		m->h = old.h;
+		m->len = sizeof(m->h) + (size_t)m->h.n_records * record_size;
+	}
+
+	if ((m->base = malloc(m->len + record_size)) == NULL)
+		log_errx(1, "malloc\n");
+	if (old.base != NULL) {
+		memcpy(m->base, old.base, m->len);
+		unmap_snapshot(&old);
+	}
+
+	return 0;
+}
+
+/* Write a temporary file and move it over the old snapshot */
+static int
+write_snapshot(struct snapshot_map *m)
+{
+	char path[_POSIX_PATH_MAX], tmp[_POSIX_PATH_MAX];
+	int fd;
+
+	m->h.crc = snapshot_crc32(0, &m->h, offsetof(struct snapshot_header, crc));
+	memcpy(m->base, &m->h, sizeof(m->h));
+
+	snapshot_path(path, sizeof(path), "characters.bin");
+	snapshot_path(tmp, sizeof(tmp), "characters.bin.tmp");
+	if ((fd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC, 0644)) == -1) {
+		printf("Cannot create %s: %s\n", tmp, strerror(errno));
+		return -1;
+	}
+	if (write(fd, m->base, m->len) != (ssize_t)m->len || close(fd) == -1) {
+		printf("Cannot write %s\n", tmp);
+		unlink(tmp);
+		return -1;
+	}
+	if (rename(tmp, path) == -1) {
+		printf("Cannot rename %s: %s\n", tmp, strerror(errno));
+		unlink(tmp);
+		return -1;
+	}
+
+	note_campaign_write();
+
+	return 0;
+}
+
+/* Replace the record of c, or append it for a new character */
+int
+snapshot_save_character(struct character *c)
+{
+	struct snapshot_map m;
+	uint32_t i;
+	int ret;
+	TRACE_FUNC("save");
+	CAMPAIGN_LOCK();
+
+	if (read_snapshot(&m) == -1)
+		return -1;
+
+	if ((i = find_record(&m, c->id)) == m.h.n_records) {
+		log_debug("No entry for %s found, adding new one\n", c->name);
+		m.h.n_records++;
+		m.len += record_size;
+	}
+	pack_record(m.base + sizeof(m.h) + (size_t)i * record_size, c);
+	m.h.last_used = c->id;
+
+	if ((ret = write_snapshot(&m)) == 0)
+		log_debug("Saved character %s as record %u\n", c->name, i);
+
+	unmap_snapshot(&m);
+
+	return ret;
+}
+
+void
+snapshot_set_last_used(int id)
+{
+	struct snapshot_map m;
+	CAMPAIGN_LOCK();
+
+	if (read_snapshot(&m) == -1)
+		return;
+
+	m.h.last_used = id;
+	if (write_snapshot(&m) == -1)
+		printf("Error saving characters.bin\n");
+
+	unmap_snapshot(&m);
+}
+
+/* Remove the record of id by moving the last record into its place */
+void
+snapshot_delete_character(int id)
+{
+	struct snapshot_map m;
+	uint32_t i, last;
+	CAMPAIGN_LOCK();
+
+	if (read_snapshot(&m) == -1)
+		return;
+
+	if ((i = find_record(&m, id)) == m.h.n_records) {
+		log_debug("No character with id %d in characters.bin\n", id);
+		unmap_snapshot(&m);
+		return;
+	}
+
+	last = m.h.n_records - 1;
+	if (i != last)
+		memcpy(m.base + sizeof(m.h) + (size_t)i * record_size,
+		    snapshot_record(&m, last), record_size);
+	m.h.n_records--;
+	m.len -= record_size;
+
+	if (write_snapshot(&m) == -1)
+		printf("Error saving characters.bin\n");
+	else
+		log_debug("Deleted character entry for %d\n", id);
+
+	unmap_snapshot(&m);
+}
+
+/*
+ * Returns 1 if characters.bin holds a character that is missing from the
+ * characters of characters.json or was saved there in an older generation.
+ */
+static int
+snapshot_newer(json_object *characters)
+{
+	char name[MAX_CHAR_LEN];
+	struct snapshot_map m;
+	struct character c;
+	json_object *temp, *id, *gen;
+	const unsigned char *rec;
+	uint64_t generation;
+	size_t n, j;
+	uint32_t i;
+	int newer = 0;
+
+	if (map_snapshot(&m) == -1)
+		return 0;
+
+	n = json_object_array_length(characters);
+	memset(&c, 0, sizeof(c));
+	c.name = name;
+	for (i = 0; i < m.h.n_records; i++) {
+		rec = snapshot_record(&m, i);
+		if (!record_valid(rec))
+			continue;
+		unpack_record(rec, &c);
+
+		generation = 0;
+		for (j = 0; j < n; j++) {
+			temp = json_object_array_get_idx(characters, j);
+			if (json_object_object_get_ex(temp, "id", &id) &&
+			    json_object_get_int(id) == c.id)
+				break;
+		}
+		if (j < n && json_object_object_get_ex(temp, "generation", &gen))
+			generation = (uint64_t)json_object_get_int64(gen);
+
+		if (j == n || generation < c.generation) {
+			printf("characters.bin holds a newer state of %s\n",
+			    c.name);
+			newer = 1;
+		}
+	}
+
+	unmap_snapshot(&m);
+
+	return newer;
+}
+
+/*
+ * Rebuild characters.bin from characters.json.  Unless force is set, this is
+ * refused if it would replace a newer state of a character.
+ */
+int
+snapshot_import(int force)
+{
+	char path[_POSIX_PATH_MAX], name[MAX_CHAR_LEN];
+	struct snapshot_map m;
+	struct character c;
+	json_object *root, *characters, *last_used;
+	size_t n, i;
+	int ret = -1;
+	TRACE_FUNC("save");
+	CAMPAIGN_LOCK();
+
+	snapshot_path(path, sizeof(path), "characters.json");
+	if ((root = read_json_file(path)) == NULL) {
+		printf("Cannot read %s\n", path);
+		return -1;
+	}
+	if (!json_object_object_get_ex(root, "characters", &characters)) {
+		printf("Cannot find a [characters] array in %s\n", path);
+		json_object_put(root);
+		return -1;
+	}
+
+	if (!force && snapshot_newer(characters)) {
+		printf("Use 'snapshot import force' to replace it anyway\n");
+		json_object_put(root);
+		return -1;
+	}
+
+	memset(&m, 0, sizeof(m));
+	init_header(&m.h);
+	n = json_object_array_length(characters);
+	if (json_object_object_get_ex(root, "last_used", &last_used))
+		m.h.last_used = json_object_get_int(last_used);
+	m.h.n_records = n;
+
+	m.len = sizeof(m.h) + n * record_size;
+	if ((m.base = malloc(m.len)) == NULL)
+		log_errx(1, "malloc\n");
+
+	memset(&c, 0, sizeof(c));
+	c.name = name;
+	for (i = 0; i < n; i++) {
+		name[0] = '\0';
+		character_from_json(&c, json_object_array_get_idx(characters, i));
+		pack_record(m.base + sizeof(m.h) + i * record_size, &c);
+	}
+	json_object_put(root);
+
+	if (write_snapshot(&m) == 0) {
+		log_debug("Imported %zu characters into characters.bin\n", n);
+		ret = 0;
+	}
+
+	unmap_snapshot(&m);
+
+	return ret;
+}
+
+/* Write characters.json from characters.bin */
+int
+snapshot_export(void)
+{
+	char path[_POSIX_PATH_MAX], name[MAX_CHAR_LEN];
+	struct snapshot_map m;
+	struct character c;
+	json_object *root, *items, *cobj;
+	const unsigned char *rec;
+	uint32_t i;
+	int ret = 0;
+	TRACE_FUNC("save");
+	CAMPAIGN_LOCK();
+
+	if (map_snapshot(&m) == -1)
+		return -1;
+
+	if ((root = json_object_new_object()) == NULL)
+		log_errx(1, "Cannot create JSON object\n");
+	items = json_object_new_array();
+	json_object_object_add(root, "characters", items);
+	json_object_object_add(root, "last_used", json_object_new_int(m.h.last_used));
+
+	memset(&c, 0, sizeof(c));
+	c.name = name;
+	for (i = 0; i < m.h.n_records; i++) {
+		rec = snapshot_record(&m, i);
+		if (!record_valid(rec)) {
+			printf("Skipping corrupt character record %u in "
+			    "characters.bin\n", i);
+			continue;
+		}
+		unpack_record(rec, &c);
+		cobj = character_to_json(&c);
+		json_object_object_add(cobj, "generation",
+		    json_object_new_int64((int64_t)c.generation));
+		json_object_array_add(items, cobj);
+	}
+	unmap_snapshot(&m);
+
+	snapshot_path(path, sizeof(path), "characters.json");
+	if (write_json_file(path, root)) {
+		printf("Error saving %s\n", path);
+		ret = -1;
+	}
+
+	json_object_put(root);
+
+	return ret;
+}
+
+static int
+snapshot_readable(void)
+{
+	struct snapshot_map m;
+
+	if (map_snapshot(&m) == -1)
+		return 0;
+	unmap_snapshot(&m);
+
+	return 1;
+}
+
+static int
+newer(const struct stat *a, const struct stat *b)
+{
+	if (a->st_mtim.tv_sec != b->st_mtim.tv_sec)
+		return a->st_mtim.tv_sec > b->st_mtim.tv_sec;
+
+	return a->st_mtim.tv_nsec > b->st_mtim.tv_nsec;
+}
+
+/*
+ * Convert the other store if it was written more recently than the one of
+ * the configured format, e.g. after switching formats between two runs.
+ */
+void
+sync_character_store(void)
+{
+	char jpath[_POSIX_PATH_MAX], bpath[_POSIX_PATH_MAX];
+	struct stat jsb, bsb;
+	int json, bin;
+	CAMPAIGN_LOCK();
+
+	snapshot_path(jpath, sizeof(jpath), "characters.json");
+	snapshot_path(bpath, sizeof(bpath), "characters.bin");
+	json = stat(jpath, &jsb) == 0;
+	bin = stat(bpath, &bsb) == 0;
+
+	/* A snapshot that cannot be read is rebuilt from characters.json */
+	if (snapshot && json && bin && !newer(&jsb, &bsb) && !snapshot_readable())
+		bin = 0;
+
+	/* The newer file wins, no matter the generations */
+	if (snapshot && json && (!bin || newer(&jsb, &bsb))) {
+		if (snapshot_import(1) == 0)
+			printf("Converted characters.json to characters.bin\n");
+	} else if (!snapshot && bin && (!json || newer(&bsb, &jsb))) {
+		if (snapshot_export() == 0)
+			printf("Converted characters.bin to characters.json\n");
+	}
+}
+
+void
+cmd_snapshot(char *cmd)
+{
+	struct snapshot_map m;
+	struct character *c = get_current_character();
+
+	if (cmd == NULL || strlen(cmd) == 0 || strcmp(cmd, "info") == 0) {
+		printf("Characters are stored in %s\n",
+		    snapshot ? "characters.bin" : "characters.json");
+		if (map_snapshot(&m) == 0) {
+			printf("characters.bin: version %u, %u characters, "
+			    "%u bytes per record, %s\n", m.h.version,
+			    m.h.n_records, m.h.record_size,
+			    m.mapped ? "mapped" : "read");
+			unmap_snapshot(&m);
+		}
+	} else if (strcmp(cmd, "export") == 0) {
+		if (!snapshot) {
+			printf("Characters are already stored in characters.json\n");
+			return;
+		}
+		if (c != NULL)
+			save_character();
+		if (snapshot_export() == 0)
+			printf("Exported characters.bin to characters.json\n");
+	} else if (strcmp(cmd, "import") == 0 ||
+	    strcmp(cmd, "import force") == 0) {
+		if (snapshot_import(strcmp(cmd, "import force") == 0) == 0)
+			printf("Imported characters.json into characters.bin\n");
+	} else {
+		printf("Usage: snapshot [info|export|import [force]]\n");
+	}
+}
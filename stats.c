@@ -0,0 +1,262 @@
+/*
+ * Copyright (c) 2026 Matthias Schmidt <xhr@giessen.ccc.de>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <sys/stat.h>
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <json-c/json.h>
+
+#include "isscrolls.h"
+
+/* Latency buckets are powers of two in microseconds, the last one is open */
+#define STATS_BUCKETS 20
+
+struct command_stats {
+	const char *name;
+	uint64_t calls;
+	uint64_t total_ns;
+	uint64_t max_ns;
+	uint64_t hist[STATS_BUCKETS];
+};
+
+struct file_stats {
+	char *name;
+	uint64_t opens;
+	uint64_t read_bytes;
+	uint64_t parse_ns;
+	uint64_t writes;
+	uint64_t written_bytes;
+	uint64_t write_ns;
+};
+
+static struct command_stats *cmd_stats = NULL;
+static size_t n_cmd_stats = 0;
+
+/* Files are also read by the oracle watcher thread */
+static pthread_mutex_t file_stats_lock = PTHREAD_MUTEX_INITIALIZER;
+static struct file_stats *file_stats = NULL;
+static size_t n_file_stats = 0;
+
+static uint64_t rng_draws = 0;
+
+static struct file_stats *get_file_stats(const char *);
+static int bucket_of(uint64_t);
+
+uint64_t
+stats_now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+/*
+ * Drop-in replacement for json_object_from_file() that counts the file
+ * opens, the bytes read and the time spent parsing.
+ */
+json_object *
+read_json_file(const char *path)
+{
+	struct file_stats *fs;
+	struct stat sb;
+	json_object *root;
+	uint64_t start;
+	TRACE_SPAN("read_json_file", "file", path);
+
+	start = stats_now();
+	root = json_object_from_file(path);
+
+	pthread_mutex_lock(&file_stats_lock);
+	fs = get_file_stats(path);
+	fs->opens++;
+	fs->parse_ns += stats_now() - start;
+	if (root != NULL && stat(path, &sb) == 0)
+		fs->read_bytes += sb.st_size;
+	pthread_mutex_unlock(&file_stats_lock);
+
+	return root;
+}
+
+/*
+ * Drop-in replacement for json_object_to_file() that counts the writes and
+ * the bytes written.
+ */
+int
+write_json_file(const char *path, json_object *obj)
+{
+	struct file_stats *fs;
+	struct stat sb;
+	uint64_t start;
+	int ret;
+	TRACE_SPAN("write_json_file", "file", path);
+
+	start = stats_now();
+	ret = json_object_to_file(path, obj);
+	if (ret == 0)
+		note_campaign_write();
+
+	pthread_mutex_lock(&file_stats_lock);
+	fs = get_file_stats(path);
+	fs->writes++;
+	fs->write_ns += stats_now() - start;
+	if (ret == 0 && stat(path, &sb) == 0)
+		fs->written_bytes += sb.st_size;
+	pthread_mutex_unlock(&file_stats_lock);
+
+	return ret;
+}
+
+void
+stats_command(const char *name, uint64_t ns)
+{
+	struct command_stats *cs;
+	size_t i;
+
+	/* Command names point into the static command table */
+	for (i = 0; i < n_cmd_stats; i++) {
+		if (cmd_stats[i].name == name)
+			break;
+	}
+
+	if (i == n_cmd_stats) {
+		cs = reallocarray(cmd_stats, n_cmd_stats + 1, sizeof(*cs));
+		if (cs == NULL)
+			log_errx(1, "reallocarray command stats\n");
+		cmd_stats = cs;
+		memset(&cmd_stats[n_cmd_stats], 0, sizeof(*cs));
+		cmd_stats[n_cmd_stats++].name = name;
+	}
+
+	cs = &cmd_stats[i];
+	cs->calls++;
+	cs->total_ns += ns;
+	if (ns > cs->max_ns)
+		cs->max_ns = ns;
+	cs->hist[bucket_of(ns)]++;
+}
+
+void
+stats_rng_draw(void)
+{
+	__atomic_add_fetch(&rng_draws, 1, __ATOMIC_RELAXED);
+}
+
+void
+cmd_show_stats(__attribute__((unused)) char *unused)
+{
+	print_stats();
+}
+
+void
+print_stats(void)
+{
+	struct command_stats *cs;
+	struct file_stats *fs;
+	uint64_t lo;
+	size_t i;
+	int b;
+
+	printf("%-22s %8s %12s %10s %10s\n", "Command", "Calls", "Total ms",
+	    "Avg us", "Max us");
+	for (i = 0; i < n_cmd_stats; i++) {
+		cs = &cmd_stats[i];
+		printf("%-22s %8llu %12.3f %10.1f %10.1f\n", cs->name,
+		    (unsigned long long)cs->calls, cs->total_ns / 1e6,
+		    cs->total_ns / 1e3 / cs->calls, cs->max_ns / 1e3);
+
+		printf("%-22s", "");
+		for (b = 0, lo = 0; b < STATS_BUCKETS; b++) {
+			if (cs->hist[b] != 0) {
+				if (b == STATS_BUCKETS - 1)
+					printf(" >=%lluus:%llu", (unsigned long long)lo,
+					    (unsigned long long)cs->hist[b]);
+				else
+					printf(" <%dus:%llu", 1 << b,
+					    (unsigned long long)cs->hist[b]);
+			}
+			lo = 1 << b;
+		}
+		printf("\n");
+	}
+
+	printf("\n%-36s %6s %10s %10s %6s %10s %10s\n", "File", "Opens",
+	    "Bytes", "Parse ms", "Writes", "Bytes", "Write ms");
+	pthread_mutex_lock(&file_stats_lock);
+	for (i = 0; i < n_file_stats; i++) {
+		fs = &file_stats[i];
+		printf("%-36s %6llu %10llu %10.3f %6llu %10llu %10.3f\n", fs->name,
+		    (unsigned long long)fs->opens, (unsigned long long)fs->read_bytes,
+		    fs->parse_ns / 1e6, (unsigned long long)fs->writes,
+		    (unsigned long long)fs->written_bytes, fs->write_ns / 1e6);
+	}
+	pthread_mutex_unlock(&file_stats_lock);
+
+	printf("\nRNG draws: %llu\n",
+	    (unsigned long long)__atomic_load_n(&rng_draws, __ATOMIC_RELAXED));
+}
+
+/*
+ * Files are accounted by their base name, e.g. vows.json.  Must be called
+ * with file_stats_lock held.
+ */
+static struct file_stats *
+get_file_stats(const char *path)
+{
+	struct file_stats *fs;
+	const char *name;
+	size_t i;
+
+	if ((name = strrchr(path, '/')) != NULL)
+		name++;
+	else
+		name = path;
+
+	for (i = 0; i < n_file_stats; i++) {
+		if (strcmp(file_stats[i].name, name) == 0)
+			return &file_stats[i];
+	}
+
+	fs = reallocarray(file_stats, n_file_stats + 1, sizeof(*fs));
+	if (fs == NULL)
+		log_errx(1, "reallocarray file stats\n");
+	file_stats = fs;
+	fs = &file_stats[n_file_stats++];
+	memset(fs, 0, sizeof(*fs));
+	if ((fs->name = strdup(name)) == NULL)
+		log_errx(1, "strdup\n");
+
+	return fs;
+}
+
+static int
+bucket_of(uint64_t ns)
+{
+	uint64_t us = ns / 1000;
+	int b = 0;
+
+	while (b < STATS_BUCKETS - 1 && us >= ((uint64_t)1 << b))
+		b++;
+
+	return b;
+}
@@ -50,6 +50,7 @@ cmd_sacrifice_resources(char *cmd)
 		pm(DEFAULT, "Your supply is exhausted, mark unprepared\n");
 		cmd_toggle("unprepared");
 	}
+	mark_dirty();
 }
 
 void
@@ -360,6 +361,7 @@ info:
 	if (curchar->expedition_active == 0) {
 		ask_for_expedition_difficulty();
 		curchar->expedition_active = 1;
+		mark_dirty();
 	}
 
 	if (strcasecmp(stat, "wits") == 0) {
@@ -419,6 +421,7 @@ cmd_finish_an_expedition(char *cmd)
 	curchar->expedition->progress = 0;
 	delete_expedition(curchar->id);
 
+	mark_dirty();
 	update_prompt();
 }
 
@@ -426,7 +429,6 @@ void
 mark_expedition_progress(int what)
 {
 	struct character *curchar = get_current_character();
-	double amount = 0;
 
 	CURCHAR_CHECK();
 
@@ -435,38 +437,11 @@ mark_expedition_progress(int what)
 		return;
 	}
 
-	switch (curchar->expedition->difficulty) {
-	case 1:
-		amount = 3;
-		break;
-	case 2:
-		amount = 2;
-		break;
-	case 3:
-		amount = 1;
-		break;
-	case 4:
-		amount = 0.5;
-		break;
-	case 5:
-		amount = 0.25;
-		break;
-	default:
-		curchar->expedition->difficulty = 1;
-		log_errx(1, "Unknown difficulty.  This should not happen.  Set it to 1\n");
-	}
-
-	if (what == INCREASE)
-		curchar->expedition->progress += amount;
-	else
-		curchar->expedition->progress -= amount;
-
-	if (curchar->expedition->progress > 10) {
+	if (mark_progress(&curchar->expedition->progress,
+	    &curchar->expedition->difficulty, what))
 		pm(DEFAULT, "Your reached all waypoints of your expedition.  Consider finishing it\n");
-		curchar->expedition->progress = 10;
-	} else if (curchar->expedition->progress < 0)
-		curchar->expedition->progress = 0;
 
+	mark_dirty();
 	update_prompt();
 }
 
@@ -478,6 +453,8 @@ save_expedition(void)
 	json_object *root, *items, *id;
 	size_t temp_n, i;
 	int ret;
+	TRACE_FUNC("save");
+	CAMPAIGN_LOCK();
 
 	if (curchar == NULL) {
 		log_debug("No character loaded.  No expedition to save.\n");
@@ -501,7 +478,7 @@ save_expedition(void)
 		log_errx(1, "Path truncation happened.  Buffer too short to fit %s\n", path);
 	}
 
-	if ((root = json_object_from_file(path)) == NULL) {
+	if ((root = read_json_file(path)) == NULL) {
 		log_debug("No expedition JSON file found\n");
 		root = json_object_new_object();
 		if (!root)
@@ -534,7 +511,7 @@ save_expedition(void)
 	}
 
 out:
-	if (json_object_to_file(path, root))
+	if (write_json_file(path, root))
 		printf("Error saving %s\n", path);
 	else
 		log_debug("Successfully saved %s\n", path);
@@ -549,13 +526,14 @@ delete_expedition(int id)
 	json_object *root, *lid;
 	size_t temp_n, i;
 	int ret;
+	CAMPAIGN_LOCK();
 
 	ret = snprintf(path, sizeof(path), "%s/expedition.json", get_isscrolls_dir());
 	if (ret < 0 || (size_t)ret >= sizeof(path)) {
 		log_errx(1, "Path truncation happened.  Buffer too short to fit %s\n", path);
 	}
 
-	if ((root = json_object_from_file(path)) == NULL) {
+	if ((root = read_json_file(path)) == NULL) {
 		log_debug("No expedition JSON file found\n");
 		return;
 	}
@@ -576,7 +554,7 @@ delete_expedition(int id)
 		}
 	}
 
-	if (json_object_to_file(path, root))
+	if (write_json_file(path, root))
 		printf("Error saving %s\n", path);
 	else
 		log_debug("Successfully saved %s\n", path);
@@ -592,6 +570,8 @@ load_expedition(int id)
 	json_object *root, *lid;
 	size_t temp_n, i;
 	int ret;
+	TRACE_FUNC("load");
+	CAMPAIGN_LOCK();
 
 	if (curchar == NULL) {
 		log_debug("No character loaded\n");
@@ -603,7 +583,7 @@ load_expedition(int id)
 		log_errx(1, "Path truncation happened.  Buffer too short to fit %s\n", path);
 	}
 
-	if ((root = json_object_from_file(path)) == NULL) {
+	if ((root = read_json_file(path)) == NULL) {
 		log_debug("No expedition JSON file found\n");
 		return;
 	}
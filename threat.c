@@ -0,0 +1,578 @@
+/*
+ * Copyright (c) 2026 Matthias Schmidt <xhr@giessen.ccc.de>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <json-c/json.h>
+#include <readline/readline.h>
+#include <readline/history.h>
+
+#include "isscrolls.h"
+
+#define THREAT_JSON "ironsworn_oracles_threat.json"
+
+/*
+ * All threats of the loaded character are kept in memory.  A threat with the
+ * tid n lives in slot n - 1, so looking up a threat is a plain array access.
+ * Marking menace only touches memory, the store is written back in one go
+ * when the character is saved.
+ */
+static struct threat *threats = NULL;
+static size_t threat_slots = 0;
+static int threats_dirty = 0;
+
+struct threat_state {
+	struct threat *threats;
+	size_t slots;
+	int dirty;
+};
+
+static struct threat *get_threat(int);
+static struct threat *new_threat_slot(void);
+static int select_threat(char *);
+static void ask_for_threat_difficulty(struct threat *);
+static void free_threat(struct threat *);
+static char *load_threat_text(json_object *, const char *, size_t);
+
+void
+cmd_create_threat(char *name)
+{
+	struct character *curchar = get_current_character();
+	struct threat *t;
+	char category[MAX_THREAT_GOAL + 1];
+
+	CURCHAR_CHECK();
+
+	if ((t = new_threat_slot()) == NULL) {
+		printf("You cannot have more than %d threats\n", MAX_THREATS);
+		return;
+	}
+
+	if (name != NULL && strlen(name) > 0) {
+		if ((t->name = calloc(1, MAX_THREAT_NAME+1)) == NULL)
+			log_errx(1, "calloc threat name\n");
+		snprintf(t->name, MAX_THREAT_NAME + 1, "%s", name);
+	} else {
+again:
+		printf("Enter a name for the threat [max 25 chars]: ");
+		t->name = readline(NULL);
+		if (t->name == NULL) {
+			free_threat(t);
+			return;
+		} else if (strlen(t->name) == 0) {
+			printf("The name must contain at least one character\n");
+			free(t->name);
+			goto again;
+		}
+		if (strlen(t->name) > MAX_THREAT_NAME)
+			t->name[MAX_THREAT_NAME] = '\0';
+	}
+
+	/* A '[Roll twice]' result on the category table is rolled again */
+	do {
+		if (roll_on_oracle_table(THREAT_JSON, "Threat Category", category,
+			sizeof(category)) == -1) {
+			printf("Cannot roll on the threat category table\n");
+			free_threat(t);
+			return;
+		}
+	} while (category[0] == '[');
+
+	if ((t->category = strdup(category)) == NULL)
+		log_errx(1, "strdup threat category\n");
+
+goalagain:
+	printf("Enter the goal of the threat [max 255 chars]: ");
+	t->goal = readline(NULL);
+	if (t->goal == NULL) {
+		free_threat(t);
+		return;
+	} else if (strlen(t->goal) == 0) {
+		printf("The goal must contain at least one character\n");
+		free(t->goal);
+		goto goalagain;
+	}
+	if (strlen(t->goal) > MAX_THREAT_GOAL)
+		t->goal[MAX_THREAT_GOAL] = '\0';
+
+	t->id = curchar->id;
+	t->menace = 0.0;
+
+	/* A threat sworn against while a vow is active is linked to it */
+	if (curchar->vow_active) {
+		t->vid = curchar->vid;
+		t->difficulty = curchar->vow->difficulty;
+	} else {
+		t->vid = -1;
+		ask_for_threat_difficulty(t);
+	}
+
+	threats_dirty = 1;
+	mark_dirty();
+
+	pm(DEFAULT, "%s is a %s threat\n", t->name, t->category);
+	if (t->vid != -1)
+		pm(DEFAULT, "The threat is linked to your vow '%s'\n", curchar->vow->title);
+}
+
+void
+cmd_show_threats(__attribute__((unused)) char *unused)
+{
+	struct character *curchar = get_current_character();
+	size_t i;
+
+	CURCHAR_CHECK();
+
+	printf("%s's threats\n\n", curchar->name);
+	printf("%3s %-25s %-25s Menace   Vow\n", "ID", "Name", "Category");
+	for (i = 0; i < threat_slots; i++) {
+		if (threats[i].tid == 0)
+			continue;
+
+		printf("%3d %-25s %-25s %5.2f/10 ", threats[i].tid, threats[i].name,
+			threats[i].category, threats[i].menace);
+		if (threats[i].vid == -1)
+			printf("-\n");
+		else
+			printf("%d\n", threats[i].vid);
+		printf("    Goal: %s\n", threats[i].goal);
+	}
+}
+
+void
+cmd_advance_threat(char *cmd)
+{
+	struct character *curchar = get_current_character();
+	struct threat *t;
+	char action[MAX_THREAT_GOAL + 1];
+	int tid;
+
+	CURCHAR_CHECK();
+
+	if ((tid = select_threat(cmd)) == -1)
+		return;
+
+	if ((t = get_threat(tid)) == NULL) {
+		printf("Cannot find threat %d\n", tid);
+		return;
+	}
+
+	if (roll_on_oracle_table(THREAT_JSON, t->category, action,
+		sizeof(action)) != -1)
+		pm(DEFAULT, "%s moves against you: %s\n", t->name, action);
+
+	mark_threat_menace(t, INCREASE);
+}
+
+void
+cmd_link_threat(char *cmd)
+{
+	struct character *curchar = get_current_character();
+	struct threat *t;
+	int tid;
+
+	CURCHAR_CHECK();
+
+	if ((tid = select_threat(cmd)) == -1)
+		return;
+
+	if ((t = get_threat(tid)) == NULL) {
+		printf("Cannot find threat %d\n", tid);
+		return;
+	}
+
+	if (curchar->vow_active == 0) {
+		printf("No vow active.  Activate the vow you want to link first\n");
+		return;
+	}
+
+	t->vid = curchar->vid;
+	threats_dirty = 1;
+	mark_dirty();
+	pm(DEFAULT, "%s is now linked to your vow '%s'\n", t->name,
+		curchar->vow->title);
+}
+
+void
+cmd_delete_threat(char *cmd)
+{
+	struct character *curchar = get_current_character();
+	struct threat *t;
+	int tid;
+
+	CURCHAR_CHECK();
+
+	if ((tid = select_threat(cmd)) == -1)
+		return;
+
+	if ((t = get_threat(tid)) == NULL) {
+		printf("Cannot find threat %d\n", tid);
+		return;
+	}
+
+	free_threat(t);
+	threats_dirty = 1;
+	mark_dirty();
+}
+
+/*
+ * Called on every miss.  Mark menace on all threats linked to the vow vid.
+ */
+void
+advance_threats_of_vow(int vid)
+{
+	size_t i;
+
+	if (vid == -1)
+		return;
+
+	for (i = 0; i < threat_slots; i++) {
+		if (threats[i].tid != 0 && threats[i].vid == vid)
+			mark_threat_menace(&threats[i], INCREASE);
+	}
+}
+
+void
+mark_threat_menace(struct threat *t, int what)
+{
+	if (t == NULL)
+		return;
+
+	mark_progress(&t->menace, &t->difficulty, what);
+
+	if (t->menace >= 10)
+		pm(RED, "The menace of %s is full.  The threat achieves its goal -> "\
+			"Rulebook\n", t->name);
+	else if (t->menace > 0 && get_output())
+		pm(DEFAULT, "Menace of %s is now %.2f\n", t->name, t->menace);
+
+	threats_dirty = 1;
+	mark_dirty();
+}
+
+void
+save_threats(void)
+{
+	struct character *curchar = get_current_character();
+	char path[_POSIX_PATH_MAX];
+	json_object *root, *items, *keep, *id;
+	size_t temp_n, i;
+	int ret;
+	TRACE_FUNC("save");
+	CAMPAIGN_LOCK();
+
+	if (curchar == NULL) {
+		log_debug("No character loaded.  No threats to save.\n");
+		return;
+	}
+
+	if (threats_dirty == 0) {
+		log_debug("Threats unchanged.  Nothing to save.\n");
+		return;
+	}
+
+	ret = snprintf(path, sizeof(path), "%s/threats.json", get_isscrolls_dir());
+	if (ret < 0 || (size_t)ret >= sizeof(path)) {
+		log_errx(1, "Path truncation happened.  Buffer too short to fit %s\n", path);
+	}
+
+	if ((root = read_json_file(path)) == NULL) {
+		log_debug("No threat JSON file found\n");
+		if ((root = json_object_new_object()) == NULL)
+			log_errx(1, "Cannot create threat JSON object\n");
+	}
+
+	/* Carry over the threats of all other characters ... */
+	keep = json_object_new_array();
+	if (json_object_object_get_ex(root, "threat", &items)) {
+		temp_n = json_object_array_length(items);
+		for (i = 0; i < temp_n; i++) {
+			json_object *temp = json_object_array_get_idx(items, i);
+			json_object_object_get_ex(temp, "id", &id);
+			if (curchar->id == json_object_get_int(id))
+				continue;
+			json_object_array_add(keep, json_object_get(temp));
+		}
+	}
+
+	/* ... and add the current character's threats from the store */
+	for (i = 0; i < threat_slots; i++) {
+		if (threats[i].tid == 0)
+			continue;
+
+		json_object *cobj = json_object_new_object();
+		json_object_object_add(cobj, "id", json_object_new_int(curchar->id));
+		json_object_object_add(cobj, "tid", json_object_new_int(threats[i].tid));
+		json_object_object_add(cobj, "vid", json_object_new_int(threats[i].vid));
+		json_object_object_add(cobj, "difficulty",
+			json_object_new_int(threats[i].difficulty));
+		json_object_object_add(cobj, "menace",
+			json_object_new_double(threats[i].menace));
+		json_object_object_add(cobj, "name",
+			json_object_new_string(threats[i].name));
+		json_object_object_add(cobj, "category",
+			json_object_new_string(threats[i].category));
+		json_object_object_add(cobj, "goal",
+			json_object_new_string(threats[i].goal));
+		json_object_array_add(keep, cobj);
+	}
+
+	json_object_object_add(root, "threat", keep);
+
+	if (write_json_file(path, root))
+		printf("Error saving %s\n", path);
+	else {
+		log_debug("Successfully saved %s\n", path);
+		threats_dirty = 0;
+	}
+
+	json_object_put(root);
+}
+
+void
+load_threats(int id)
+{
+	char path[_POSIX_PATH_MAX];
+	json_object *root, *items, *lid;
+	struct threat *t;
+	size_t temp_n, i;
+	int ret, tid;
+	TRACE_FUNC("load");
+	CAMPAIGN_LOCK();
+
+	free_threats();
+
+	ret = snprintf(path, sizeof(path), "%s/threats.json", get_isscrolls_dir());
+	if (ret < 0 || (size_t)ret >= sizeof(path)) {
+		log_errx(1, "Path truncation happened.  Buffer too short to fit %s\n", path);
+	}
+
+	if ((root = read_json_file(path)) == NULL) {
+		log_debug("No threat JSON file found\n");
+		return;
+	}
+
+	if (!json_object_object_get_ex(root, "threat", &items)) {
+		log_debug("Cannot find a [threat] array in %s\n", path);
+		json_object_put(root);
+		return;
+	}
+
+	temp_n = json_object_array_length(items);
+	for (i = 0; i < temp_n; i++) {
+		json_object *temp = json_object_array_get_idx(items, i);
+		json_object_object_get_ex(temp, "id", &lid);
+		if (id != json_object_get_int(lid))
+			continue;
+
+		tid = validate_int(temp, "tid", 1, MAX_THREATS, 0);
+		if (tid == 0 || get_threat(tid) != NULL) {
+			log_debug("Skipping threat with invalid or duplicate tid\n");
+			continue;
+		}
+
+		if ((size_t)tid > threat_slots) {
+			t = reallocarray(threats, tid, sizeof(struct threat));
+			if (t == NULL)
+				log_errx(1, "reallocarray threats\n");
+			memset(t + threat_slots, 0, (tid - threat_slots) * sizeof(*t));
+			threats = t;
+			threat_slots = tid;
+		}
+
+		t = &threats[tid - 1];
+		t->tid = tid;
+		t->id = id;
+		t->vid = validate_int(temp, "vid", -1, INT_MAX, -1);
+		t->difficulty = validate_int(temp, "difficulty", 1, 5, 1);
+		t->menace = validate_double(temp, "menace", 0.0, 10.0, 0.0);
+
+		t->name = load_threat_text(temp, "name", MAX_THREAT_NAME);
+		t->category = load_threat_text(temp, "category", MAX_THREAT_GOAL);
+		t->goal = load_threat_text(temp, "goal", MAX_THREAT_GOAL);
+
+		log_debug("Loaded threat %d for id: %d\n", tid, id);
+	}
+
+	json_object_put(root);
+}
+
+void
+free_threats(void)
+{
+	size_t i;
+
+	for (i = 0; i < threat_slots; i++)
+		free_threat(&threats[i]);
+
+	free(threats);
+	threats = NULL;
+	threat_slots = 0;
+	threats_dirty = 0;
+}
+
+/*
+ * Hand the in-memory threats of the current character over to the caller,
+ * e.g. to keep them in the character cache.  attach_threats() reinstalls
+ * them without reading the threat store again.
+ */
+void *
+detach_threats(void)
+{
+	struct threat_state *ts;
+
+	if ((ts = malloc(sizeof(*ts))) == NULL)
+		log_errx(1, "cannot allocate memory\n");
+
+	ts->threats = threats;
+	ts->slots = threat_slots;
+	ts->dirty = threats_dirty;
+
+	threats = NULL;
+	threat_slots = 0;
+	threats_dirty = 0;
+
+	return ts;
+}
+
+void
+attach_threats(void *state)
+{
+	struct threat_state *ts = state;
+
+	free_threats();
+	if (ts == NULL)
+		return;
+
+	threats = ts->threats;
+	threat_slots = ts->slots;
+	threats_dirty = ts->dirty;
+	free(ts);
+}
+
+static struct threat *
+get_threat(int tid)
+{
+	if (tid <= 0 || (size_t)tid > threat_slots)
+		return NULL;
+
+	if (threats[tid - 1].tid == 0)
+		return NULL;
+
+	return &threats[tid - 1];
+}
+
+/*
+ * Return the first free slot in the store and set its tid.  The store grows
+ * if all slots are taken.
+ */
+static struct threat *
+new_threat_slot(void)
+{
+	struct threat *t;
+	size_t i, n;
+
+	for (i = 0; i < threat_slots; i++) {
+		if (threats[i].tid == 0)
+			goto found;
+	}
+
+	if (threat_slots >= MAX_THREATS)
+		return NULL;
+
+	n = threat_slots == 0 ? 4 : threat_slots * 2;
+	if (n > MAX_THREATS)
+		n = MAX_THREATS;
+
+	if ((t = reallocarray(threats, n, sizeof(struct threat))) == NULL)
+		log_errx(1, "reallocarray threats\n");
+	memset(t + threat_slots, 0, (n - threat_slots) * sizeof(*t));
+	threats = t;
+	i = threat_slots;
+	threat_slots = n;
+
+found:
+	memset(&threats[i], 0, sizeof(struct threat));
+	threats[i].tid = i + 1;
+
+	return &threats[i];
+}
+
+static int
+select_threat(char *cmd)
+{
+	char *ep;
+	long lval;
+
+	errno = 0;
+	lval = strtol(cmd, &ep, 10);
+	if (cmd[0] == '\0' || *ep != '\0') {
+		printf("Please provide a number as argument\n");
+		return -1;
+	}
+	if ((errno == ERANGE || lval <= 0 || lval > MAX_THREATS)) {
+		printf("Please provide a number between 1 and %d\n", MAX_THREATS);
+		return -1;
+	}
+
+	return lval;
+}
+
+static void
+ask_for_threat_difficulty(struct threat *t)
+{
+	printf("Please set a rank for the threat\n\n");
+	printf("1\t - Troublesome threat (3 menace per miss)\n");
+	printf("2\t - Dangerous threat (2 menace per miss)\n");
+	printf("3\t - Formidable threat (1 menace per miss)\n");
+	printf("4\t - Extreme threat (2 ticks per miss)\n");
+	printf("5\t - Epic threat (1 tick per miss)\n\n");
+
+	t->difficulty = ask_for_value("Enter a value between 1 and 5: ", 5);
+}
+
+static void
+free_threat(struct threat *t)
+{
+	free(t->name);
+	free(t->category);
+	free(t->goal);
+	memset(t, 0, sizeof(struct threat));
+}
+
+/* Copy the text of key from obj, at most max characters, "" if missing */
+static char *
+load_threat_text(json_object *obj, const char *key, size_t max)
+{
+	json_object *val;
+	const char *text = "";
+	char *p;
+
+	if (json_object_object_get_ex(obj, key, &val) &&
+	    json_object_get_string(val) != NULL)
+		text = json_object_get_string(val);
+	else
+		log_debug("Cannot get value for %s from JSON.  Using default\n", key);
+
+	if ((p = strndup(text, max)) == NULL)
+		log_errx(1, "strndup\n");
+
+	return p;
+}
@@ -0,0 +1,166 @@
+/*
+ * Copyright (c) 2026 Matthias Schmidt <xhr@giessen.ccc.de>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "isscrolls.h"
+
+#define MAX_SPANS 65536
+#define MAX_SPAN_DETAIL 40
+
+/*
+ * A finished span.  Names and categories are string literals or command
+ * names, only the detail is copied.
+ */
+struct span {
+	const char *name;
+	const char *cat;
+	uint64_t start;
+	uint64_t dur;
+	int tid;
+	char detail[MAX_SPAN_DETAIL];
+};
+
+static char trace_path[_POSIX_PATH_MAX];
+static FILE *trace_fp = NULL;
+static struct span *spans = NULL;
+static size_t n_spans = 0;
+static size_t dropped = 0;
+static uint64_t trace_epoch = 0;
+static int tracing = 0;
+static int next_tid = 0;
+static __thread int trace_tid = 0;
+
+/*
+ * Record all spans from now on and write them to path at exit.  The buffer
+ * is allocated once here, recording a span never allocates.  The file is
+ * opened here as well, since the sandbox hides it by the time we exit.
+ */
+void
+enable_tracing(const char *path)
+{
+	int ret;
+
+	ret = snprintf(trace_path, sizeof(trace_path), "%s", path);
+	if (ret < 0 || (size_t)ret >= sizeof(trace_path)) {
+		log_errx(1, "Path truncation happened.  Buffer too short to fit %s\n", path);
+	}
+
+	if ((trace_fp = fopen(trace_path, "w")) == NULL)
+		log_errx(1, "Cannot write trace to %s: %s\n", trace_path,
+			strerror(errno));
+
+	if ((spans = calloc(MAX_SPANS, sizeof(struct span))) == NULL)
+		log_errx(1, "calloc spans\n");
+
+	trace_epoch = stats_now();
+	tracing = 1;
+}
+
+struct trace_span
+trace_begin(const char *name, const char *cat, const char *detail)
+{
+	struct trace_span s = { name, cat, detail, 0 };
+
+	if (tracing)
+		s.start = stats_now();
+
+	return s;
+}
+
+void
+trace_end(struct trace_span *s)
+{
+	struct span *sp;
+	const char *p;
+	char *q;
+	size_t i;
+
+	if (s->start == 0 || tracing == 0)
+		return;
+
+	i = __atomic_fetch_add(&n_spans, 1, __ATOMIC_RELAXED);
+	if (i >= MAX_SPANS) {
+		__atomic_fetch_add(&dropped, 1, __ATOMIC_RELAXED);
+		return;
+	}
+
+	if (trace_tid == 0)
+		trace_tid = __atomic_add_fetch(&next_tid, 1, __ATOMIC_RELAXED);
+
+	sp = &spans[i];
+	sp->name = s->name;
+	sp->cat = s->cat;
+	sp->start = s->start - trace_epoch;
+	sp->dur = stats_now() - s->start;
+	sp->tid = trace_tid;
+	if (s->detail != NULL) {
+		/* Only keep the file name of paths */
+		if ((p = strrchr(s->detail, '/')) != NULL)
+			p++;
+		else
+			p = s->detail;
+		snprintf(sp->detail, sizeof(sp->detail), "%s", p);
+		for (q = sp->detail; *q != '\0'; q++) {
+			if (*q == '"' || *q == '\\' || *q < ' ')
+				*q = '_';
+		}
+	}
+}
+
+/*
+ * Write all recorded spans in the Chrome trace event format, which can be
+ * loaded into chrome://tracing or Perfetto.
+ */
+void
+flush_trace(void)
+{
+	struct span *sp;
+	FILE *fp = trace_fp;
+	size_t i, n;
+
+	if (tracing == 0)
+		return;
+
+	tracing = 0;
+	trace_fp = NULL;
+
+	n = n_spans < MAX_SPANS ? n_spans : MAX_SPANS;
+
+	fprintf(fp, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+	for (i = 0; i < n; i++) {
+		sp = &spans[i];
+		fprintf(fp, "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\","
+		    "\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d",
+		    sp->name, sp->cat, sp->start / 1e3, sp->dur / 1e3, sp->tid);
+		if (sp->detail[0] != '\0')
+			fprintf(fp, ",\"args\":{\"file\":\"%s\"}", sp->detail);
+		fprintf(fp, "}%s\n", i + 1 < n ? "," : "");
+	}
+	fprintf(fp, "]}\n");
+
+	fclose(fp);
+
+	log_debug("Wrote %zu spans to %s, dropped %zu\n", n, trace_path, dropped);
+
+	free(spans);
+	spans = NULL;
+}
@@ -0,0 +1,54 @@
+/*
+ * Copyright (c) 2026 Matthias Schmidt <xhr@giessen.ccc.de>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include "isscrolls.h"
+
+/*
+ * Progress per mark for the ranks troublesome (1) to epic (5).  Every
+ * progress track, be it a vow, journey, fight, delve, expedition or threat,
+ * is marked through mark_progress().
+ */
+static const double rank_progress[] = { 0.0, 3.0, 2.0, 1.0, 0.5, 0.25 };
+
+/*
+ * Mark progress on a track of the given rank.  The progress is kept between
+ * 0 and 10.  Returns 1 if the mark ran past the end of the track, 0 otherwise.
+ */
+int
+mark_progress(double *progress, int *rank, int what)
+{
+	double amount;
+
+	if (*rank < 1 || *rank > 5) {
+		*rank = 1;
+		log_errx(1, "Unknown rank.  This should not happen.  Set it to 1\n");
+	}
+
+	amount = rank_progress[*rank];
+
+	if (what == INCREASE)
+		*progress += amount;
+	else
+		*progress -= amount;
+
+	if (*progress > 10) {
+		*progress = 10;
+		return 1;
+	} else if (*progress < 0)
+		*progress = 0;
+
+	return 0;
+}
@@ -0,0 +1,358 @@
+/*
+ * Copyright (c) 2026 Matthias Schmidt <xhr@giessen.ccc.de>
+ *
+ * Permission to use, copy, modify, and distribute this software for any
+ * purpose with or without fee is hereby granted, provided that the above
+ * copyright notice and this permission notice appear in all copies.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS" AND THE AUTHOR DISCLAIMS ALL WARRANTIES
+ * WITH REGARD TO THIS SOFTWARE INCLUDING ALL IMPLIED WARRANTIES OF
+ * MERCHANTABILITY AND FITNESS. IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR
+ * ANY SPECIAL, DIRECT, INDIRECT, OR CONSEQUENTIAL DAMAGES OR ANY DAMAGES
+ * WHATSOEVER RESULTING FROM LOSS OF USE, DATA OR PROFITS, WHETHER IN AN
+ * ACTION OF CONTRACT, NEGLIGENCE OR OTHER TORTIOUS ACTION, ARISING OUT OF
+ * OR IN CONNECTION WITH THE USE OR PERFORMANCE OF THIS SOFTWARE.
+ */
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <json-c/json.h>
+
+#include "isscrolls.h"
+
+#define TRUTHS_JSON "ironsworn_world_truths.json"
+#define MAX_TRUTH_OPTIONS 3
+
+/*
+ * The truth categories are read once from PATH_SHARE_DIR and kept in memory.
+ * The truths of the current campaign are stored as one chosen option per
+ * category, 0 means the category has not been set up yet.
+ */
+struct truth_category {
+	char *name;
+	char *truth[MAX_TRUTH_OPTIONS];
+	char *quest[MAX_TRUTH_OPTIONS];
+};
+
+static struct truth_category *categories = NULL;
+static size_t n_categories = 0;
+static int *chosen = NULL;
+static int truths_dirty = 0;
+
+struct truths_state {
+	int *chosen;
+	int dirty;
+};
+
+static int load_truth_categories(void);
+static void setup_world_truths(void);
+static void show_world_truths(void);
+
+void
+cmd_world_truths(char *cmd)
+{
+	struct character *curchar = get_current_character();
+	size_t i;
+
+	CURCHAR_CHECK();
+
+	if (load_truth_categories() == -1) {
+		printf("Cannot read the world truths\n");
+		return;
+	}
+
+	if (cmd != NULL && strcmp(cmd, "new") == 0) {
+		setup_world_truths();
+		return;
+	}
+
+	for (i = 0; i < n_categories; i++) {
+		if (chosen[i] == 0) {
+			setup_world_truths();
+			return;
+		}
+	}
+
+	show_world_truths();
+}
+
+void
+save_truths(void)
+{
+	struct character *curchar = get_current_character();
+	char path[_POSIX_PATH_MAX];
+	json_object *root, *items, *keep, *id;
+	size_t temp_n, i;
+	int ret;
+	TRACE_FUNC("save");
+	CAMPAIGN_LOCK();
+
+	if (curchar == NULL) {
+		log_debug("No character loaded.  No truths to save.\n");
+		return;
+	}
+
+	if (truths_dirty == 0) {
+		log_debug("World truths unchanged.  Nothing to save.\n");
+		return;
+	}
+
+	ret = snprintf(path, sizeof(path), "%s/truths.json", get_isscrolls_dir());
+	if (ret < 0 || (size_t)ret >= sizeof(path)) {
+		log_errx(1, "Path truncation happened.  Buffer too short to fit %s\n", path);
+	}
+
+	if ((root = read_json_file(path)) == NULL) {
+		log_debug("No truths JSON file found\n");
+		if ((root = json_object_new_object()) == NULL)
+			log_errx(1, "Cannot create truths JSON object\n");
+	}
+
+	/* Carry over the truths of all other characters ... */
+	keep = json_object_new_array();
+	if (json_object_object_get_ex(root, "truths", &items)) {
+		temp_n = json_object_array_length(items);
+		for (i = 0; i < temp_n; i++) {
+			json_object *temp = json_object_array_get_idx(items, i);
+			json_object_object_get_ex(temp, "id", &id);
+			if (curchar->id == json_object_get_int(id))
+				continue;
+			json_object_array_add(keep, json_object_get(temp));
+		}
+	}
+
+	/* ... and add the chosen option of every category */
+	for (i = 0; i < n_categories; i++) {
+		if (chosen[i] == 0)
+			continue;
+
+		json_object *cobj = json_object_new_object();
+		json_object_object_add(cobj, "id", json_object_new_int(curchar->id));
+		json_object_object_add(cobj, "category",
+			json_object_new_string(categories[i].name));
+		json_object_object_add(cobj, "option", json_object_new_int(chosen[i]));
+		json_object_array_add(keep, cobj);
+	}
+
+	json_object_object_add(root, "truths", keep);
+
+	if (write_json_file(path, root))
+		printf("Error saving %s\n", path);
+	else {
+		log_debug("Successfully saved %s\n", path);
+		truths_dirty = 0;
+	}
+
+	json_object_put(root);
+}
+
+void
+load_truths(int id)
+{
+	char path[_POSIX_PATH_MAX];
+	json_object *root, *items, *lid, *cat;
+	size_t temp_n, i, j;
+	int ret;
+	TRACE_FUNC("load");
+	CAMPAIGN_LOCK();
+
+	free_truths();
+
+	ret = snprintf(path, sizeof(path), "%s/truths.json", get_isscrolls_dir());
+	if (ret < 0 || (size_t)ret >= sizeof(path)) {
+		log_errx(1, "Path truncation happened.  Buffer too short to fit %s\n", path);
+	}
+
+	if ((root = read_json_file(path)) == NULL) {
+		log_debug("No truths JSON file found\n");
+		return;
+	}
+
+	if (!json_object_object_get_ex(root, "truths", &items) ||
+	    load_truth_categories() == -1) {
+		json_object_put(root);
+		return;
+	}
+
+	temp_n = json_object_array_length(items);
+	for (i = 0; i < temp_n; i++) {
+		json_object *temp = json_object_array_get_idx(items, i);
+		json_object_object_get_ex(temp, "id", &lid);
+		if (id != json_object_get_int(lid))
+			continue;
+
+		if (!json_object_object_get_ex(temp, "category", &cat))
+			continue;
+
+		for (j = 0; j < n_categories; j++) {
+			if (strcmp(categories[j].name, json_object_get_string(cat)) == 0) {
+				chosen[j] = validate_int(temp, "option", 0,
+				    MAX_TRUTH_OPTIONS, 0);
+				break;
+			}
+		}
+	}
+
+	json_object_put(root);
+}
+
+void
+free_truths(void)
+{
+	if (chosen != NULL)
+		memset(chosen, 0, n_categories * sizeof(int));
+	truths_dirty = 0;
+}
+
+void *
+detach_truths(void)
+{
+	struct truths_state *ts;
+
+	if ((ts = calloc(1, sizeof(*ts))) == NULL)
+		log_errx(1, "cannot allocate memory\n");
+
+	if (chosen != NULL) {
+		if ((ts->chosen = calloc(n_categories, sizeof(int))) == NULL)
+			log_errx(1, "cannot allocate memory\n");
+		memcpy(ts->chosen, chosen, n_categories * sizeof(int));
+	}
+	ts->dirty = truths_dirty;
+	free_truths();
+
+	return ts;
+}
+
+void
+attach_truths(void *state)
+{
+	struct truths_state *ts = state;
+
+	free_truths();
+	if (ts == NULL)
+		return;
+
+	/* The categories stay loaded once chosen options exist */
+	if (ts->chosen != NULL && chosen != NULL)
+		memcpy(chosen, ts->chosen, n_categories * sizeof(int));
+	truths_dirty = ts->dirty;
+
+	free(ts->chosen);
+	free(ts);
+}
+
+static void
+setup_world_truths(void)
+{
+	size_t i;
+	int j;
+
+	printf("Choose one truth for every category of your world\n");
+
+	for (i = 0; i < n_categories; i++) {
+		printf("\n%s\n\n", categories[i].name);
+		for (j = 0; j < MAX_TRUTH_OPTIONS; j++)
+			printf("%d\t - %s\n\n", j + 1, categories[i].truth[j]);
+		printf("%d\t - Let the oracle decide\n\n", MAX_TRUTH_OPTIONS + 1);
+
+		chosen[i] = ask_for_value("Enter a value between 1 and 4: ",
+		    MAX_TRUTH_OPTIONS + 1);
+		if (chosen[i] > MAX_TRUTH_OPTIONS) {
+			stats_rng_draw();
+			chosen[i] = (random() % MAX_TRUTH_OPTIONS) + 1;
+		}
+	}
+
+	truths_dirty = 1;
+	mark_dirty();
+
+	show_world_truths();
+}
+
+static void
+show_world_truths(void)
+{
+	size_t i;
+	int o;
+
+	for (i = 0; i < n_categories; i++) {
+		if ((o = chosen[i]) == 0)
+			continue;
+
+		pm(BLUE, "%s\n", categories[i].name);
+		printf("%s\n", categories[i].truth[o - 1]);
+		printf("Quest: %s\n\n", categories[i].quest[o - 1]);
+	}
+}
+
+/*
+ * Read the truth categories on first use.  Returns 0 on success, -1 if the
+ * file cannot be read.
+ */
+static int
+load_truth_categories(void)
+{
+	char path[_POSIX_PATH_MAX];
+	json_object *root, *cats, *temp, *opts, *opt, *val;
+	size_t n, i;
+	int ret, j;
+
+	if (categories != NULL)
+		return 0;
+
+	ret = snprintf(path, sizeof(path), "%s/%s", PATH_SHARE_DIR, TRUTHS_JSON);
+	if (ret < 0 || (size_t)ret >= sizeof(path)) {
+		log_errx(1, "Path truncation happened.  Buffer too short to fit %s\n", path);
+	}
+
+	if ((root = read_json_file(path)) == NULL) {
+		log_debug("Cannot open %s\n", path);
+		return -1;
+	}
+
+	if (!json_object_object_get_ex(root, "Categories", &cats)) {
+		log_debug("Cannot find a [Categories] array in %s\n", path);
+		json_object_put(root);
+		return -1;
+	}
+
+	n = json_object_array_length(cats);
+	if ((categories = calloc(n, sizeof(struct truth_category))) == NULL)
+		log_errx(1, "calloc truth categories\n");
+	if ((chosen = calloc(n, sizeof(int))) == NULL)
+		log_errx(1, "calloc truths\n");
+
+	for (i = 0; i < n; i++) {
+		temp = json_object_array_get_idx(cats, i);
+		if (!json_object_object_get_ex(temp, "Name", &val) ||
+		    !json_object_object_get_ex(temp, "Options", &opts) ||
+		    json_object_array_length(opts) < MAX_TRUTH_OPTIONS)
+			continue;
+
+		if ((categories[n_categories].name =
+		    strdup(json_object_get_string(val))) == NULL)
+			log_errx(1, "strdup\n");
+
+		for (j = 0; j < MAX_TRUTH_OPTIONS; j++) {
+			opt = json_object_array_get_idx(opts, j);
+			json_object_object_get_ex(opt, "Truth", &val);
+			if ((categories[n_categories].truth[j] =
+			    strdup(json_object_get_string(val))) == NULL)
+				log_errx(1, "strdup\n");
+			json_object_object_get_ex(opt, "Quest", &val);
+			if ((categories[n_categories].quest[j] =
+			    strdup(json_object_get_string(val))) == NULL)
+				log_errx(1, "strdup\n");
+		}
+		n_categories++;
+	}
+
+	log_debug("Read %zu truth categories from %s\n", n_categories, path);
+
+	json_object_put(root);
+
+	return 0;
+}
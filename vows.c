@@ -25,10 +25,26 @@
 
 #include "isscrolls.h"
 
+/*
+ * The title and description of a vow live in fixed buffers of the vow itself,
+ * so they are released together with the character.
+ */
+static char *
+set_vow_text(char *buf, size_t len, const char *text)
+{
+	if (text == NULL)
+		return NULL;
+
+	snprintf(buf, len, "%s", text);
+	return buf;
+}
+
 void
 cmd_create_new_vow(char *title)
 {
 	struct character *curchar = get_current_character();
+	struct vow *v;
+	char *line;
 
 	CURCHAR_CHECK();
 
@@ -40,51 +56,59 @@ cmd_create_new_vow(char *title)
 	ask_for_vow_difficulty();
 	curchar->vow_active = 1;
 
+	v = curchar->vow;
 	if (title != NULL && strlen(title) > 0) {
-		curchar->vow->title = calloc(1, MAX_VOW_TITLE+1);
-		if (curchar->vow->title == NULL)
-			log_errx(1, "calloc vow title\n");
-		snprintf(curchar->vow->title, MAX_VOW_TITLE, "%s", title);
+		v->title = set_vow_text(v->title_buf, sizeof(v->title_buf), title);
 	} else {
 again:
 		printf("Enter a title for your vow [max 25 chars]: ");
-		curchar->vow->title = readline(NULL);
-		if (curchar->vow->title != NULL && strlen(curchar->vow->title) == 0) {
+		line = readline(NULL);
+		if (line != NULL && strlen(line) == 0) {
 			printf("The title must contain at least one character\n");
-			free(curchar->vow->title);
+			free(line);
 			goto again;
 		}
+		v->title = set_vow_text(v->title_buf, sizeof(v->title_buf), line);
+		free(line);
 	}
 
 	log_debug("New vow titled '%s'\n", curchar->vow->title);
 
 descagain:
 	printf("Enter a description for your vow [max 255 chars]: ");
-	curchar->vow->description = readline(NULL);
-	if (curchar->vow->description != NULL &&
-		strlen(curchar->vow->description) == 0) {
+	line = readline(NULL);
+	if (line != NULL && strlen(line) == 0) {
 		printf("The description must contain at least one character\n");
-		free(curchar->vow->description);
+		free(line);
 		goto descagain;
 	}
+	v->description = set_vow_text(v->description_buf,
+	    sizeof(v->description_buf), line);
+	free(line);
 
-	/* Every new vow gets a highest ID (vid) ... */
-	curchar->vow->vid = get_max_vow_id();
+	/* Nobody else may take the ID until the vow is saved */
+	{
+		CAMPAIGN_LOCK();
 
-	/* If we don't have any vows yet, start with 1 */
-	if (curchar->vow->vid == -1)
-		curchar->vow->vid = 1;
-	else
-		curchar->vow->vid++;
+		/* Every new vow gets a highest ID (vid) ... */
+		curchar->vow->vid = get_max_vow_id();
 
-	curchar->vid = curchar->vow->vid;
-	/* ... and belongs to one character (id) */
-	curchar->vow->id = curchar->id;
+		/* If we don't have any vows yet, start with 1 */
+		if (curchar->vow->vid == -1)
+			curchar->vow->vid = 1;
+		else
+			curchar->vow->vid++;
 
-	curchar->vow->fulfilled = 0;
+		curchar->vid = curchar->vow->vid;
+		/* ... and belongs to one character (id) */
+		curchar->vow->id = curchar->id;
 
-	save_vow();
+		curchar->vow->fulfilled = 0;
+
+		save_vow();
+	}
 
+	mark_dirty();
 	update_prompt();
 }
 
@@ -104,6 +128,7 @@ cmd_deactivate_vow(__attribute__((unused)) char *unused)
 
 	reset_vow(curchar);
 
+	mark_dirty();
 	update_prompt();
 }
 
@@ -132,6 +157,7 @@ cmd_activate_vow(char *cmd)
 	/* Only redraw the prompt and set the vow as active if there is one */
 	if (load_vow(vid) != -1) {
 		curchar->vow_active = 1;
+		mark_dirty();
 		update_prompt();
 	}
 }
@@ -163,6 +189,7 @@ cmd_delete_vow(__attribute__((unused)) char *unused)
 	delete_vow(curchar->vid);
 	reset_vow(curchar);
 
+	mark_dirty();
 	update_prompt();
 }
 
@@ -187,6 +214,7 @@ cmd_show_all_vows(__attribute__((unused)) char *unused)
 	json_object *root, *progress, *title, *difficulty, *vid, *id, *ff;
 	size_t temp_n, i;
 	int ret;
+	CAMPAIGN_LOCK();
 
 	if (curchar == NULL) {
 		log_debug("No character loaded\n");
@@ -198,7 +226,7 @@ cmd_show_all_vows(__attribute__((unused)) char *unused)
 		log_errx(1, "Path truncation happened.  Buffer too short to fit %s\n", path);
 	}
 
-	if ((root = json_object_from_file(path)) == NULL) {
+	if ((root = read_json_file(path)) == NULL) {
 		log_debug("No vow JSON file found\n");
 		return;
 	}
@@ -277,6 +305,8 @@ get_max_vow_id(void)
 	json_object *root, *vid, *id;
 	size_t temp_n, i;
 	int ret, tvid, max;
+	CAMPAIGN_LOCK();
+
 	tvid = max = 0;
 
 	if (curchar == NULL) {
@@ -289,7 +319,7 @@ get_max_vow_id(void)
 		log_errx(1, "Path truncation happened.  Buffer too short to fit %s\n", path);
 	}
 
-	if ((root = json_object_from_file(path)) == NULL) {
+	if ((root = read_json_file(path)) == NULL) {
 		log_debug("No vow JSON file found\n");
 		return -1;
 	}
@@ -331,14 +361,8 @@ reset_vow(struct character *curchar)
 		return;
 	}
 
-	if (curchar->vow->title != NULL) {
-		free(curchar->vow->title);
-		curchar->vow->title = NULL;
-	}
-	if (curchar->vow->description != NULL) {
-		free(curchar->vow->description);
-		curchar->vow->description = NULL;
-	}
+	curchar->vow->title = NULL;
+	curchar->vow->description = NULL;
 
 	curchar->vow->difficulty = -1;
 	curchar->vow->progress = 0.0;
@@ -356,6 +380,8 @@ save_vow(void)
 	json_object *root, *items, *id, *vid;
 	size_t temp_n, i;
 	int ret;
+	TRACE_FUNC("save");
+	CAMPAIGN_LOCK();
 
 	if (curchar == NULL) {
 		log_debug("No character loaded.  No vow to save.\n");
@@ -386,7 +412,7 @@ save_vow(void)
 		log_errx(1, "Path truncation happened.  Buffer too short to fit %s\n", path);
 	}
 
-	if ((root = json_object_from_file(path)) == NULL) {
+	if ((root = read_json_file(path)) == NULL) {
 		log_debug("No vow JSON file found\n");
 		root = json_object_new_object();
 		if (!root)
@@ -421,7 +447,7 @@ save_vow(void)
 	}
 
 out:
-	if (json_object_to_file(path, root))
+	if (write_json_file(path, root))
 		printf("Error saving %s\n", path);
 	else
 		log_debug("Successfully saved %s\n", path);
@@ -437,6 +463,8 @@ load_vow(int vid)
 	json_object *root, *lid, *title, *desc, *id;
 	size_t temp_n, i;
 	int rval, ret = -1;
+	TRACE_FUNC("load");
+	CAMPAIGN_LOCK();
 
 	if (curchar == NULL) {
 		log_debug("No character loaded\n");
@@ -456,7 +484,7 @@ load_vow(int vid)
 		log_errx(1, "Path truncation happened.  Buffer too short to fit %s\n", path);
 	}
 
-	if ((root = json_object_from_file(path)) == NULL) {
+	if ((root = read_json_file(path)) == NULL) {
 		log_debug("No vow JSON file found\n");
 		return ret;
 	}
@@ -489,15 +517,14 @@ load_vow(int vid)
 			}
 
 			json_object_object_get_ex(temp, "title", &title);
-			if ((curchar->vow->title = calloc(1, MAX_VOW_TITLE+1)) == NULL)
-				log_errx(1, "calloc\n");
-			snprintf(curchar->vow->title, MAX_VOW_TITLE, "%s",
+			curchar->vow->title = set_vow_text(curchar->vow->title_buf,
+				sizeof(curchar->vow->title_buf),
 				json_object_get_string(title));
 
 			json_object_object_get_ex(temp, "description", &desc);
-			if ((curchar->vow->description = calloc(1, MAX_VOW_DESC+1)) == NULL)
-				log_errx(1, "calloc\n");
-			snprintf(curchar->vow->description, MAX_VOW_DESC, "%s",
+			curchar->vow->description = set_vow_text(
+				curchar->vow->description_buf,
+				sizeof(curchar->vow->description_buf),
 				json_object_get_string(desc));
 			ret = 1;
 			goto out;
@@ -520,13 +547,14 @@ delete_vow(int vid)
 	json_object *root, *lid;
 	size_t temp_n, i;
 	int ret;
+	CAMPAIGN_LOCK();
 
 	ret = snprintf(path, sizeof(path), "%s/vows.json", get_isscrolls_dir());
 	if (ret < 0 || (size_t)ret >= sizeof(path)) {
 		log_errx(1, "Path truncation happened.  Buffer too short to fit %s\n", path);
 	}
 
-	if ((root = json_object_from_file(path)) == NULL) {
+	if ((root = read_json_file(path)) == NULL) {
 		log_debug("No vow JSON file found\n");
 		return;
 	}
@@ -548,7 +576,7 @@ delete_vow(int vid)
 		}
 	}
 
-	if (json_object_to_file(path, root))
+	if (write_json_file(path, root))
 		printf("Error saving %s\n", path);
 	else
 		log_debug("Successfully saved %s\n", path);
@@ -580,7 +608,6 @@ void
 mark_vow_progress(int what)
 {
 	struct character *curchar = get_current_character();
-	double amount = 0;
 
 	if (curchar == NULL) {
 		log_debug("No character loaded.  Cannot calculate progress\n");
@@ -588,42 +615,14 @@ mark_vow_progress(int what)
 	}
 
 	if (curchar->vow_active == 0) {
-		printf("You need to have an active vow before you can mark progress\n");
+		pm(NO_JOURNAL, "You need to have an active vow before you can mark progress\n");
 		return;
 	}
 
-	switch (curchar->vow->difficulty) {
-	case 1:
-		amount = 3.0;
-		break;
-	case 2:
-		amount = 2;
-		break;
-	case 3:
-		amount = 1;
-		break;
-	case 4:
-		amount = 0.5;
-		break;
-	case 5:
-		amount = 0.25;
-		break;
-	default:
-		curchar->vow->difficulty = 1;
-		log_errx(1, "Unknown rank.  This should not happen.  Set to 1\n");
-	}
-
-	if (what == INCREASE)
-		curchar->vow->progress += amount;
-	else
-		curchar->vow->progress -= amount;
-
-	if (curchar->vow->progress > 10) {
-		printf("Your vow progress is full.  Consider fulfilling it\n");
-		curchar->vow->progress = 10;
-	} else if (curchar->vow->progress < 0)
-		curchar->vow->progress = 0;
+	if (mark_progress(&curchar->vow->progress, &curchar->vow->difficulty, what))
+		pm(NO_JOURNAL, "Your vow progress is full.  Consider fulfilling it\n");
 
+	mark_dirty();
 	update_prompt();
 }
 